@@ -8,6 +8,7 @@
 */
 
 #include "abstract_output.h"
+#include "renderloop.h"
 
 namespace KWin
 {
@@ -55,6 +56,7 @@ const uint16_t *GammaRamp::blue() const
 
 AbstractOutput::AbstractOutput(QObject *parent)
     : QObject(parent)
+    , m_renderLoop(new RenderLoop(this, this))
 {
 }
 
@@ -103,4 +105,9 @@ bool AbstractOutput::setGammaRamp(const GammaRamp &gamma)
     return false;
 }
 
+RenderLoop *AbstractOutput::renderLoop() const
+{
+    return m_renderLoop;
+}
+
 } // namespace KWin
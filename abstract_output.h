@@ -24,6 +24,8 @@ class OutputChangeSet;
 namespace KWin
 {
 
+class RenderLoop;
+
 class KWIN_EXPORT GammaRamp
 {
 public:
@@ -164,8 +166,16 @@ public:
     /** Returns the resolution of the output.  */
     virtual QSize pixelSize() const = 0;
 
+    /**
+     * Returns the RenderLoop that schedules frames on this output.
+     *
+     * The render loop is only used if the Compositor drives outputs individually.
+     */
+    RenderLoop *renderLoop() const;
+
 private:
     Q_DISABLE_COPY(AbstractOutput)
+    RenderLoop *m_renderLoop;
 };
 
 } // namespace KWin
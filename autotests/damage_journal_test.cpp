@@ -0,0 +1,120 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "damagejournal.h"
+
+#include <QtTest>
+
+using namespace KWin;
+
+class DamageJournalTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testAccumulate();
+    void testUndefinedBuffer();
+    void testCapacity();
+    void testClear();
+    void testCoarsening();
+    void testCoarsened_data();
+    void testCoarsened();
+};
+
+void DamageJournalTest::testAccumulate()
+{
+    DamageJournal journal;
+    const QRegion fallback(0, 0, 100, 100);
+
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+    journal.add(QRect(40, 0, 10, 10));
+
+    // A buffer of age 1 holds the last frame, nothing has to be repaired.
+    QCOMPARE(journal.accumulate(1, fallback), QRegion());
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), QRegion(40, 0, 10, 10) | QRect(20, 0, 10, 10));
+}
+
+void DamageJournalTest::testUndefinedBuffer()
+{
+    DamageJournal journal;
+    const QRegion fallback(0, 0, 100, 100);
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+
+    journal.add(QRect(0, 0, 10, 10));
+    QCOMPARE(journal.accumulate(0, fallback), fallback);
+    QCOMPARE(journal.accumulate(2, fallback), fallback);
+}
+
+void DamageJournalTest::testCapacity()
+{
+    DamageJournal journal(3);
+    const QRegion fallback(0, 0, 100, 100);
+    for (int i = 0; i < 5; ++i) {
+        journal.add(QRect(i * 10, 0, 10, 10));
+    }
+    QCOMPARE(journal.accumulate(3, fallback), QRegion(40, 0, 10, 10) | QRect(30, 0, 10, 10));
+    QCOMPARE(journal.accumulate(4, fallback), fallback);
+
+    journal.setCapacity(5);
+    QCOMPARE(journal.capacity(), 5);
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+}
+
+void DamageJournalTest::testClear()
+{
+    DamageJournal journal;
+    const QRegion fallback(0, 0, 100, 100);
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(0, 0, 10, 10));
+    journal.clear();
+    QCOMPARE(journal.accumulate(2, fallback), fallback);
+}
+
+void DamageJournalTest::testCoarsening()
+{
+    DamageJournal journal;
+    journal.setCoarsening(4, 16);
+
+    QRegion damage;
+    for (int i = 0; i < 8; ++i) {
+        damage |= QRect(i * 4, 0, 2, 2);
+    }
+    journal.add(QRegion());
+    journal.add(damage);
+
+    // The eight small rects end up in two tiles.
+    QCOMPARE(journal.accumulate(2, QRegion()), QRegion(0, 0, 32, 16));
+}
+
+void DamageJournalTest::testCoarsened_data()
+{
+    QTest::addColumn<QRegion>("region");
+    QTest::addColumn<QRegion>("expected");
+
+    QTest::newRow("empty") << QRegion() << QRegion();
+    QTest::newRow("aligned") << QRegion(0, 0, 32, 32) << QRegion(0, 0, 32, 32);
+    QTest::newRow("unaligned") << QRegion(5, 5, 20, 5) << QRegion(0, 0, 32, 16);
+    QTest::newRow("negative") << QRegion(-5, -5, 10, 10) << QRegion(-16, -16, 32, 32);
+    QTest::newRow("gap") << (QRegion(0, 0, 4, 4) | QRect(40, 0, 4, 4))
+                         << (QRegion(0, 0, 16, 16) | QRect(32, 0, 16, 16));
+    QTest::newRow("rows") << (QRegion(0, 0, 4, 4) | QRect(0, 20, 4, 4) | QRect(20, 40, 4, 4))
+                          << (QRegion(0, 0, 16, 32) | QRect(16, 32, 16, 16));
+}
+
+void DamageJournalTest::testCoarsened()
+{
+    QFETCH(QRegion, region);
+    const QRegion coarsened = DamageJournal::coarsened(region, 16);
+    QTEST(coarsened, "expected");
+    QVERIFY((region - coarsened).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(DamageJournalTest)
+#include "damage_journal_test.moc"
@@ -0,0 +1,213 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "effectprofiler.h"
+
+#include <QThread>
+#include <QtTest>
+
+using namespace KWin;
+
+class EffectProfilerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testDisabled();
+    void testEmpty();
+    void testAccumulate();
+    void testNested();
+    void testAverage();
+    void testChangedChain();
+    void testHistory();
+    void testClear();
+};
+
+static const QStringList s_effects{QStringLiteral("blur"), QStringLiteral("slide")};
+static const qint64 s_millisecond = 1000000;
+
+static qint64 effectValue(const QVariantMap &summary, const QString &name, const QString &key)
+{
+    return summary.value(QStringLiteral("effects")).toMap().value(name).toMap().value(key).toLongLong();
+}
+
+void EffectProfilerTest::testDisabled()
+{
+    EffectProfiler profiler;
+    QVERIFY(!profiler.isEnabled());
+
+    profiler.beginFrame(s_effects);
+    {
+        EffectProfiler::Scope scope(&profiler, 0, false);
+    }
+    profiler.endFrame();
+
+    const QVariantMap summary = profiler.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toLongLong(), 0);
+    QVERIFY(summary.value(QStringLiteral("effects")).toMap().isEmpty());
+}
+
+void EffectProfilerTest::testEmpty()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    const QVariantMap summary = profiler.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toLongLong(), 0);
+    QVERIFY(!summary.contains(QStringLiteral("cpuAverage")));
+    QVERIFY(!summary.contains(QStringLiteral("gpuAverage")));
+    QVERIFY(summary.value(QStringLiteral("effects")).toMap().isEmpty());
+}
+
+void EffectProfilerTest::testAccumulate()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    // The same effect is entered several times per frame, once for every paint stage.
+    for (int frame = 0; frame < 3; ++frame) {
+        profiler.beginFrame(s_effects);
+        for (int stage = 0; stage < 2; ++stage) {
+            EffectProfiler::Scope scope(&profiler, 1, false);
+            QThread::msleep(2);
+        }
+        profiler.endFrame();
+    }
+
+    const QVariantMap summary = profiler.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toLongLong(), 3);
+    QCOMPARE(effectValue(summary, QStringLiteral("slide"), QStringLiteral("frames")), 3);
+    QVERIFY(effectValue(summary, QStringLiteral("slide"), QStringLiteral("cpuAverage")) >= 4 * s_millisecond);
+    // Effects that are active but haven't painted are listed as well.
+    QCOMPARE(effectValue(summary, QStringLiteral("blur"), QStringLiteral("frames")), 3);
+    QCOMPARE(effectValue(summary, QStringLiteral("blur"), QStringLiteral("cpuMax")), 0);
+    // Without the GPU being measured, there are no GPU times.
+    QVERIFY(!summary.contains(QStringLiteral("gpuAverage")));
+    QVERIFY(!summary.value(QStringLiteral("effects")).toMap().value(QStringLiteral("slide")).toMap().contains(QStringLiteral("gpuAverage")));
+}
+
+void EffectProfilerTest::testNested()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    // An effect calls into the next effect, which calls into the scene. The time spent
+    // in the nested sections isn't accounted to the calling effect.
+    profiler.beginFrame(s_effects);
+    {
+        EffectProfiler::Scope blur(&profiler, 0, false);
+        QThread::msleep(1);
+        {
+            EffectProfiler::Scope slide(&profiler, 1, false);
+            QThread::msleep(1);
+            {
+                EffectProfiler::Scope scene(&profiler, -1, false);
+                QThread::msleep(30);
+            }
+        }
+    }
+    profiler.endFrame();
+
+    const QVariantMap summary = profiler.summary();
+    const qint64 scene = effectValue(summary, QStringLiteral("[scene]"), QStringLiteral("cpuAverage"));
+    const qint64 blur = effectValue(summary, QStringLiteral("blur"), QStringLiteral("cpuAverage"));
+    const qint64 slide = effectValue(summary, QStringLiteral("slide"), QStringLiteral("cpuAverage"));
+    QVERIFY(scene >= 30 * s_millisecond);
+    QVERIFY(blur >= s_millisecond);
+    QVERIFY(slide >= s_millisecond);
+    QVERIFY(blur < 30 * s_millisecond);
+    QVERIFY(slide < 30 * s_millisecond);
+
+    // The totals only cover the effects.
+    QCOMPARE(summary.value(QStringLiteral("cpuAverage")).toLongLong(), blur + slide);
+}
+
+void EffectProfilerTest::testAverage()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    for (int frame = 1; frame <= 3; ++frame) {
+        profiler.beginFrame(s_effects);
+        {
+            EffectProfiler::Scope scope(&profiler, 0, false);
+            QThread::msleep(frame * 5);
+        }
+        profiler.endFrame();
+    }
+
+    const QVariantMap summary = profiler.summary();
+    const qint64 average = effectValue(summary, QStringLiteral("blur"), QStringLiteral("cpuAverage"));
+    const qint64 max = effectValue(summary, QStringLiteral("blur"), QStringLiteral("cpuMax"));
+    QVERIFY(average >= 10 * s_millisecond);
+    QVERIFY(max >= 15 * s_millisecond);
+    QVERIFY(average < max);
+}
+
+void EffectProfilerTest::testChangedChain()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    // An effect that has been loaded in the middle of the frame is accounted to the scene.
+    profiler.beginFrame(s_effects);
+    {
+        EffectProfiler::Scope scope(&profiler, 5, false);
+        QThread::msleep(2);
+    }
+    profiler.endFrame();
+
+    const QVariantMap summary = profiler.summary();
+    QCOMPARE(summary.value(QStringLiteral("effects")).toMap().count(), 3);
+    QVERIFY(effectValue(summary, QStringLiteral("[scene]"), QStringLiteral("cpuAverage")) >= 2 * s_millisecond);
+}
+
+void EffectProfilerTest::testHistory()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+
+    // Only the most recent frames are kept.
+    for (int frame = 0; frame < 200; ++frame) {
+        profiler.beginFrame(s_effects);
+        {
+            EffectProfiler::Scope scope(&profiler, 0, false);
+        }
+        profiler.endFrame();
+    }
+    QCOMPARE(profiler.summary().value(QStringLiteral("frames")).toLongLong(), 120);
+
+    // A frame that hasn't ended isn't recorded.
+    profiler.clear();
+    profiler.beginFrame(s_effects);
+    QCOMPARE(profiler.summary().value(QStringLiteral("frames")).toLongLong(), 0);
+}
+
+void EffectProfilerTest::testClear()
+{
+    EffectProfiler profiler;
+    profiler.setEnabled(true);
+    for (int frame = 0; frame < 3; ++frame) {
+        profiler.beginFrame(s_effects);
+        profiler.endFrame();
+    }
+    QCOMPARE(profiler.summary().value(QStringLiteral("frames")).toLongLong(), 3);
+
+    profiler.clear();
+    QVariantMap summary = profiler.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toLongLong(), 0);
+    QVERIFY(summary.value(QStringLiteral("effects")).toMap().isEmpty());
+
+    // The profiler keeps recording after it has been reset.
+    profiler.beginFrame(s_effects);
+    profiler.endFrame();
+    QCOMPARE(profiler.summary().value(QStringLiteral("frames")).toLongLong(), 1);
+}
+
+QTEST_GUILESS_MAIN(EffectProfilerTest)
+#include "effect_profiler_test.moc"
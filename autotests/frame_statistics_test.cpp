@@ -0,0 +1,181 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "framestatistics.h"
+
+#include <QtTest>
+
+using namespace KWin;
+
+class FrameStatisticsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testEmpty();
+    void testRollingWindow();
+    void testPercentiles();
+    void testGpuDuration();
+    void testMissedVBlanks();
+    void testClear();
+};
+
+static void recordFrame(FrameStatistics *statistics, qint64 paintDuration)
+{
+    statistics->beginFrame();
+    statistics->setPaintTimes(1, 0, paintDuration);
+}
+
+static void finishFrames(FrameStatistics *statistics)
+{
+    // A frame is only recorded once the next one begins, the one begun here isn't
+    // presented, so it doesn't show up.
+    statistics->beginFrame();
+}
+
+void FrameStatisticsTest::testEmpty()
+{
+    FrameStatistics statistics;
+    QVERIFY(statistics.frames().isEmpty());
+    QVERIFY(statistics.traceEvents(0).isEmpty());
+
+    const QVariantMap summary = statistics.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toInt(), 0);
+    QCOMPARE(summary.value(QStringLiteral("presentedFrames")).toInt(), 0);
+    QCOMPARE(summary.value(QStringLiteral("missedVBlanks")).toInt(), 0);
+    // There are no durations to summarize.
+    QVERIFY(!summary.contains(QStringLiteral("paintAverage")));
+    QVERIFY(!summary.contains(QStringLiteral("paintP50")));
+    QVERIFY(!summary.contains(QStringLiteral("gpuMax")));
+
+    // A frame in progress isn't recorded yet.
+    statistics.beginFrame();
+    QVERIFY(statistics.frames().isEmpty());
+}
+
+void FrameStatisticsTest::testRollingWindow()
+{
+    FrameStatistics statistics;
+    for (int i = 1; i <= 650; ++i) {
+        recordFrame(&statistics, i);
+    }
+    finishFrames(&statistics);
+
+    // Only the most recent 600 frames are kept, oldest first.
+    const QVector<FrameRecord> frames = statistics.frames();
+    QCOMPARE(frames.count(), 600);
+    QCOMPARE(frames.constFirst().sequence, quint64(51));
+    QCOMPARE(frames.constLast().sequence, quint64(650));
+    for (int i = 1; i < frames.count(); ++i) {
+        QCOMPARE(frames[i].sequence, frames[i - 1].sequence + 1);
+    }
+
+    const QVariantMap summary = statistics.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toInt(), 600);
+    QCOMPARE(summary.value(QStringLiteral("paintMin")).toLongLong(), 51);
+    QCOMPARE(summary.value(QStringLiteral("paintMax")).toLongLong(), 650);
+}
+
+void FrameStatisticsTest::testPercentiles()
+{
+    FrameStatistics statistics;
+    // Every duration from 1 to 100 once, out of order.
+    for (int i = 0; i < 100; ++i) {
+        recordFrame(&statistics, (i * 37) % 100 + 1);
+    }
+    finishFrames(&statistics);
+
+    const QVariantMap summary = statistics.summary();
+    QCOMPARE(summary.value(QStringLiteral("frames")).toInt(), 100);
+    QCOMPARE(summary.value(QStringLiteral("paintMin")).toLongLong(), 1);
+    QCOMPARE(summary.value(QStringLiteral("paintAverage")).toLongLong(), 50);
+    QCOMPARE(summary.value(QStringLiteral("paintP50")).toLongLong(), 50);
+    QCOMPARE(summary.value(QStringLiteral("paintP95")).toLongLong(), 95);
+    QCOMPARE(summary.value(QStringLiteral("paintP99")).toLongLong(), 99);
+    QCOMPARE(summary.value(QStringLiteral("paintMax")).toLongLong(), 100);
+
+    // With a single frame, every percentile is that frame.
+    statistics.clear();
+    recordFrame(&statistics, 7);
+    finishFrames(&statistics);
+    const QVariantMap single = statistics.summary();
+    QCOMPARE(single.value(QStringLiteral("paintP50")).toLongLong(), 7);
+    QCOMPARE(single.value(QStringLiteral("paintP99")).toLongLong(), 7);
+}
+
+void FrameStatisticsTest::testGpuDuration()
+{
+    FrameStatistics statistics;
+
+    // There is no previous frame yet.
+    statistics.setPreviousGpuDuration(1000);
+    recordFrame(&statistics, 1);
+    recordFrame(&statistics, 2);
+    statistics.setPreviousGpuDuration(3000);
+    finishFrames(&statistics);
+
+    const QVector<FrameRecord> frames = statistics.frames();
+    QCOMPARE(frames.count(), 2);
+    QCOMPARE(frames[0].gpuDuration, qint64(3000));
+    QCOMPARE(frames[1].gpuDuration, qint64(-1));
+
+    const QVariantMap summary = statistics.summary();
+    QCOMPARE(summary.value(QStringLiteral("gpuMin")).toLongLong(), 3000);
+    QCOMPARE(summary.value(QStringLiteral("gpuMax")).toLongLong(), 3000);
+}
+
+void FrameStatisticsTest::testMissedVBlanks()
+{
+    FrameStatistics statistics;
+    const qint64 vblankInterval = 16666667;
+    const qint64 target = 1000000000;
+
+    statistics.setTargetPresentationTime(target, vblankInterval);
+    statistics.beginFrame();
+    statistics.endRendering();
+    statistics.swapScheduled();
+    statistics.framePresented(target + 2 * vblankInterval + 1000);
+
+    // A presented frame shows up before the next one begins.
+    const QVector<FrameRecord> frames = statistics.frames();
+    QCOMPARE(frames.count(), 1);
+    QCOMPARE(frames.constFirst().targetPresentationTime, target);
+    QCOMPARE(frames.constFirst().missedVBlanks, 2);
+
+    const QVariantMap summary = statistics.summary();
+    QCOMPARE(summary.value(QStringLiteral("presentedFrames")).toInt(), 1);
+    QCOMPARE(summary.value(QStringLiteral("missedVBlanks")).toInt(), 2);
+
+    // The target only applies to the frame that follows it.
+    statistics.beginFrame();
+    statistics.swapScheduled();
+    statistics.framePresented(target + 10 * vblankInterval);
+    QCOMPARE(statistics.frames().constLast().missedVBlanks, 0);
+}
+
+void FrameStatisticsTest::testClear()
+{
+    FrameStatistics statistics;
+    for (int i = 1; i <= 10; ++i) {
+        recordFrame(&statistics, i);
+    }
+    finishFrames(&statistics);
+    QCOMPARE(statistics.frames().count(), 10);
+
+    statistics.clear();
+    QVERIFY(statistics.frames().isEmpty());
+    QCOMPARE(statistics.summary().value(QStringLiteral("frames")).toInt(), 0);
+
+    // The frame in progress isn't affected, it's recorded in the emptied window.
+    recordFrame(&statistics, 5);
+    finishFrames(&statistics);
+    QCOMPARE(statistics.frames().count(), 2);
+}
+
+QTEST_GUILESS_MAIN(FrameStatisticsTest)
+#include "frame_statistics_test.moc"
@@ -0,0 +1,335 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "composite.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "scene.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include "effect_builtins.h"
+
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include <time.h>
+
+// Count the heap allocations of the whole process, which includes the in-process test clients.
+static std::atomic<quint64> s_allocationCount{0};
+
+void *operator new(std::size_t size)
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace KWin;
+using namespace KWayland::Client;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_compositing_benchmark-0");
+
+static qint64 processCpuTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Runs synthetic workloads against the compositor on the virtual platform and reports
+ * frames per second, CPU time per frame and heap allocations per frame.
+ *
+ * It is not run as part of the test suite, start it with dbus-run-session. The number of
+ * frames rendered per workload can be changed with KWIN_BENCHMARK_FRAMES.
+ */
+class CompositingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkDamageStorm_data();
+    void benchmarkDamageStorm();
+    void benchmarkWindowMoves_data();
+    void benchmarkWindowMoves();
+    void benchmarkLargeStack();
+    void benchmarkDesktopSwitchAnimation();
+
+private:
+    struct Window {
+        Surface *surface = nullptr;
+        XdgShellSurface *shellSurface = nullptr;
+        AbstractClient *client = nullptr;
+    };
+    bool createWindows(int count, const QSize &size);
+    void destroyWindows();
+    bool measure(const std::function<void(int frame)> &step);
+
+    QVector<Window> m_windows;
+    int m_frames = 300;
+};
+
+void CompositingBenchmark::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1920, 1080));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+
+    // Only the effects a workload asks for should take part in rendering.
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    ScriptedEffectLoader loader;
+    const auto builtinNames = BuiltInEffects::availableEffectNames() << loader.listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    // Don't let the frame rate limit hide the cost of a frame.
+    KConfigGroup compositing(config, QStringLiteral("Compositing"));
+    compositing.writeEntry("MaxFPS", 1000);
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+    qputenv("KWIN_EFFECTS_FORCE_ANIMATIONS", QByteArrayLiteral("1"));
+
+    if (qEnvironmentVariableIsSet("KWIN_BENCHMARK_FRAMES")) {
+        m_frames = qMax(1, qEnvironmentVariableIntValue("KWIN_BENCHMARK_FRAMES"));
+    }
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    waylandServer()->initWorkspace();
+
+    auto scene = Compositor::self()->scene();
+    QVERIFY(scene);
+    QCOMPARE(scene->compositingType(), OpenGL2Compositing);
+}
+
+void CompositingBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CompositingBenchmark::cleanup()
+{
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    effectsImpl->unloadAllEffects();
+    VirtualDesktopManager::self()->setCount(1);
+
+    destroyWindows();
+    Test::destroyWaylandConnection();
+}
+
+bool CompositingBenchmark::createWindows(int count, const QSize &size)
+{
+    for (int i = 0; i < count; ++i) {
+        Window window;
+        window.surface = Test::createSurface(this);
+        window.shellSurface = Test::createXdgShellStableSurface(window.surface, window.surface);
+        window.client = Test::renderAndWaitForShown(window.surface, size, QColor::fromHsv((i * 37) % 360, 255, 255));
+        if (!window.client) {
+            return false;
+        }
+        m_windows.append(window);
+    }
+    return true;
+}
+
+void CompositingBenchmark::destroyWindows()
+{
+    for (const Window &window : qAsConst(m_windows)) {
+        delete window.shellSurface;
+        delete window.surface;
+    }
+    m_windows.clear();
+}
+
+bool CompositingBenchmark::measure(const std::function<void(int frame)> &step)
+{
+    Scene *scene = Compositor::self()->scene();
+    QSignalSpy frameRenderedSpy(scene, &Scene::frameRendered);
+    if (!frameRenderedSpy.isValid()) {
+        return false;
+    }
+
+    // Let the compositor settle down before measuring.
+    Compositor::self()->addRepaintFull();
+    if (!frameRenderedSpy.wait()) {
+        return false;
+    }
+
+    const auto renderLoops = Compositor::self()->renderLoops();
+    for (RenderLoop *renderLoop : renderLoops) {
+        renderLoop->statistics()->clear();
+    }
+
+    QElapsedTimer timer;
+    const qint64 cpuStartTime = processCpuTime();
+    const quint64 allocationsBefore = s_allocationCount.load();
+    frameRenderedSpy.clear();
+    timer.start();
+
+    for (int frame = 0; frame < m_frames; ++frame) {
+        const int rendered = frameRenderedSpy.count();
+        step(frame);
+        Test::flushWaylandConnection();
+        while (frameRenderedSpy.count() == rendered) {
+            if (!frameRenderedSpy.wait()) {
+                return false;
+            }
+        }
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    const qint64 cpuTime = processCpuTime() - cpuStartTime;
+    const quint64 allocations = s_allocationCount.load() - allocationsBefore;
+    const int frames = frameRenderedSpy.count();
+
+    qint64 renderTime = 0;
+    for (RenderLoop *renderLoop : renderLoops) {
+        renderTime = qMax(renderTime, renderLoop->statistics()->summary().value(QStringLiteral("renderAverage")).toLongLong());
+    }
+
+    const qreal framesPerSecond = frames * 1e9 / elapsed;
+    qInfo("%s: %d frames, %.1f frames/s, %.3f ms CPU time per frame, %.3f ms render time per frame, %.1f allocations per frame",
+          QTest::currentDataTag() ? QTest::currentDataTag() : QTest::currentTestFunction(),
+          frames, framesPerSecond, cpuTime / 1e6 / frames, renderTime / 1e6, qreal(allocations) / frames);
+    QTest::setBenchmarkResult(framesPerSecond, QTest::FramesPerSecond);
+    return true;
+}
+
+void CompositingBenchmark::benchmarkDamageStorm_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("1 window") << 1 << QSize(1280, 720);
+    QTest::newRow("10 windows") << 10 << QSize(640, 480);
+    QTest::newRow("50 windows") << 50 << QSize(320, 240);
+}
+
+void CompositingBenchmark::benchmarkDamageStorm()
+{
+    // Every client commits a new shm buffer every frame.
+    QFETCH(int, windowCount);
+    QFETCH(QSize, size);
+    QVERIFY(createWindows(windowCount, size));
+
+    const auto step = [this, size](int frame) {
+        for (const Window &window : qAsConst(m_windows)) {
+            Test::render(window.surface, size, frame % 2 ? Qt::red : Qt::blue);
+        }
+    };
+    QVERIFY(measure(step));
+}
+
+void CompositingBenchmark::benchmarkWindowMoves_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::newRow("1 window") << 1;
+    QTest::newRow("20 windows") << 20;
+}
+
+void CompositingBenchmark::benchmarkWindowMoves()
+{
+    // The topmost window is dragged across the screen, exposing the windows below it.
+    QFETCH(int, windowCount);
+    QVERIFY(createWindows(windowCount, QSize(400, 300)));
+
+    AbstractClient *client = m_windows.last().client;
+    const auto step = [client](int frame) {
+        client->move(QPoint((frame * 7) % 1500, (frame * 3) % 700));
+    };
+    QVERIFY(measure(step));
+}
+
+void CompositingBenchmark::benchmarkLargeStack()
+{
+    // Only the topmost of 200 overlapping windows changes, the rest is occluded or static.
+    QVERIFY(createWindows(200, QSize(300, 200)));
+    for (int i = 0; i < m_windows.count(); ++i) {
+        m_windows[i].client->move(QPoint((i * 23) % 1600, (i * 17) % 860));
+    }
+
+    const Window top = m_windows.last();
+    const auto step = [top](int frame) {
+        Test::render(top.surface, QSize(300, 200), frame % 2 ? Qt::red : Qt::blue);
+    };
+    QVERIFY(measure(step));
+}
+
+void CompositingBenchmark::benchmarkDesktopSwitchAnimation()
+{
+    // Desktop switching with the slide effect keeps the effect chain animating.
+    VirtualDesktopManager::self()->setCount(2);
+    QVERIFY(createWindows(10, QSize(640, 480)));
+
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl->loadEffect(BuiltInEffects::nameForEffect(BuiltInEffect::Slide)));
+    Effect *effect = effectsImpl->findEffect(BuiltInEffects::nameForEffect(BuiltInEffect::Slide));
+    QVERIFY(effect);
+
+    const auto step = [effect](int) {
+        if (!effect->isActive()) {
+            const uint current = VirtualDesktopManager::self()->current();
+            VirtualDesktopManager::self()->setCurrent(current == 1 ? 2u : 1u);
+        }
+    };
+    QVERIFY(measure(step));
+}
+
+WAYLANDTEST_MAIN(CompositingBenchmark)
+#include "compositing_benchmark.moc"
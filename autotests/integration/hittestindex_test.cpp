@@ -0,0 +1,190 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "cursor.h"
+#include "hittestindex.h"
+#include "platform.h"
+#include "screens.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_hit_test_index-0");
+
+class HitTestIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testInsertion();
+    void testStackingOrder();
+    void testGeometryChange();
+    void testRemoval();
+};
+
+void HitTestIndexTest::initTestCase()
+{
+    qRegisterMetaType<AbstractClient *>();
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+    QMetaObject::invokeMethod(kwinApp()->platform(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(int, 2));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QCOMPARE(screens()->count(), 2);
+    QCOMPARE(screens()->geometry(0), QRect(0, 0, 1280, 1024));
+    QCOMPARE(screens()->geometry(1), QRect(1280, 0, 1280, 1024));
+    waylandServer()->initWorkspace();
+}
+
+void HitTestIndexTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+
+    screens()->setCurrent(0);
+    Cursors::self()->mouse()->setPos(QPoint(640, 512));
+}
+
+void HitTestIndexTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void HitTestIndexTest::testInsertion()
+{
+    // This test verifies that a new window is found in the cells it covers and only in those.
+    using namespace KWayland::Client;
+
+    HitTestIndex index;
+
+    QScopedPointer<Surface> surface(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface(Test::createXdgShellStableSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+    client->move(QPoint(10, 10));
+
+    const QVector<Toplevel *> *windows = index.managedWindowsAt(QPoint(50, 30));
+    QVERIFY(windows);
+    QVERIFY(windows->contains(client));
+    QVERIFY(!index.unmanagedWindowsAt(QPoint(50, 30))->contains(client));
+
+    // A cell on the other screen doesn't know about the window.
+    windows = index.managedWindowsAt(QPoint(2000, 800));
+    QVERIFY(windows);
+    QVERIFY(!windows->contains(client));
+
+    // Positions outside of all screens aren't indexed.
+    QVERIFY(!index.managedWindowsAt(QPoint(-10, -10)));
+    QVERIFY(!index.managedWindowsAt(QPoint(2560, 0)));
+}
+
+void HitTestIndexTest::testStackingOrder()
+{
+    // This test verifies that the windows of a cell are ordered bottom-most first and follow
+    // changes to the stacking order.
+    using namespace KWayland::Client;
+
+    HitTestIndex index;
+
+    QScopedPointer<Surface> surface1(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface1(Test::createXdgShellStableSurface(surface1.data()));
+    AbstractClient *client1 = Test::renderAndWaitForShown(surface1.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client1);
+    client1->move(QPoint(10, 10));
+
+    QScopedPointer<Surface> surface2(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface2(Test::createXdgShellStableSurface(surface2.data()));
+    AbstractClient *client2 = Test::renderAndWaitForShown(surface2.data(), QSize(100, 50), Qt::red);
+    QVERIFY(client2);
+    client2->move(QPoint(40, 20));
+
+    const QPoint overlap(60, 40);
+    const QVector<Toplevel *> *windows = index.managedWindowsAt(overlap);
+    QVERIFY(windows);
+    QVERIFY(windows->contains(client1));
+    QVERIFY(windows->contains(client2));
+    QVERIFY(windows->indexOf(client1) < windows->indexOf(client2));
+
+    workspace()->raiseClient(client1);
+    windows = index.managedWindowsAt(overlap);
+    QVERIFY(windows);
+    QVERIFY(windows->indexOf(client2) < windows->indexOf(client1));
+
+    workspace()->lowerClient(client1);
+    windows = index.managedWindowsAt(overlap);
+    QVERIFY(windows);
+    QVERIFY(windows->indexOf(client1) < windows->indexOf(client2));
+}
+
+void HitTestIndexTest::testGeometryChange()
+{
+    // This test verifies that moving a window updates the cells it is listed in.
+    using namespace KWayland::Client;
+
+    HitTestIndex index;
+
+    QScopedPointer<Surface> surface(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface(Test::createXdgShellStableSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+    client->move(QPoint(10, 10));
+    QVERIFY(index.managedWindowsAt(QPoint(50, 30))->contains(client));
+
+    client->move(QPoint(1400, 600));
+    QVERIFY(!index.managedWindowsAt(QPoint(50, 30))->contains(client));
+    QVERIFY(index.managedWindowsAt(QPoint(1450, 620))->contains(client));
+
+    // A window covering several cells is listed in all of them.
+    client->move(QPoint(250, 250));
+    QVERIFY(index.managedWindowsAt(QPoint(252, 252))->contains(client));
+    QVERIFY(index.managedWindowsAt(QPoint(345, 295))->contains(client));
+    QVERIFY(!index.managedWindowsAt(QPoint(1450, 620))->contains(client));
+}
+
+void HitTestIndexTest::testRemoval()
+{
+    // This test verifies that a closed window is no longer listed.
+    using namespace KWayland::Client;
+
+    HitTestIndex index;
+
+    QScopedPointer<Surface> surface(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface(Test::createXdgShellStableSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+    client->move(QPoint(10, 10));
+    QVERIFY(index.managedWindowsAt(QPoint(50, 30))->contains(client));
+
+    shellSurface.reset();
+    surface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+
+    const QVector<Toplevel *> *windows = index.managedWindowsAt(QPoint(50, 30));
+    QVERIFY(windows);
+    QVERIFY(!windows->contains(client));
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::HitTestIndexTest)
+#include "hittestindex_test.moc"
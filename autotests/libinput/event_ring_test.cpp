@@ -0,0 +1,91 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../../libinput/eventring.h"
+
+#include <QtTest>
+
+#include <thread>
+
+using namespace KWin::LibInput;
+
+class TestLibinputEventRing : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testFillAndDrain();
+    void testWrapAround();
+    void testConcurrentTransfer();
+};
+
+void TestLibinputEventRing::testFillAndDrain()
+{
+    EventRing<int, 4> ring;
+    QVERIFY(ring.isEmpty());
+    QVERIFY(!ring.isFull());
+
+    for (int i = 0; i < ring.capacity(); ++i) {
+        QVERIFY(ring.push(i));
+    }
+    QVERIFY(ring.isFull());
+    QVERIFY(!ring.push(4));
+
+    for (int i = 0; i < ring.capacity(); ++i) {
+        QCOMPARE(ring.peek(), i);
+        ring.pop();
+    }
+    QVERIFY(ring.isEmpty());
+}
+
+void TestLibinputEventRing::testWrapAround()
+{
+    EventRing<int, 4> ring;
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(ring.push(i));
+        QVERIFY(ring.push(i + 1000));
+        QCOMPARE(ring.peek(), i);
+        ring.pop();
+        QCOMPARE(ring.peek(), i + 1000);
+        ring.pop();
+        QVERIFY(ring.isEmpty());
+    }
+}
+
+void TestLibinputEventRing::testConcurrentTransfer()
+{
+    // The consumer has to see every value exactly once and in order.
+    EventRing<int, 64> ring;
+    const int count = 100000;
+
+    std::thread producer([&ring]() {
+        for (int i = 0; i < count; ++i) {
+            while (!ring.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    while (expected < count) {
+        if (ring.isEmpty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (ring.peek() != expected) {
+            break;
+        }
+        ring.pop();
+        expected++;
+    }
+    producer.join();
+    QCOMPARE(expected, count);
+    QVERIFY(ring.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestLibinputEventRing)
+#include "event_ring_test.moc"
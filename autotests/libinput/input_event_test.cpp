@@ -66,6 +66,16 @@ void InputEventsTest::testInitMouseEvent()
     QCOMPARE(event.delta(), QSizeF(1, 2));
     QCOMPARE(event.deltaUnaccelerated(), QSizeF(3, 4));
     QCOMPARE(event.timestampMicroseconds(), quint64(-1));
+    QVERIFY(event.motionSamples().isEmpty());
+
+    // merged motion events keep their individual samples
+    event.setMotionSamples({{QSizeF(0.5, 1), QSizeF(1.5, 2), 10}, {QSizeF(0.5, 1), QSizeF(1.5, 2), 20}});
+    const QVector<PointerMotionSample> samples = event.motionSamples();
+    QCOMPARE(samples.count(), 2);
+    QCOMPARE(samples.first().delta, QSizeF(0.5, 1));
+    QCOMPARE(samples.first().deltaNonAccelerated, QSizeF(1.5, 2));
+    QCOMPARE(samples.first().timeMicroseconds, 10ull);
+    QCOMPARE(samples.last().timeMicroseconds, 20ull);
 }
 
 void InputEventsTest::testInitKeyEvent_data()
@@ -0,0 +1,185 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "occlusionmask.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+using namespace KWin;
+
+class OcclusionMaskTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testEmpty();
+    void testCovers_data();
+    void testCovers();
+    void testRandomRegions();
+    void testReset();
+
+    void benchmarkCulling_data();
+    void benchmarkCulling();
+
+private:
+    static QVector<QRegion> makeShapedWindows(int count, const QSize &screenSize);
+};
+
+void OcclusionMaskTest::testEmpty()
+{
+    OcclusionMask mask(QRect(0, 0, 100, 100), 10);
+    QVERIFY(mask.covers(QRegion()));
+    QVERIFY(mask.covers(QRect()));
+    QVERIFY(!mask.covers(QRect(0, 0, 1, 1)));
+    QVERIFY(!mask.covers(QRect(50, 50, 10, 10)));
+}
+
+void OcclusionMaskTest::testCovers_data()
+{
+    QTest::addColumn<QRect>("area");
+    QTest::addColumn<QRegion>("occluded");
+    QTest::addColumn<QRect>("query");
+    QTest::addColumn<bool>("covered");
+
+    const QRect area(0, 0, 100, 95);
+
+    QTest::newRow("aligned") << area << QRegion(10, 10, 20, 20) << QRect(10, 10, 20, 20) << true;
+    QTest::newRow("inside aligned") << area << QRegion(10, 10, 20, 20) << QRect(15, 12, 3, 3) << true;
+    QTest::newRow("partial tile") << area << QRegion(10, 10, 25, 20) << QRect(30, 10, 5, 5) << false;
+    QTest::newRow("unaligned") << area << QRegion(5, 5, 30, 30) << QRect(10, 10, 20, 20) << true;
+    QTest::newRow("unaligned edge") << area << QRegion(5, 5, 30, 30) << QRect(5, 5, 5, 5) << false;
+    QTest::newRow("full area") << area << QRegion(area) << area << true;
+    QTest::newRow("cut off tiles") << area << QRegion(90, 90, 10, 5) << QRect(90, 90, 10, 5) << true;
+    QTest::newRow("beyond area") << area << QRegion(-10, -10, 200, 200) << QRect(50, 50, 100, 10) << false;
+    QTest::newRow("two rects") << area << QRegion(0, 0, 20, 20).united(QRect(40, 40, 20, 20))
+                               << QRect(10, 10, 40, 40) << false;
+    QTest::newRow("adjacent rects") << area << QRegion(0, 0, 20, 20).united(QRect(20, 0, 20, 20))
+                                    << QRect(0, 0, 40, 20) << true;
+    QTest::newRow("offset area") << area.translated(1000, 500) << QRegion(1010, 510, 20, 20)
+                                 << QRect(1010, 510, 20, 20) << true;
+    QTest::newRow("wide area") << QRect(0, 0, 3000, 20) << QRegion(0, 0, 3000, 10)
+                               << QRect(0, 0, 3000, 10) << true;
+}
+
+void OcclusionMaskTest::testCovers()
+{
+    QFETCH(QRect, area);
+    QFETCH(QRegion, occluded);
+    QFETCH(QRect, query);
+
+    OcclusionMask mask(area, 10);
+    mask.add(occluded);
+    QTEST(mask.covers(query), "covered");
+    QTEST(mask.covers(QRegion(query)), "covered");
+}
+
+void OcclusionMaskTest::testRandomRegions()
+{
+    // The mask must never claim a region that isn't occluded.
+    QRandomGenerator generator(42);
+    const QRect area(0, 0, 640, 480);
+
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        OcclusionMask mask(area, 16);
+        QRegion occluded;
+        for (int i = 0; i < 20; ++i) {
+            const QRect rect(generator.bounded(area.width()), generator.bounded(area.height()),
+                             generator.bounded(1, 300), generator.bounded(1, 300));
+            occluded |= rect;
+            mask.add(rect);
+        }
+        for (int i = 0; i < 200; ++i) {
+            const QRect query(generator.bounded(area.width()), generator.bounded(area.height()),
+                              generator.bounded(1, 100), generator.bounded(1, 100));
+            if (mask.covers(query)) {
+                QVERIFY((QRegion(query) - occluded).isEmpty());
+            }
+        }
+    }
+}
+
+void OcclusionMaskTest::testReset()
+{
+    OcclusionMask mask(QRect(0, 0, 100, 100), 10);
+    mask.add(QRect(0, 0, 100, 100));
+    QVERIFY(mask.covers(QRect(0, 0, 100, 100)));
+
+    mask.reset(QRect(0, 0, 100, 100));
+    QVERIFY(!mask.covers(QRect(0, 0, 10, 10)));
+
+    mask.reset(QRect(0, 0, 200, 50));
+    QCOMPARE(mask.area(), QRect(0, 0, 200, 50));
+    mask.add(QRect(100, 0, 100, 50));
+    QVERIFY(mask.covers(QRect(150, 10, 10, 10)));
+    QVERIFY(!mask.covers(QRect(50, 10, 10, 10)));
+}
+
+QVector<QRegion> OcclusionMaskTest::makeShapedWindows(int count, const QSize &screenSize)
+{
+    // Opaque regions made of several rectangles, like windows with rounded corners or
+    // client-side decorations.
+    QRandomGenerator generator(7);
+    QVector<QRegion> windows;
+    windows.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QRect geometry(generator.bounded(screenSize.width() - 400), generator.bounded(screenSize.height() - 300),
+                             generator.bounded(200, 400), generator.bounded(150, 300));
+        QRegion shape = geometry.adjusted(0, 4, 0, -4);
+        for (int corner = 1; corner <= 4; ++corner) {
+            shape |= geometry.adjusted(corner, 4 - corner, -corner, corner - 4);
+        }
+        windows.append(shape);
+    }
+    return windows;
+}
+
+void OcclusionMaskTest::benchmarkCulling_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<bool>("useMask");
+
+    for (int count : {10, 50, 200}) {
+        QTest::newRow(qPrintable(QStringLiteral("QRegion, %1 windows").arg(count))) << count << false;
+        QTest::newRow(qPrintable(QStringLiteral("OcclusionMask, %1 windows").arg(count))) << count << true;
+    }
+}
+
+void OcclusionMaskTest::benchmarkCulling()
+{
+    // Mirrors the occlusion culling pass of Scene::paintSimpleScreen().
+    QFETCH(int, windowCount);
+    QFETCH(bool, useMask);
+
+    const QSize screenSize(1920, 1080);
+    const QVector<QRegion> windows = makeShapedWindows(windowCount, screenSize);
+    const QRect area(QPoint(0, 0), screenSize);
+    OcclusionMask mask;
+
+    QBENCHMARK {
+        QRegion allclips;
+        mask.reset(area);
+        for (int i = windows.count() - 1; i >= 0; --i) {
+            QRegion region = windows[i];
+            if (useMask && mask.covers(region)) {
+                region = QRegion();
+            } else {
+                region -= allclips;
+            }
+            if (!useMask || !mask.covers(windows[i])) {
+                allclips |= windows[i];
+                if (useMask) {
+                    mask.add(windows[i]);
+                }
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(OcclusionMaskTest)
+#include "occlusion_mask_test.moc"
@@ -0,0 +1,202 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../plugins/scenes/qpainter/displaylist.h"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPixmap>
+#include <QtTest>
+
+using namespace KWin;
+
+class QPainterDisplayListTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRasterize_data();
+    void testRasterize();
+    void testArea();
+    void testText();
+    void testEmpty();
+
+private:
+    static QImage createImage(const QSize &size);
+    static void paintScene(QPainter *painter);
+    static void paintText(QPainter *painter);
+};
+
+static const QSize s_size(300, 257);
+
+QImage QPainterDisplayListTest::createImage(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    return image;
+}
+
+void QPainterDisplayListTest::paintScene(QPainter *painter)
+{
+    // Something that looks like a frame: a background, windows with decorations and
+    // contents, a clipped and transformed window, and some text.
+    painter->fillRect(QRect(QPoint(), s_size), QColor(40, 60, 80));
+
+    QImage contents(64, 48, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < contents.height(); ++y) {
+        for (int x = 0; x < contents.width(); ++x) {
+            contents.setPixel(x, y, qRgba(x * 4, y * 5, 128, 255));
+        }
+    }
+
+    painter->save();
+    painter->setClipRegion(QRegion(10, 10, 120, 100) | QRegion(150, 30, 100, 150));
+    painter->setPen(QPen(Qt::white, 2));
+    painter->setBrush(QColor(200, 100, 50, 180));
+    painter->drawRect(QRectF(20.5, 20.5, 200, 120));
+    painter->drawImage(QRect(30, 40, 128, 96), contents);
+    painter->restore();
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->translate(150, 150);
+    painter->rotate(15);
+    painter->scale(1.5, 1.5);
+    QPainterPath clip;
+    clip.addEllipse(QRectF(-50, -40, 100, 80));
+    painter->setClipPath(clip);
+    painter->drawPixmap(QPoint(-32, -24), QPixmap::fromImage(contents));
+    painter->setOpacity(0.5);
+    painter->setPen(QPen(Qt::yellow, 3));
+    painter->drawLine(QLineF(-60, -60, 60, 60));
+    painter->drawEllipse(QRectF(-20, -20, 40, 40));
+    painter->restore();
+
+    painter->save();
+    painter->setCompositionMode(QPainter::CompositionMode_Plus);
+    QPolygonF triangle;
+    triangle << QPointF(200, 200) << QPointF(290, 250) << QPointF(180, 240);
+    painter->setBrush(QColor(0, 80, 0));
+    painter->drawPolygon(triangle);
+    painter->restore();
+
+    paintText(painter);
+}
+
+void QPainterDisplayListTest::paintText(QPainter *painter)
+{
+    painter->save();
+    QFont font = QFontDatabase::systemFont(QFontDatabase::GeneralFont);
+    font.setPixelSize(18);
+    painter->setFont(font);
+    painter->setPen(Qt::white);
+    painter->drawText(QPointF(12, 235), QStringLiteral("Hello, bands"));
+    painter->translate(240, 60);
+    painter->rotate(90);
+    painter->drawText(QPointF(0, 0), QStringLiteral("Rotated"));
+    painter->restore();
+}
+
+void QPainterDisplayListTest::testRasterize_data()
+{
+    QTest::addColumn<int>("bandCount");
+
+    QTest::newRow("single") << 1;
+    QTest::newRow("two") << 2;
+    QTest::newRow("four") << 4;
+    // Bands are never thinner than 64 pixels, the remainder ends up in the last band.
+    QTest::newRow("many") << 16;
+}
+
+void QPainterDisplayListTest::testRasterize()
+{
+    QFETCH(int, bandCount);
+
+    QImage expected = createImage(s_size);
+    QPainter painter(&expected);
+    paintScene(&painter);
+    painter.end();
+
+    QPainterDisplayList list;
+    list.reset(s_size, 1.0);
+    painter.begin(&list);
+    paintScene(&painter);
+    painter.end();
+
+    QImage result = createImage(s_size);
+    list.rasterize(&result, result.rect(), bandCount);
+    QCOMPARE(result, expected);
+}
+
+void QPainterDisplayListTest::testArea()
+{
+    QImage expected = createImage(s_size);
+    QPainter painter(&expected);
+    paintScene(&painter);
+    painter.end();
+
+    QPainterDisplayList list;
+    list.reset(s_size, 1.0);
+    painter.begin(&list);
+    paintScene(&painter);
+    painter.end();
+
+    // Only the given area is painted, the rest of the image is left alone.
+    const QRect area(50, 70, 200, 150);
+    QImage result = createImage(s_size);
+    list.rasterize(&result, area, 2);
+    QCOMPARE(result.copy(area), expected.copy(area));
+    QCOMPARE(result.copy(0, 0, s_size.width(), area.top()), createImage(QSize(s_size.width(), area.top())));
+}
+
+void QPainterDisplayListTest::testText()
+{
+    // Text is recorded as a string with its font and laid out again when it's replayed,
+    // so it looks the same as text drawn directly with the raster engine.
+    QImage expected = createImage(s_size);
+    QPainter painter(&expected);
+    paintText(&painter);
+    painter.end();
+    if (expected == createImage(s_size)) {
+        QSKIP("No font available to render text");
+    }
+
+    QPainterDisplayList list;
+    list.reset(s_size, 1.0);
+    painter.begin(&list);
+    paintText(&painter);
+    painter.end();
+
+    QImage result = createImage(s_size);
+    list.rasterize(&result, result.rect(), 4);
+    QCOMPARE(result, expected);
+}
+
+void QPainterDisplayListTest::testEmpty()
+{
+    QPainterDisplayList list;
+    list.reset(s_size, 1.0);
+
+    // Nothing has been recorded, the image isn't touched.
+    QImage result = createImage(s_size);
+    list.rasterize(&result, result.rect(), 4);
+    QCOMPARE(result, createImage(s_size));
+
+    // The commands are dropped after they have been rasterized.
+    QPainter painter(&list);
+    paintScene(&painter);
+    painter.end();
+    list.rasterize(&result, result.rect(), 4);
+    QImage second = createImage(s_size);
+    list.rasterize(&second, second.rect(), 4);
+    QCOMPARE(second, createImage(s_size));
+}
+
+QTEST_MAIN(QPainterDisplayListTest)
+#include "qpainter_displaylist_test.moc"
@@ -8,6 +8,7 @@
 */
 #include "composite.h"
 
+#include "abstract_output.h"
 #include "dbusinterface.h"
 #include "x11client.h"
 #include "decorations/decoratedclient.h"
@@ -16,6 +17,7 @@
 #include "internal_client.h"
 #include "overlaywindow.h"
 #include "platform.h"
+#include "renderloop.h"
 #include "scene.h"
 #include "screens.h"
 #include "shadow.h"
@@ -44,7 +46,6 @@
 #include <QQuickWindow>
 #include <QtConcurrentRun>
 #include <QTextStream>
-#include <QTimerEvent>
 
 #include <xcb/composite.h>
 #include <xcb/damage.h>
@@ -111,12 +112,9 @@ Compositor::Compositor(QObject* workspace)
     : QObject(workspace)
     , m_state(State::Off)
     , m_selectionOwner(nullptr)
-    , vBlankInterval(0)
-    , fpsInterval(0)
-    , m_timeSinceLastVBlank(0)
+    , m_maxFpsInterval(0)
     , m_scene(nullptr)
-    , m_bufferSwapPending(false)
-    , m_composeAtSwapCompletion(false)
+    , m_renderLoop(new RenderLoop(nullptr, this))
 {
     connect(options, &Options::configChanged, this, &Compositor::configChanged);
     connect(options, &Options::animationSpeedChanged, this, &Compositor::configChanged);
@@ -158,6 +156,7 @@ Compositor::Compositor(QObject* workspace)
 
     // register DBus
     new CompositorDBusInterface(this);
+    new FrameStatisticsDBusInterface(this);
 }
 
 Compositor::~Compositor()
@@ -336,17 +335,16 @@ void Compositor::startupWithWorkspace()
     Workspace::self()->markXStackingOrderAsDirty();
     Q_ASSERT(m_scene);
 
-    connect(workspace(), &Workspace::destroyed, this, [this] { compositeTimer.stop(); });
-    fpsInterval = options->maxFpsInterval();
+    connect(workspace(), &Workspace::destroyed, this, [this] {
+        for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+            renderLoop->cancelFrame();
+        }
+    });
+    m_maxFpsInterval = options->maxFpsInterval();
 
-    if (m_scene->syncsToVBlank()) {
-        // If we do vsync, set the fps to the next multiple of the vblank rate.
-        vBlankInterval = milliToNano(1000) / currentRefreshRate();
-        fpsInterval = qMax((fpsInterval / vBlankInterval) * vBlankInterval, vBlankInterval);
-    } else {
-        // No vsync - DO NOT set "0", would cause div-by-zero segfaults.
-        vBlankInterval = milliToNano(1);
-    }
+    m_perOutputRenderLoops = m_scene->hasPerOutputRenderLoops();
+    connect(screens(), &Screens::changed, this, &Compositor::updateRenderLoops, Qt::UniqueConnection);
+    updateRenderLoops();
 
     // Sets also the 'effects' pointer.
     kwinApp()->platform()->createEffectsHandler(this, m_scene);
@@ -383,13 +381,77 @@ void Compositor::startupWithWorkspace()
 
     // Render at least once.
     addRepaintFull();
-    performCompositing();
+    const QVector<RenderLoop *> renderLoops = m_renderLoops;
+    for (RenderLoop *renderLoop : renderLoops) {
+        performCompositing(renderLoop);
+    }
+}
+
+void Compositor::updateRenderLoops()
+{
+    for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+        renderLoop->cancelFrame();
+        disconnect(renderLoop, nullptr, this, nullptr);
+    }
+    m_renderLoops.clear();
+
+    if (!m_scene) {
+        return;
+    }
+
+    if (m_perOutputRenderLoops) {
+        const auto outputs = kwinApp()->platform()->enabledOutputs();
+        for (AbstractOutput *output : outputs) {
+            m_renderLoops.append(output->renderLoop());
+        }
+    } else {
+        m_renderLoops.append(m_renderLoop);
+    }
+
+    for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+        connect(renderLoop, &RenderLoop::frameRequested, this, &Compositor::performCompositing);
+        connect(renderLoop, &RenderLoop::frameCompleted, this, &Compositor::handleFrameCompleted);
+        // The output might go away before the screens are updated.
+        connect(renderLoop, &QObject::destroyed, this, [this, renderLoop]() {
+            m_renderLoops.removeOne(renderLoop);
+        });
+    }
+
+    if (m_state == State::On) {
+        addRepaintFull();
+    }
+}
+
+RenderLoop *Compositor::renderLoopForOutput(AbstractOutput *output) const
+{
+    if (m_perOutputRenderLoops && output) {
+        return output->renderLoop();
+    }
+    return m_renderLoop;
+}
+
+bool Compositor::hasPerOutputRenderLoops() const
+{
+    return m_perOutputRenderLoops;
+}
+
+QVector<RenderLoop *> Compositor::renderLoops() const
+{
+    return m_renderLoops;
 }
 
 void Compositor::scheduleRepaint()
 {
-    if (!compositeTimer.isActive())
-        setCompositeTimer();
+    for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+        scheduleRepaint(renderLoop);
+    }
+}
+
+void Compositor::scheduleRepaint(RenderLoop *renderLoop)
+{
+    if (!renderLoop->isFrameScheduled()) {
+        setCompositeTimer(renderLoop);
+    }
 }
 
 void Compositor::stop()
@@ -447,8 +509,12 @@ void Compositor::stop()
 
     delete m_scene;
     m_scene = nullptr;
-    compositeTimer.stop();
-    repaints_region = QRegion();
+    for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+        renderLoop->cancelFrame();
+        renderLoop->resetRepaints();
+        disconnect(renderLoop, nullptr, this, nullptr);
+    }
+    m_renderLoops.clear();
 
     m_state = State::Off;
     emit compositingToggled(false);
@@ -531,20 +597,12 @@ void Compositor::reinitialize()
 
 void Compositor::addRepaint(int x, int y, int w, int h)
 {
-    if (m_state != State::On) {
-        return;
-    }
-    repaints_region += QRegion(x, y, w, h);
-    scheduleRepaint();
+    addRepaint(QRegion(x, y, w, h));
 }
 
 void Compositor::addRepaint(const QRect& r)
 {
-    if (m_state != State::On) {
-        return;
-    }
-    repaints_region += r;
-    scheduleRepaint();
+    addRepaint(QRegion(r));
 }
 
 void Compositor::addRepaint(const QRegion& r)
@@ -552,8 +610,11 @@ void Compositor::addRepaint(const QRegion& r)
     if (m_state != State::On) {
         return;
     }
-    repaints_region += r;
-    scheduleRepaint();
+    for (RenderLoop *renderLoop : qAsConst(m_renderLoops)) {
+        if (renderLoop->addRepaint(r)) {
+            scheduleRepaint(renderLoop);
+        }
+    }
 }
 
 void Compositor::addRepaintFull()
@@ -562,52 +623,58 @@ void Compositor::addRepaintFull()
         return;
     }
     const QSize &s = screens()->size();
-    repaints_region = QRegion(0, 0, s.width(), s.height());
-    scheduleRepaint();
+    addRepaint(QRegion(0, 0, s.width(), s.height()));
 }
 
-void Compositor::timerEvent(QTimerEvent *te)
+void Compositor::aboutToSwapBuffers()
 {
-    if (te->timerId() == compositeTimer.timerId()) {
-        performCompositing();
-    } else
-        QObject::timerEvent(te);
+    m_renderLoop->beginFrame();
 }
 
-void Compositor::aboutToSwapBuffers()
+void Compositor::bufferSwapComplete()
 {
-    Q_ASSERT(!m_bufferSwapPending);
+    m_renderLoop->endFrame();
+}
 
-    m_bufferSwapPending = true;
+void Compositor::aboutToSwapBuffers(AbstractOutput *output)
+{
+    renderLoopForOutput(output)->beginFrame();
 }
 
-void Compositor::bufferSwapComplete()
+void Compositor::bufferSwapComplete(AbstractOutput *output, qint64 presentationTimestamp)
 {
-    Q_ASSERT(m_bufferSwapPending);
-    m_bufferSwapPending = false;
+    renderLoopForOutput(output)->endFrame(presentationTimestamp);
+}
 
+void Compositor::handleFrameCompleted(RenderLoop *renderLoop)
+{
     emit bufferSwapCompleted();
 
-    if (m_composeAtSwapCompletion) {
-        m_composeAtSwapCompletion = false;
-        performCompositing();
+    if (renderLoop->composeAtSwapCompletion()) {
+        renderLoop->setComposeAtSwapCompletion(false);
+        if (usesFrameTimingPrediction(renderLoop)) {
+            // Start painting as late as possible before the next vblank.
+            scheduleRepaint(renderLoop);
+        } else {
+            performCompositing(renderLoop);
+        }
     }
 }
 
-void Compositor::performCompositing()
+void Compositor::performCompositing(RenderLoop *renderLoop)
 {
     // If a buffer swap is still pending, we return to the event loop and
     // continue processing events until the swap has completed.
-    if (m_bufferSwapPending) {
-        m_composeAtSwapCompletion = true;
-        compositeTimer.stop();
+    if (renderLoop->isFramePending()) {
+        renderLoop->setComposeAtSwapCompletion(true);
+        renderLoop->cancelFrame();
         return;
     }
 
     // If outputs are disabled, we return to the event loop and
     // continue processing events until the outputs are enabled again
     if (!kwinApp()->platform()->areOutputsEnabled()) {
-        compositeTimer.stop();
+        renderLoop->cancelFrame();
         return;
     }
 
@@ -651,14 +718,36 @@ void Compositor::performCompositing()
         win->getDamageRegionReply();
     }
 
-    if (repaints_region.isEmpty() && !windowRepaintsPending()) {
-        m_scene->idle();
-        m_timeSinceLastVBlank = fpsInterval - (options->vBlankTime() + 1); // means "start now"
+    if (m_perOutputRenderLoops) {
+        // Window repaints are shared by all outputs. Hand them over to the render loops,
+        // otherwise painting one output would reset repaints still needed by the others.
+        for (Toplevel *win : qAsConst(windows)) {
+            if (!win->readyForPainting()) {
+                continue;
+            }
+            const QRegion repaints = win->repaints();
+            if (!repaints.isEmpty()) {
+                win->resetRepaints();
+                addRepaint(repaints);
+            }
+        }
+    }
+
+    if (renderLoop->repaints().isEmpty() && (m_perOutputRenderLoops || !windowRepaintsPending())) {
+        // Other outputs might still be animating, only go idle if none of them is busy.
+        const bool busy = std::any_of(m_renderLoops.constBegin(), m_renderLoops.constEnd(),
+            [renderLoop](RenderLoop *loop) {
+                return loop != renderLoop && (loop->isFrameScheduled() || !loop->repaints().isEmpty());
+            });
+        if (!busy) {
+            m_scene->idle();
+        }
+        renderLoop->setTimeSinceLastVBlank(fpsInterval(renderLoop) - (options->vBlankTime() + 1)); // means "start now"
         // Note: It would seem here we should undo suspended unredirect, but when scenes need
         // it for some reason, e.g. transformations or translucency, the next pass that does not
         // need this anymore and paints normally will also reset the suspended unredirect.
         // Otherwise the window would not be painted normally anyway.
-        compositeTimer.stop();
+        renderLoop->cancelFrame();
         return;
     }
 
@@ -679,14 +768,28 @@ void Compositor::performCompositing()
         }
     }
 
-    QRegion repaints = repaints_region;
+    QRegion repaints = renderLoop->repaints();
     // clear all repaints, so that post-pass can add repaints for the next repaint
-    repaints_region = QRegion();
+    renderLoop->resetRepaints();
+
+    int screenId = -1;
+    if (renderLoop->output()) {
+        screenId = kwinApp()->platform()->enabledOutputs().indexOf(renderLoop->output());
+    }
 
     if (m_framesToTestForSafety > 0 && (m_scene->compositingType() & OpenGLCompositing)) {
         kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PreFrame);
     }
-    m_timeSinceLastVBlank = m_scene->paint(repaints, windows);
+    FrameStatistics *statistics = renderLoop->statistics();
+    statistics->beginFrame();
+    const qint64 renderTime = m_scene->paint(screenId, repaints, windows);
+    renderLoop->setTimeSinceLastVBlank(renderTime);
+    renderLoop->addRenderTime(renderTime);
+
+    const Scene::PaintTimes paintTimes = m_scene->takePaintTimes();
+    statistics->setPreviousGpuDuration(paintTimes.previousGpu);
+    statistics->setPaintTimes(paintTimes.prePaintStartTime, paintTimes.prePaint, paintTimes.paint);
+    statistics->endRendering();
     if (m_framesToTestForSafety > 0) {
         if (m_scene->compositingType() & OpenGLCompositing) {
             kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PostFrame);
@@ -700,7 +803,15 @@ void Compositor::performCompositing()
 
     if (waylandServer()) {
         const auto currentTime = static_cast<quint32>(m_monotonicClock.elapsed());
+        const QRect outputGeometry = renderLoop->geometry();
         for (Toplevel *win : qAsConst(windows)) {
+            // Only throttle clients by the output they are shown on. Windows that aren't on
+            // any output are throttled by the first one, they'd never get a frame otherwise.
+            if (renderLoop->output() && !win->frameGeometry().intersects(outputGeometry)) {
+                if (renderLoop != m_renderLoops.constFirst() || isOnAnyOutput(win)) {
+                    continue;
+                }
+            }
             if (auto surface = win->surface()) {
                 surface->frameRendered(currentTime);
             }
@@ -709,19 +820,28 @@ void Compositor::performCompositing()
 
     // Stop here to ensure *we* cause the next repaint schedule - not some effect
     // through m_scene->paint().
-    compositeTimer.stop();
+    renderLoop->cancelFrame();
 
     // Trigger at least one more pass even if there would be nothing to paint, so that scene->idle()
     // is called the next time. If there would be nothing pending, it will not restart the timer and
     // scheduleRepaint() would restart it again somewhen later, called from functions that
     // would again add something pending.
-    if (m_bufferSwapPending && m_scene->syncsToVBlank()) {
-        m_composeAtSwapCompletion = true;
+    if (renderLoop->isFramePending() && m_scene->syncsToVBlank()) {
+        renderLoop->setComposeAtSwapCompletion(true);
     } else {
-        scheduleRepaint();
+        scheduleRepaint(renderLoop);
     }
 }
 
+bool Compositor::isOnAnyOutput(Toplevel *window) const
+{
+    const QRect frameGeometry = window->frameGeometry();
+    return std::any_of(m_renderLoops.constBegin(), m_renderLoops.constEnd(),
+                       [&frameGeometry](RenderLoop *renderLoop) {
+                           return frameGeometry.intersects(renderLoop->geometry());
+                       });
+}
+
 template <class T>
 static bool repaintsPending(const QList<T*> &windows)
 {
@@ -759,14 +879,47 @@ bool Compositor::windowRepaintsPending() const
     return false;
 }
 
-void Compositor::setCompositeTimer()
+qint64 Compositor::vBlankInterval(const RenderLoop *renderLoop) const
+{
+    if (!m_scene->syncsToVBlank()) {
+        // No vsync - DO NOT return "0", would cause div-by-zero segfaults.
+        return milliToNano(1);
+    }
+    int refreshRate = renderLoop->output() ? renderLoop->output()->refreshRate()
+                                           : currentRefreshRate() * 1000;
+    if (refreshRate <= 0) {
+        refreshRate = 60000;
+    }
+    // The refresh rate is in mHz.
+    return milliToNano(1000) * 1000 / refreshRate;
+}
+
+qint64 Compositor::fpsInterval(const RenderLoop *renderLoop) const
+{
+    if (!m_scene->syncsToVBlank()) {
+        return m_maxFpsInterval;
+    }
+    // If we do vsync, set the fps to the next multiple of the vblank rate.
+    const qint64 vBlankInterval = this->vBlankInterval(renderLoop);
+    return qMax((m_maxFpsInterval / vBlankInterval) * vBlankInterval, vBlankInterval);
+}
+
+bool Compositor::usesFrameTimingPrediction(const RenderLoop *renderLoop) const
+{
+    // The prediction needs to know when frames are presented, which is only the
+    // case if buffer swaps complete asynchronously.
+    return m_scene->syncsToVBlank() && !m_scene->blocksForRetrace()
+        && renderLoop->lastPresentationTimestamp() > 0;
+}
+
+void Compositor::setCompositeTimer(RenderLoop *renderLoop)
 {
     if (m_state != State::On) {
         return;
     }
 
     // Don't start the timer if we're waiting for a swap event
-    if (m_bufferSwapPending && m_composeAtSwapCompletion)
+    if (renderLoop->isFramePending() && renderLoop->composeAtSwapCompletion())
         return;
 
     // Don't start the timer if all outputs are disabled
@@ -774,8 +927,37 @@ void Compositor::setCompositeTimer()
         return;
     }
 
+    const qint64 vBlankInterval = this->vBlankInterval(renderLoop);
+    const qint64 fpsInterval = this->fpsInterval(renderLoop);
+    const qint64 timeSinceLastVBlank = renderLoop->timeSinceLastVBlank();
     uint waitTime = 1;
 
+    if (usesFrameTimingPrediction(renderLoop)) {
+        const qint64 now = RenderLoop::currentTime();
+
+        // The earliest vblank the next frame may be presented at.
+        qint64 nextPresentation = renderLoop->lastPresentationTimestamp() + fpsInterval;
+        if (nextPresentation < now) {
+            nextPresentation += ((now - nextPresentation) / vBlankInterval + 1) * vBlankInterval;
+        }
+        renderLoop->statistics()->setTargetPresentationTime(nextPresentation, vBlankInterval);
+
+        // Start compositing so that the frame is finished just before the vblank, plus some
+        // slack for the page flip. Without any measurements fall back to the configured time.
+        qint64 renderTime = renderLoop->predictedRenderTime();
+        if (renderTime < 0) {
+            renderTime = options->vBlankTime();
+        } else {
+            renderTime += milliToNano(1);
+        }
+
+        const qint64 startTime = nextPresentation - renderTime;
+        // If we are already late, start right away.
+        waitTime = startTime > now ? uint((startTime - now) / (1000 * 1000)) : 0;
+        renderLoop->scheduleFrame(qMin(waitTime, 250u));
+        return;
+    }
+
     if (m_scene->blocksForRetrace()) {
 
         // TODO: make vBlankTime dynamic?!
@@ -784,7 +966,7 @@ void Compositor::setCompositeTimer()
         // Now, my ooold 19" CRT can do such retrace so that 2ms are entirely sufficient,
         // while another ooold 15" TFT requires about 6ms
 
-        qint64 padding = m_timeSinceLastVBlank;
+        qint64 padding = timeSinceLastVBlank;
         if (padding > fpsInterval) {
             // We're at low repaints or spent more time in painting than the user wanted to wait
             // for that frame. Align to next vblank:
@@ -804,8 +986,8 @@ void Compositor::setCompositeTimer()
         }
     }
     else { // w/o blocking vsync we just jump to the next demanded tick
-        if (fpsInterval > m_timeSinceLastVBlank) {
-            waitTime = nanoToMilli(fpsInterval - m_timeSinceLastVBlank);
+        if (fpsInterval > timeSinceLastVBlank) {
+            waitTime = nanoToMilli(fpsInterval - timeSinceLastVBlank);
             if (!waitTime) {
                 // Will ensure we don't block out the eventloop - the system's just not faster ...
                 waitTime = 1;
@@ -831,7 +1013,7 @@ void Compositor::setCompositeTimer()
         }
     }
     // Force 4fps minimum:
-    compositeTimer.start(qMin(waitTime, 250u), this);
+    renderLoop->scheduleFrame(qMin(waitTime, 250u));
 }
 
 bool Compositor::isActive()
@@ -962,13 +1144,13 @@ void X11Compositor::start()
     m_xrrRefreshRate = KWin::currentRefreshRate();
     startupWithWorkspace();
 }
-void X11Compositor::performCompositing()
+void X11Compositor::performCompositing(RenderLoop *renderLoop)
 {
     if (scene()->usesOverlayWindow() && !isOverlayWindowVisible()) {
         // Return since nothing is visible.
         return;
     }
-    Compositor::performCompositing();
+    Compositor::performCompositing(renderLoop);
 }
 
 bool X11Compositor::checkForOverlayWindow(WId w) const
@@ -14,13 +14,15 @@
 #include <QObject>
 #include <QElapsedTimer>
 #include <QTimer>
-#include <QBasicTimer>
 #include <QRegion>
 
 namespace KWin
 {
+class AbstractOutput;
 class CompositorSelectionOwner;
+class RenderLoop;
 class Scene;
+class Toplevel;
 class X11Client;
 
 class KWIN_EXPORT Compositor : public QObject
@@ -61,6 +63,35 @@ public:
      */
     void bufferSwapComplete();
 
+    /**
+     * Notifies the compositor that a page flip on the given @p output is about to be
+     * scheduled. Only the RenderLoop of @p output will be blocked until
+     * bufferSwapComplete() is called for the same output.
+     *
+     * Must only be used if hasPerOutputRenderLoops() returns @c true.
+     */
+    void aboutToSwapBuffers(AbstractOutput *output);
+
+    /**
+     * Notifies the compositor that a pending page flip on the given @p output has completed.
+     *
+     * @p presentationTimestamp is the time the frame has been shown at, in nanoseconds on
+     * the CLOCK_MONOTONIC clock, or @c 0 if unknown.
+     *
+     * Must only be used if hasPerOutputRenderLoops() returns @c true.
+     */
+    void bufferSwapComplete(AbstractOutput *output, qint64 presentationTimestamp = 0);
+
+    /**
+     * Whether every output is scheduled by its own RenderLoop. If @c false, a single
+     * RenderLoop drives all outputs at once.
+     */
+    bool hasPerOutputRenderLoops() const;
+    /**
+     * Returns the render loops that are currently driven by the compositor.
+     */
+    QVector<RenderLoop *> renderLoops() const;
+
     /**
      * Toggles compositing, that is if the Compositor is suspended it will be resumed
      * and if the Compositor is active it will be suspended.
@@ -107,7 +138,6 @@ Q_SIGNALS:
 
 protected:
     explicit Compositor(QObject *parent = nullptr);
-    void timerEvent(QTimerEvent *te) override;
 
     virtual void start() = 0;
     void stop();
@@ -121,7 +151,7 @@ protected:
      * Continues the startup after Scene And Workspace are created
      */
     void startupWithWorkspace();
-    virtual void performCompositing();
+    virtual void performCompositing(RenderLoop *renderLoop);
 
     virtual void configChanged();
 
@@ -133,28 +163,35 @@ private:
     void initializeX11();
     void cleanupX11();
 
-    void setCompositeTimer();
+    void scheduleRepaint(RenderLoop *renderLoop);
+    void setCompositeTimer(RenderLoop *renderLoop);
+    bool isOnAnyOutput(Toplevel *window) const;
     bool windowRepaintsPending() const;
+    qint64 vBlankInterval(const RenderLoop *renderLoop) const;
+    qint64 fpsInterval(const RenderLoop *renderLoop) const;
+    bool usesFrameTimingPrediction(const RenderLoop *renderLoop) const;
+
+    void updateRenderLoops();
+    void handleFrameCompleted(RenderLoop *renderLoop);
+    RenderLoop *renderLoopForOutput(AbstractOutput *output) const;
 
     void releaseCompositorSelection();
     void deleteUnusedSupportProperties();
 
     State m_state;
 
-    QBasicTimer compositeTimer;
     CompositorSelectionOwner *m_selectionOwner;
     QTimer m_releaseSelectionTimer;
     QList<xcb_atom_t> m_unusedSupportProperties;
     QTimer m_unusedSupportPropertyTimer;
-    qint64 vBlankInterval, fpsInterval;
-    QRegion repaints_region;
-
-    qint64 m_timeSinceLastVBlank;
+    qint64 m_maxFpsInterval;
 
     Scene *m_scene;
 
-    bool m_bufferSwapPending;
-    bool m_composeAtSwapCompletion;
+    // Drives all outputs at once if the scene cannot present outputs individually.
+    RenderLoop *m_renderLoop;
+    QVector<RenderLoop *> m_renderLoops;
+    bool m_perOutputRenderLoops = false;
 
     int m_framesToTestForSafety = 3;
     QElapsedTimer m_monotonicClock;
@@ -248,7 +285,7 @@ public:
 
 protected:
     void start() override;
-    void performCompositing() override;
+    void performCompositing(RenderLoop *renderLoop) override;
 
 private:
     explicit X11Compositor(QObject *parent);
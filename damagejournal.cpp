@@ -0,0 +1,147 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "damagejournal.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+DamageJournal::DamageJournal(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+    m_log.resize(m_capacity);
+}
+
+int DamageJournal::capacity() const
+{
+    return m_capacity;
+}
+
+void DamageJournal::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (m_capacity == capacity) {
+        return;
+    }
+    m_capacity = capacity;
+    m_log = QVector<QRegion>(capacity);
+    clear();
+}
+
+void DamageJournal::setCoarsening(int count, int tileSize)
+{
+    m_maxRectCount = count;
+    m_tileSize = tileSize;
+}
+
+void DamageJournal::add(const QRegion &region)
+{
+    m_head = (m_head + 1) % m_capacity;
+    m_log[m_head] = coarsenIfComplex(region);
+    m_count = qMin(m_count + 1, m_capacity);
+}
+
+void DamageJournal::clear()
+{
+    for (QRegion &region : m_log) {
+        region = QRegion();
+    }
+    m_head = 0;
+    m_count = 0;
+}
+
+QRegion DamageJournal::accumulate(int bufferAge, const QRegion &fallback) const
+{
+    // Note: An age of zero means the buffer contents are undefined. Until a frame has been
+    // added, the journal doesn't know what the buffer contains either.
+    if (bufferAge <= 0 || bufferAge > m_count) {
+        return fallback;
+    }
+
+    QRegion region;
+    for (int i = 0; i < bufferAge - 1; ++i) {
+        region |= m_log[(m_head - i + m_capacity) % m_capacity];
+    }
+    return coarsenIfComplex(region);
+}
+
+QRegion DamageJournal::coarsenIfComplex(const QRegion &region) const
+{
+    if (m_tileSize <= 0 || region.rectCount() <= m_maxRectCount) {
+        return region;
+    }
+    return coarsened(region, m_tileSize);
+}
+
+QRegion DamageJournal::coarsened(const QRegion &region, int tileSize)
+{
+    if (region.isEmpty()) {
+        return region;
+    }
+
+    const QRect bounds = region.boundingRect();
+    const auto tileFloor = [tileSize](int value) {
+        return value >= 0 ? value / tileSize : -((-value + tileSize - 1) / tileSize);
+    };
+    const int firstColumn = tileFloor(bounds.left());
+    const int firstRow = tileFloor(bounds.top());
+    const int columns = tileFloor(bounds.right()) - firstColumn + 1;
+    const int rows = tileFloor(bounds.bottom()) - firstRow + 1;
+
+    QVector<bool> tiles(columns * rows, false);
+    for (const QRect &rect : region) {
+        const int left = tileFloor(rect.left()) - firstColumn;
+        const int right = tileFloor(rect.right()) - firstColumn;
+        const int top = tileFloor(rect.top()) - firstRow;
+        const int bottom = tileFloor(rect.bottom()) - firstRow;
+        for (int row = top; row <= bottom; ++row) {
+            std::fill(tiles.begin() + row * columns + left, tiles.begin() + row * columns + right + 1, true);
+        }
+    }
+
+    // Emit one rectangle per run of tiles. Rows with the same runs as the row above extend
+    // the rectangles of that row, as QRegion::setRects() expects a minimal banded region.
+    QVector<QRect> rects;
+    int bandStart = 0;
+    int bandRow = -1;
+    for (int row = 0; row < rows; ++row) {
+        const bool *tile = tiles.constData() + row * columns;
+        if (bandRow != -1 && std::equal(tile, tile + columns, tiles.constData() + bandRow * columns)) {
+            for (int i = bandStart; i < rects.count(); ++i) {
+                rects[i].setBottom(rects[i].bottom() + tileSize);
+            }
+            continue;
+        }
+        bandStart = rects.count();
+        bandRow = row;
+        int column = 0;
+        while (column < columns) {
+            if (!tile[column]) {
+                ++column;
+                continue;
+            }
+            const int start = column;
+            while (column < columns && tile[column]) {
+                ++column;
+            }
+            rects.append(QRect((firstColumn + start) * tileSize, (firstRow + row) * tileSize,
+                               (column - start) * tileSize, tileSize));
+        }
+        if (bandStart == rects.count()) {
+            bandRow = -1;
+        }
+    }
+
+    QRegion result;
+    result.setRects(rects.constData(), rects.count());
+    return result;
+}
+
+} // namespace KWin
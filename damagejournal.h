@@ -0,0 +1,77 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_DAMAGEJOURNAL_H
+#define KWIN_DAMAGEJOURNAL_H
+
+#include <kwin_export.h>
+
+#include <QRegion>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The DamageJournal class remembers the damage of the last frames presented on an output.
+ *
+ * With buffer age, the back buffer handed out for the next frame contains the frame that was
+ * presented bufferAge frames ago. Repairing it requires the union of the damage of all frames
+ * presented since then, which is what accumulate() returns.
+ *
+ * Damage made of many small rectangles is coarsened to a grid of tiles before it is stored,
+ * so a busy frame doesn't make the following frames expensive to accumulate and to paint.
+ */
+class KWIN_EXPORT DamageJournal
+{
+public:
+    explicit DamageJournal(int capacity = 10);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    /**
+     * Damage with more than @p count rectangles gets coarsened to tiles of @p tileSize.
+     */
+    void setCoarsening(int count, int tileSize);
+
+    /**
+     * Adds the damage of the frame that has just been presented.
+     */
+    void add(const QRegion &region);
+    /**
+     * Forgets all damage, the next accumulate() call returns its fallback.
+     */
+    void clear();
+
+    /**
+     * Returns the damage that needs to be repaired in a buffer of the given @p bufferAge. If
+     * the buffer contents are undefined or not covered by the journal, @p fallback is returned.
+     */
+    QRegion accumulate(int bufferAge, const QRegion &fallback) const;
+
+    /**
+     * Returns @p region with every rectangle extended to a grid of @p tileSize, adjacent tiles
+     * are merged into larger rectangles.
+     */
+    static QRegion coarsened(const QRegion &region, int tileSize);
+
+private:
+    QRegion coarsenIfComplex(const QRegion &region) const;
+
+    QVector<QRegion> m_log;
+    int m_capacity;
+    int m_head = 0;
+    int m_count = 0;
+    int m_maxRectCount = 32;
+    int m_tileSize = 64;
+};
+
+} // namespace KWin
+
+#endif
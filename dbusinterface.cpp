@@ -10,10 +10,12 @@
 // own
 #include "dbusinterface.h"
 #include "compositingadaptor.h"
+#include "framestatisticsadaptor.h"
 #include "virtualdesktopmanageradaptor.h"
 
 // kwin
 #include "abstract_client.h"
+#include "abstract_output.h"
 #include "atoms.h"
 #include "composite.h"
 #include "debug_console.h"
@@ -21,6 +23,7 @@
 #include "placement.h"
 #include "platform.h"
 #include "kwinadaptor.h"
+#include "renderloop.h"
 #include "scene.h"
 #include "workspace.h"
 #include "virtualdesktops.h"
@@ -31,6 +34,8 @@
 // Qt
 #include <QOpenGLContext>
 #include <QDBusServiceWatcher>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 namespace KWin
 {
@@ -335,6 +340,66 @@ QStringList CompositorDBusInterface::supportedOpenGLPlatformInterfaces() const
 
 
 
+FrameStatisticsDBusInterface::FrameStatisticsDBusInterface(Compositor *parent)
+    : QObject(parent)
+    , m_compositor(parent)
+{
+    new FrameStatisticsAdaptor(this);
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FrameStatistics"), this);
+}
+
+static QString renderLoopName(RenderLoop *renderLoop)
+{
+    if (renderLoop->output()) {
+        return renderLoop->output()->name();
+    }
+    return QStringLiteral("all");
+}
+
+QVariantMap FrameStatisticsDBusInterface::statistics() const
+{
+    QVariantMap statistics;
+    const auto renderLoops = m_compositor->renderLoops();
+    for (RenderLoop *renderLoop : renderLoops) {
+        statistics.insert(renderLoopName(renderLoop), renderLoop->statistics()->summary());
+    }
+    return statistics;
+}
+
+QString FrameStatisticsDBusInterface::trace() const
+{
+    QJsonArray events;
+    const auto renderLoops = m_compositor->renderLoops();
+    for (int i = 0; i < renderLoops.count(); ++i) {
+        // Every output shows up as its own thread in the trace viewer.
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), 0},
+            {QStringLiteral("tid"), i},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), renderLoopName(renderLoops[i])}}},
+        });
+        const QJsonArray frameEvents = renderLoops[i]->statistics()->traceEvents(i);
+        for (const QJsonValue &event : frameEvents) {
+            events.append(event);
+        }
+    }
+
+    const QJsonObject trace{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    };
+    return QString::fromUtf8(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+}
+
+void FrameStatisticsDBusInterface::reset()
+{
+    const auto renderLoops = m_compositor->renderLoops();
+    for (RenderLoop *renderLoop : renderLoops) {
+        renderLoop->statistics()->clear();
+    }
+}
+
 VirtualDesktopManagerDBusInterface::VirtualDesktopManagerDBusInterface(VirtualDesktopManager *parent)
     : QObject(parent)
     , m_manager(parent)
@@ -168,6 +168,40 @@ private:
     Compositor *m_compositor;
 };
 
+/**
+ * @brief Exports the frame timing statistics of the render loops on the D-Bus as object
+ * /FrameStatistics.
+ */
+class FrameStatisticsDBusInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.FrameStatistics")
+
+public:
+    explicit FrameStatisticsDBusInterface(Compositor *parent);
+    ~FrameStatisticsDBusInterface() override = default;
+
+public Q_SLOTS:
+    /**
+     * @brief Returns the minimum, average and maximum frame timings of every output, in
+     * nanoseconds, keyed by the output name.
+     */
+    QVariantMap statistics() const;
+    /**
+     * @brief Returns the recent frames of all outputs in the Chrome trace event format.
+     *
+     * The returned JSON can be loaded into chrome://tracing or the Perfetto UI.
+     */
+    QString trace() const;
+    /**
+     * @brief Discards all recorded frames.
+     */
+    void reset();
+
+private:
+    Compositor *m_compositor;
+};
+
 //TODO: disable all of this in case of kiosk?
 
 class VirtualDesktopManagerDBusInterface : public QObject
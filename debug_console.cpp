@@ -8,6 +8,7 @@
 */
 #include "debug_console.h"
 #include "composite.h"
+#include "effects.h"
 #include "x11client.h"
 #include "input_event.h"
 #include "internal_client.h"
@@ -35,9 +36,12 @@
 #include <KLocalizedString>
 #include <NETWM>
 // Qt
+#include <QHeaderView>
 #include <QMouseEvent>
 #include <QMetaProperty>
 #include <QMetaType>
+#include <QStandardItemModel>
+#include <QTimer>
 
 // xkb
 #include <xkbcommon/xkbcommon.h>
@@ -591,6 +595,13 @@ DebugConsole::DebugConsole()
                 updateKeyboardTab();
                 connect(input(), &InputRedirection::keyStateChanged, this, &DebugConsole::updateKeyboardTab);
             }
+            // only poll the effect timings while they are shown
+            if (index == 6) {
+                updateEffectsTab();
+                m_effectTimingsTimer->start();
+            } else {
+                m_effectTimingsTimer->stop();
+            }
         }
     );
 
@@ -598,6 +609,7 @@ DebugConsole::DebugConsole()
     setWindowFlags(Qt::X11BypassWindowManagerHint);
 
     initGLTab();
+    initEffectsTab();
 }
 
 DebugConsole::~DebugConsole() = default;
@@ -634,6 +646,79 @@ void DebugConsole::initGLTab()
     m_ui->openGLExtensionsLabel->setText(extensionsString(openGLExtensions()));
 }
 
+void DebugConsole::initEffectsTab()
+{
+    m_effectTimingsModel = new QStandardItemModel(this);
+    m_effectTimingsModel->setHorizontalHeaderLabels({
+        i18n("Effect"),
+        i18n("CPU Average (ms)"),
+        i18n("CPU Maximum (ms)"),
+        i18n("GPU Average (ms)"),
+        i18n("GPU Maximum (ms)"),
+        i18n("Frames"),
+    });
+    m_ui->effectTimingsView->setModel(m_effectTimingsModel);
+    m_ui->effectTimingsView->sortByColumn(1, Qt::DescendingOrder);
+
+    if (effects) {
+        m_ui->effectProfilingCheckBox->setChecked(static_cast<EffectsHandlerImpl *>(effects)->isProfilingEnabled());
+    }
+    connect(m_ui->effectProfilingCheckBox, &QCheckBox::toggled, this,
+        [] (bool checked) {
+            if (effects) {
+                static_cast<EffectsHandlerImpl *>(effects)->setProfilingEnabled(checked);
+            }
+        }
+    );
+
+    m_effectTimingsTimer = new QTimer(this);
+    m_effectTimingsTimer->setInterval(1000);
+    connect(m_effectTimingsTimer, &QTimer::timeout, this, &DebugConsole::updateEffectsTab);
+}
+
+void DebugConsole::updateEffectsTab()
+{
+    m_effectTimingsModel->removeRows(0, m_effectTimingsModel->rowCount());
+    m_ui->effectProfilingCheckBox->setEnabled(effects != nullptr);
+    if (!effects) {
+        return;
+    }
+
+    // Times are reported in nanoseconds, show them in milliseconds with a precision of 10µs.
+    auto timeItem = [] (const QVariantMap &timings, const QString &key) {
+        auto item = new QStandardItem;
+        const auto it = timings.constFind(key);
+        if (it != timings.constEnd()) {
+            item->setData(qRound64(it->toLongLong() / 10000.0) / 100.0, Qt::DisplayRole);
+        }
+        return item;
+    };
+    auto appendRow = [this, &timeItem] (const QString &name, const QVariantMap &timings) {
+        auto frames = new QStandardItem;
+        frames->setData(timings.value(QStringLiteral("frames")).toInt(), Qt::DisplayRole);
+        m_effectTimingsModel->appendRow({
+            new QStandardItem(name),
+            timeItem(timings, QStringLiteral("cpuAverage")),
+            timeItem(timings, QStringLiteral("cpuMax")),
+            timeItem(timings, QStringLiteral("gpuAverage")),
+            timeItem(timings, QStringLiteral("gpuMax")),
+            frames,
+        });
+    };
+
+    const QVariantMap timings = static_cast<EffectsHandlerImpl *>(effects)->effectTimings();
+    const QVariantMap effectTimings = timings.value(QStringLiteral("effects")).toMap();
+    for (auto it = effectTimings.constBegin(); it != effectTimings.constEnd(); ++it) {
+        appendRow(it.key(), it->toMap());
+    }
+    if (!effectTimings.isEmpty()) {
+        appendRow(i18n("All effects"), timings);
+    }
+
+    const QHeaderView *header = m_ui->effectTimingsView->header();
+    m_effectTimingsModel->sort(header->sortIndicatorSection(), header->sortIndicatorOrder());
+}
+
 template <typename T>
 QString keymapComponentToString(xkb_keymap *map, const T &count, std::function<const char*(xkb_keymap*,T)> f)
 {
@@ -18,7 +18,9 @@
 #include <QStyledItemDelegate>
 #include <QVector>
 
+class QStandardItemModel;
 class QTextEdit;
+class QTimer;
 
 namespace Ui
 {
@@ -102,10 +104,14 @@ protected:
 
 private:
     void initGLTab();
+    void initEffectsTab();
     void updateKeyboardTab();
+    void updateEffectsTab();
 
     QScopedPointer<Ui::DebugConsole> m_ui;
     QScopedPointer<DebugConsoleFilter> m_inputFilter;
+    QStandardItemModel *m_effectTimingsModel = nullptr;
+    QTimer *m_effectTimingsTimer = nullptr;
 };
 
 class SurfaceTreeModel : public QAbstractItemModel
@@ -21,6 +21,10 @@ public:
 
     virtual quint32 stride() const = 0;
     virtual int fd() const = 0;
+    /**
+     * The DRM format modifier of the buffer.
+     */
+    virtual quint64 modifier() const = 0;
     KWin::GLRenderTarget* framebuffer() const;
 
 protected:
@@ -0,0 +1,310 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "effectprofiler.h"
+
+#include <kwinglutils.h>
+
+#include <QHash>
+
+namespace KWin
+{
+
+// The GPU time of at most this many sections is measured per frame, a few queries per
+// window and effect are plenty even on a crowded desktop.
+static const int s_maxQueries = 4096;
+
+EffectProfiler::EffectProfiler() = default;
+
+EffectProfiler::~EffectProfiler() = default;
+
+void EffectProfiler::setEnabled(bool enabled, bool measureGpu)
+{
+    measureGpu = enabled && measureGpu;
+    if (m_enabled == enabled && m_measureGpu == measureGpu) {
+        return;
+    }
+    m_enabled = enabled;
+    m_measureGpu = measureGpu;
+
+    m_frameActive = false;
+    m_current = Frame();
+    m_stack.clear();
+    m_pendingFrames.clear();
+    m_freeQueries.clear();
+    m_queries.clear();
+    if (m_enabled) {
+        m_timer.start();
+    }
+}
+
+void EffectProfiler::beginFrame(const QStringList &names)
+{
+    if (!m_enabled) {
+        return;
+    }
+    if (m_frameActive) {
+        // The previous frame has been aborted.
+        recycleQueries(m_current);
+        m_stack.clear();
+    }
+    if (m_measureGpu) {
+        resolvePendingFrames();
+    }
+
+    m_current = Frame();
+    m_current.samples.resize(names.count() + 1);
+    m_current.samples[0].name = QStringLiteral("[scene]");
+    for (int i = 0; i < names.count(); ++i) {
+        m_current.samples[i + 1].name = names[i];
+    }
+    m_frameActive = true;
+}
+
+void EffectProfiler::endFrame()
+{
+    if (!m_frameActive) {
+        return;
+    }
+    while (!m_stack.isEmpty()) {
+        leave();
+    }
+    m_frameActive = false;
+
+    if (m_current.gpuSections.isEmpty()) {
+        addToHistory(m_current);
+    } else {
+        if (m_pendingFrames.count() == s_maxPendingFrames) {
+            // The GPU is lagging behind, give up on the oldest frame rather than stall.
+            Frame &oldest = m_pendingFrames.first();
+            recycleQueries(oldest);
+            addToHistory(oldest);
+            m_pendingFrames.removeFirst();
+        }
+        m_pendingFrames.append(m_current);
+    }
+    m_current = Frame();
+}
+
+int EffectProfiler::sampleIndex(int index) const
+{
+    return index + 1;
+}
+
+void EffectProfiler::enter(int index, bool gpu)
+{
+    if (!m_frameActive) {
+        return;
+    }
+    if (sampleIndex(index) >= m_current.samples.count()) {
+        // The effect chain has changed in the middle of the frame.
+        index = -1;
+    }
+
+    int gpuSection = -1;
+    if (gpu && m_measureGpu) {
+        if (GLTimestampQuery *begin = acquireQuery()) {
+            int parent = -1;
+            for (int i = m_stack.count() - 1; i >= 0; --i) {
+                if (m_stack[i].gpuSection != -1) {
+                    parent = m_stack[i].gpuSection;
+                    break;
+                }
+            }
+            begin->record();
+            gpuSection = m_current.gpuSections.count();
+            m_current.gpuSections.append(GpuSection{index, parent, begin, nullptr});
+        }
+    }
+    m_stack.append(StackEntry{index, m_timer.nsecsElapsed(), 0, gpuSection});
+}
+
+void EffectProfiler::leave()
+{
+    if (m_stack.isEmpty()) {
+        return;
+    }
+    const StackEntry entry = m_stack.takeLast();
+    const qint64 elapsed = m_timer.nsecsElapsed() - entry.start;
+    m_current.samples[sampleIndex(entry.index)].cpu += elapsed - entry.children;
+    if (!m_stack.isEmpty()) {
+        m_stack.last().children += elapsed;
+    }
+
+    if (entry.gpuSection != -1) {
+        GpuSection &section = m_current.gpuSections[entry.gpuSection];
+        section.end = acquireQuery();
+        if (section.end) {
+            section.end->record();
+        }
+    }
+}
+
+GLTimestampQuery *EffectProfiler::acquireQuery()
+{
+    if (!m_freeQueries.isEmpty()) {
+        return m_freeQueries.takeLast();
+    }
+    if (int(m_queries.size()) >= s_maxQueries) {
+        return nullptr;
+    }
+    m_queries.emplace_back(new GLTimestampQuery);
+    return m_queries.back().get();
+}
+
+void EffectProfiler::recycleQueries(Frame &frame)
+{
+    for (const GpuSection &section : qAsConst(frame.gpuSections)) {
+        m_freeQueries.append(section.begin);
+        if (section.end) {
+            m_freeQueries.append(section.end);
+        }
+    }
+    frame.gpuSections.clear();
+}
+
+void EffectProfiler::resolvePendingFrames()
+{
+    const bool disjoint = GLTimestampQuery::isDisjoint();
+    while (!m_pendingFrames.isEmpty()) {
+        Frame &frame = m_pendingFrames.first();
+        if (!resolveGpuTimes(frame, disjoint)) {
+            break;
+        }
+        recycleQueries(frame);
+        addToHistory(frame);
+        m_pendingFrames.removeFirst();
+    }
+}
+
+bool EffectProfiler::resolveGpuTimes(Frame &frame, bool disjoint)
+{
+    // The timestamps become available in the order they have been recorded.
+    for (int i = frame.gpuSections.count() - 1; i >= 0; --i) {
+        if (frame.gpuSections[i].end) {
+            if (!frame.gpuSections[i].end->isAvailable()) {
+                return false;
+            }
+            break;
+        }
+    }
+    if (disjoint) {
+        return true;
+    }
+
+    for (const GpuSection &section : qAsConst(frame.gpuSections)) {
+        if (!section.end) {
+            continue;
+        }
+        const qint64 elapsed = qMax<qint64>(0, section.end->timestamp() - section.begin->timestamp());
+        Sample &sample = frame.samples[sampleIndex(section.index)];
+        sample.gpu = qMax<qint64>(0, sample.gpu) + elapsed;
+        if (section.parent != -1) {
+            Sample &parent = frame.samples[sampleIndex(frame.gpuSections[section.parent].index)];
+            parent.gpu = qMax<qint64>(0, parent.gpu) - elapsed;
+        }
+    }
+    for (Sample &sample : frame.samples) {
+        if (sample.gpu != -1) {
+            sample.gpu = qMax<qint64>(0, sample.gpu);
+        }
+    }
+    return true;
+}
+
+void EffectProfiler::addToHistory(const Frame &frame)
+{
+    if (m_history.count() < s_historySize) {
+        m_history.append(frame.samples);
+    } else {
+        m_history[m_historyNext] = frame.samples;
+    }
+    m_historyNext = (m_historyNext + 1) % s_historySize;
+}
+
+void EffectProfiler::clear()
+{
+    m_history.clear();
+    m_historyNext = 0;
+}
+
+namespace
+{
+
+class TimeStatistics
+{
+public:
+    void add(qint64 cpu, qint64 gpu) {
+        m_cpuSum += cpu;
+        m_cpuMax = qMax(m_cpuMax, cpu);
+        m_count++;
+        if (gpu >= 0) {
+            m_gpuSum += gpu;
+            m_gpuMax = qMax(m_gpuMax, gpu);
+            m_gpuCount++;
+        }
+    }
+
+    QVariantMap toMap() const {
+        QVariantMap map;
+        map.insert(QStringLiteral("frames"), m_count);
+        if (m_count) {
+            map.insert(QStringLiteral("cpuAverage"), m_cpuSum / m_count);
+            map.insert(QStringLiteral("cpuMax"), m_cpuMax);
+        }
+        if (m_gpuCount) {
+            map.insert(QStringLiteral("gpuAverage"), m_gpuSum / m_gpuCount);
+            map.insert(QStringLiteral("gpuMax"), m_gpuMax);
+        }
+        return map;
+    }
+
+private:
+    qint64 m_cpuSum = 0;
+    qint64 m_cpuMax = 0;
+    qint64 m_count = 0;
+    qint64 m_gpuSum = 0;
+    qint64 m_gpuMax = 0;
+    qint64 m_gpuCount = 0;
+};
+
+}
+
+QVariantMap EffectProfiler::summary() const
+{
+    QHash<QString, TimeStatistics> perEffect;
+    TimeStatistics total;
+    for (const QVector<Sample> &samples : m_history) {
+        qint64 cpu = 0;
+        qint64 gpu = -1;
+        for (int i = 0; i < samples.count(); ++i) {
+            const Sample &sample = samples[i];
+            perEffect[sample.name].add(sample.cpu, sample.gpu);
+            if (i == 0) {
+                continue;
+            }
+            cpu += sample.cpu;
+            if (sample.gpu >= 0) {
+                gpu = qMax<qint64>(0, gpu) + sample.gpu;
+            }
+        }
+        total.add(cpu, gpu);
+    }
+
+    QVariantMap effectMap;
+    for (auto it = perEffect.constBegin(); it != perEffect.constEnd(); ++it) {
+        effectMap.insert(it.key(), it.value().toMap());
+    }
+
+    // The totals cover the effects only, the scene is listed on its own.
+    QVariantMap map = total.toMap();
+    map.insert(QStringLiteral("effects"), effectMap);
+    return map;
+}
+
+} // namespace KWin
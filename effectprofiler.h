@@ -0,0 +1,156 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_EFFECTPROFILER_H
+#define KWIN_EFFECTPROFILER_H
+
+#include <kwin_export.h>
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+
+class GLTimestampQuery;
+
+/**
+ * The EffectProfiler class measures how much CPU and GPU time every effect spends in a frame.
+ *
+ * The EffectsHandler wraps the calls into the effect chain with enter() and leave(). As an
+ * effect calls into the next effect of the chain, the sections are nested; the time spent
+ * in a section minus the time spent in the sections nested in it is accounted to the effect.
+ * Calls into the scene at the end of the chain are measured as well, so the time the scene
+ * needs to paint is not accounted to the last effect.
+ *
+ * The GPU time is measured with timestamp queries at the beginning and the end of every
+ * section. The results are read back a few frames later without stalling the pipeline, so
+ * a frame shows up in summary() only once its GPU times are known.
+ */
+class KWIN_EXPORT EffectProfiler
+{
+public:
+    EffectProfiler();
+    ~EffectProfiler();
+
+    bool isEnabled() const;
+    /**
+     * Enables or disables the profiler. If @p measureGpu is @c true, the GPU time is measured
+     * as well, which requires a current OpenGL context while the profiler is used.
+     */
+    void setEnabled(bool enabled, bool measureGpu = false);
+
+    /**
+     * Starts a frame in which the effects with the given @p names are active, in the order
+     * of the effect chain.
+     */
+    void beginFrame(const QStringList &names);
+    void endFrame();
+
+    /**
+     * Enters a section of the effect with the given @p index in the effect chain, or of the
+     * scene if @p index is @c -1. If @p gpu is @c true, the GPU time of the section is
+     * measured as well.
+     */
+    void enter(int index, bool gpu);
+    void leave();
+
+    /**
+     * Returns the average and maximum CPU and GPU times of every effect over the recorded
+     * frames, in nanoseconds. The times of the scene are listed as "[scene]".
+     */
+    QVariantMap summary() const;
+    void clear();
+
+    class Scope
+    {
+    public:
+        Scope(EffectProfiler *profiler, int index, bool gpu)
+            : m_profiler(profiler->isEnabled() ? profiler : nullptr)
+        {
+            if (m_profiler) {
+                m_profiler->enter(index, gpu);
+            }
+        }
+        ~Scope()
+        {
+            if (m_profiler) {
+                m_profiler->leave();
+            }
+        }
+
+    private:
+        EffectProfiler *m_profiler;
+    };
+
+private:
+    struct Sample
+    {
+        QString name;
+        qint64 cpu = 0;
+        qint64 gpu = -1;
+    };
+
+    struct GpuSection
+    {
+        int index;
+        int parent;
+        GLTimestampQuery *begin;
+        GLTimestampQuery *end;
+    };
+
+    struct Frame
+    {
+        QVector<Sample> samples;
+        QVector<GpuSection> gpuSections;
+    };
+
+    struct StackEntry
+    {
+        int index;
+        qint64 start;
+        qint64 children;
+        int gpuSection;
+    };
+
+    int sampleIndex(int index) const;
+    GLTimestampQuery *acquireQuery();
+    void resolvePendingFrames();
+    bool resolveGpuTimes(Frame &frame, bool disjoint);
+    void recycleQueries(Frame &frame);
+    void addToHistory(const Frame &frame);
+
+    static const int s_historySize = 120;
+    static const int s_maxPendingFrames = 3;
+
+    bool m_enabled = false;
+    bool m_measureGpu = false;
+    bool m_frameActive = false;
+    QElapsedTimer m_timer;
+    Frame m_current;
+    QVector<StackEntry> m_stack;
+    QVector<Frame> m_pendingFrames;
+    QVector<QVector<Sample>> m_history;
+    int m_historyNext = 0;
+    std::vector<std::unique_ptr<GLTimestampQuery>> m_queries;
+    QVector<GLTimestampQuery *> m_freeQueries;
+};
+
+inline bool EffectProfiler::isEnabled() const
+{
+    return m_enabled;
+}
+
+} // namespace KWin
+
+#endif
@@ -257,10 +257,15 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
         }
     }
     reconfigure();
+
+    if (qEnvironmentVariableIntValue("KWIN_EFFECT_PROFILING")) {
+        setProfilingEnabled(true);
+    }
 }
 
 EffectsHandlerImpl::~EffectsHandlerImpl()
 {
+    setProfilingEnabled(false);
     unloadAllEffects();
 }
 
@@ -371,6 +376,7 @@ void EffectsHandlerImpl::reconfigure()
 void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData& data, int time)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintScreenIterator), false);
         (*m_currentPaintScreenIterator++)->prePaintScreen(data, time);
         --m_currentPaintScreenIterator;
     }
@@ -380,10 +386,13 @@ void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData& data, int time)
 void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPaintData& data)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintScreenIterator), true);
         (*m_currentPaintScreenIterator++)->paintScreen(mask, region, data);
         --m_currentPaintScreenIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(&m_profiler, -1, true);
         m_scene->finalPaintScreen(mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, ScreenPaintData &data)
@@ -405,6 +414,7 @@ void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, Scr
 void EffectsHandlerImpl::postPaintScreen()
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintScreenIterator), false);
         (*m_currentPaintScreenIterator++)->postPaintScreen();
         --m_currentPaintScreenIterator;
     }
@@ -414,6 +424,7 @@ void EffectsHandlerImpl::postPaintScreen()
 void EffectsHandlerImpl::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int time)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintWindowIterator), false);
         (*m_currentPaintWindowIterator++)->prePaintWindow(w, data, time);
         --m_currentPaintWindowIterator;
     }
@@ -423,18 +434,23 @@ void EffectsHandlerImpl::prePaintWindow(EffectWindow* w, WindowPrePaintData& dat
 void EffectsHandlerImpl::paintWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintWindowIterator), true);
         (*m_currentPaintWindowIterator++)->paintWindow(w, mask, region, data);
         --m_currentPaintWindowIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(&m_profiler, -1, true);
         m_scene->finalPaintWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &region, double opacity, double frameOpacity)
 {
     if (m_currentPaintEffectFrameIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintEffectFrameIterator), true);
         (*m_currentPaintEffectFrameIterator++)->paintEffectFrame(frame, region, opacity, frameOpacity);
         --m_currentPaintEffectFrameIterator;
     } else {
+        EffectProfiler::Scope scope(&m_profiler, -1, true);
         const EffectFrameImpl* frameImpl = static_cast<const EffectFrameImpl*>(frame);
         frameImpl->finalRender(region, opacity, frameOpacity);
     }
@@ -443,6 +459,7 @@ void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &reg
 void EffectsHandlerImpl::postPaintWindow(EffectWindow* w)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentPaintWindowIterator), false);
         (*m_currentPaintWindowIterator++)->postPaintWindow(w);
         --m_currentPaintWindowIterator;
     }
@@ -460,10 +477,13 @@ Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 void EffectsHandlerImpl::drawWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (m_currentDrawWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(&m_profiler, chainPosition(m_currentDrawWindowIterator), true);
         (*m_currentDrawWindowIterator++)->drawWindow(w, mask, region, data);
         --m_currentDrawWindowIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(&m_profiler, -1, true);
         m_scene->finalDrawWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::buildQuads(EffectWindow* w, WindowQuadList& quadList)
@@ -510,6 +530,58 @@ void EffectsHandlerImpl::startPaint()
     m_currentPaintWindowIterator = m_activeEffects.constBegin();
     m_currentPaintScreenIterator = m_activeEffects.constBegin();
     m_currentPaintEffectFrameIterator = m_activeEffects.constBegin();
+
+    if (m_profiler.isEnabled()) {
+        QStringList names;
+        names.reserve(m_activeEffects.count());
+        for (Effect *effect : qAsConst(m_activeEffects)) {
+            auto it = std::find_if(loaded_effects.constBegin(), loaded_effects.constEnd(),
+                [effect](const EffectPair &pair) {
+                    return pair.second == effect;
+                }
+            );
+            names << (it != loaded_effects.constEnd() ? it->first : QString());
+        }
+        m_profiler.beginFrame(names);
+    }
+}
+
+void EffectsHandlerImpl::finishPaint()
+{
+    m_profiler.endFrame();
+}
+
+int EffectsHandlerImpl::chainPosition(EffectsIterator it) const
+{
+    return it - m_activeEffects.constBegin();
+}
+
+bool EffectsHandlerImpl::isProfilingEnabled() const
+{
+    return m_profiler.isEnabled();
+}
+
+void EffectsHandlerImpl::setProfilingEnabled(bool enabled)
+{
+    if (m_profiler.isEnabled() == enabled) {
+        return;
+    }
+    // The GPU timestamp queries are created and destroyed in the compositing context.
+    const bool measureGpu = isOpenGLCompositing() && GLRenderTimeQuery::supported();
+    if (isOpenGLCompositing()) {
+        makeOpenGLContextCurrent();
+    }
+    m_profiler.setEnabled(enabled, measureGpu);
+}
+
+QVariantMap EffectsHandlerImpl::effectTimings() const
+{
+    return m_profiler.summary();
+}
+
+void EffectsHandlerImpl::resetEffectTimings()
+{
+    m_profiler.clear();
 }
 
 void EffectsHandlerImpl::slotClientMaximized(KWin::AbstractClient *c, MaximizeMode maxMode)
@@ -1517,6 +1589,16 @@ QStringList EffectsHandlerImpl::activeEffects() const
     return ret;
 }
 
+bool EffectsHandlerImpl::blocksDirectScanout() const
+{
+    for (auto it = loaded_effects.constBegin(); it != loaded_effects.constEnd(); ++it) {
+        if (it->second->isActive() && it->second->blocksDirectScanout()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 KWaylandServer::Display *EffectsHandlerImpl::waylandDisplay() const
 {
     if (waylandServer()) {
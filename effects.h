@@ -13,6 +13,7 @@
 
 #include "kwineffects.h"
 
+#include "effectprofiler.h"
 #include "scene.h"
 
 #include <QHash>
@@ -56,6 +57,10 @@ class KWIN_EXPORT EffectsHandlerImpl : public EffectsHandler
     Q_PROPERTY(QStringList activeEffects READ activeEffects)
     Q_PROPERTY(QStringList loadedEffects READ loadedEffects)
     Q_PROPERTY(QStringList listOfEffects READ listOfEffects)
+    /**
+     * Whether the CPU and GPU time spent in every effect is measured, see effectTimings().
+     */
+    Q_PROPERTY(bool profilingEnabled READ isProfilingEnabled WRITE setProfilingEnabled)
 public:
     EffectsHandlerImpl(Compositor *compositor, Scene *scene);
     ~EffectsHandlerImpl() override;
@@ -111,6 +116,12 @@ public:
     void startMouseInterception(Effect *effect, Qt::CursorShape shape) override;
     void stopMouseInterception(Effect *effect) override;
     bool isMouseInterception() const;
+    /**
+     * Returns @c true if any effect takes part in painting the current frame.
+     */
+    bool hasActiveEffects() const {
+        return !m_activeEffects.isEmpty();
+    }
     void registerGlobalShortcut(const QKeySequence &shortcut, QAction *action) override;
     void registerPointerShortcut(Qt::KeyboardModifiers modifiers, Qt::MouseButton pointerButtons, QAction *action) override;
     void registerAxisShortcut(Qt::KeyboardModifiers modifiers, PointerAxisDirection axis, QAction *action) override;
@@ -191,6 +202,14 @@ public:
 
     // internal (used by kwin core or compositing code)
     void startPaint();
+    /**
+     * Called once the scene has finished painting the frame started with startPaint().
+     */
+    void finishPaint();
+
+    bool isProfilingEnabled() const;
+    void setProfilingEnabled(bool enabled);
+
     void grabbedKeyboardEvent(QKeyEvent* e);
     bool hasKeyboardGrab() const;
     void desktopResized(const QSize &size);
@@ -203,6 +222,11 @@ public:
     QList<EffectWindow*> elevatedWindows() const;
     QStringList activeEffects() const;
 
+    /**
+     * @returns Whether an active effect prevents fullscreen windows from being scanned out directly.
+     */
+    bool blocksDirectScanout() const;
+
     /**
      * @returns Whether we are currently in a desktop rendering process triggered by paintDesktop hook
      */
@@ -278,6 +302,12 @@ public Q_SLOTS:
     Q_SCRIPTABLE QList<bool> areEffectsSupported(const QStringList &names);
     Q_SCRIPTABLE QString supportInformation(const QString& name) const;
     Q_SCRIPTABLE QString debug(const QString& name, const QString& parameter = QString()) const;
+    /**
+     * Returns the average and maximum CPU and GPU time in nanoseconds spent in every effect
+     * over the last frames, if profilingEnabled is set.
+     */
+    Q_SCRIPTABLE QVariantMap effectTimings() const;
+    Q_SCRIPTABLE void resetEffectTimings();
 
 protected Q_SLOTS:
     void slotClientShown(KWin::Toplevel*);
@@ -335,12 +365,15 @@ private:
 
     typedef QVector< Effect*> EffectsList;
     typedef EffectsList::const_iterator EffectsIterator;
+    int chainPosition(EffectsIterator it) const;
+
     EffectsList m_activeEffects;
     EffectsIterator m_currentDrawWindowIterator;
     EffectsIterator m_currentPaintWindowIterator;
     EffectsIterator m_currentPaintEffectFrameIterator;
     EffectsIterator m_currentPaintScreenIterator;
     EffectsIterator m_currentBuildQuadsIterator;
+    EffectProfiler m_profiler;
     typedef QHash< QByteArray, QList< Effect*> > PropertyEffectMap;
     PropertyEffectMap m_propertiesForEffects;
     QHash<QByteArray, qulonglong> m_managedProperties;
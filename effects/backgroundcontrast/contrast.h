@@ -48,6 +48,10 @@ public:
         return 76;
     }
 
+    bool blocksDirectScanout() const override {
+        return false;
+    }
+
     bool eventFilter(QObject *watched, QEvent *event) override;
 
 public Q_SLOTS:
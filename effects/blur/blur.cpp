@@ -17,6 +17,7 @@
 #include <QTime>
 #include <QWindow>
 #include <cmath> // for ceil()
+#include <algorithm>
 
 #include <KWaylandServer/surface_interface.h>
 #include <KWaylandServer/blur_interface.h>
@@ -54,6 +55,31 @@ BlurEffect::BlurEffect()
     connect(effects, &EffectsHandler::windowDeleted, this, &BlurEffect::slotWindowDeleted);
     connect(effects, &EffectsHandler::propertyNotify, this, &BlurEffect::slotPropertyNotify);
     connect(effects, &EffectsHandler::screenGeometryChanged, this, &BlurEffect::slotScreenGeometryChanged);
+
+    // Track what changes behind blurred windows to know when their cached blur is outdated.
+    connect(effects, &EffectsHandler::windowDamaged, this, &BlurEffect::slotWindowDamaged);
+    connect(effects, &EffectsHandler::windowFrameGeometryChanged, this,
+        [this](EffectWindow *w, const QRect &oldGeometry) {
+            addChangedArea(w, oldGeometry);
+        }
+    );
+    connect(effects, &EffectsHandler::windowGeometryShapeChanged, this,
+        [this](EffectWindow *w, const QRect &oldGeometry) {
+            addChangedArea(w, oldGeometry);
+        }
+    );
+    auto windowChanged = [this](EffectWindow *w) {
+        addChangedArea(w->expandedGeometry());
+    };
+    connect(effects, &EffectsHandler::windowOpacityChanged, this, windowChanged);
+    connect(effects, &EffectsHandler::windowShown, this, windowChanged);
+    connect(effects, &EffectsHandler::windowHidden, this, windowChanged);
+    connect(effects, &EffectsHandler::windowMinimized, this, windowChanged);
+    connect(effects, &EffectsHandler::windowUnminimized, this, windowChanged);
+    connect(effects, &EffectsHandler::windowClosed, this, windowChanged);
+    connect(effects, &EffectsHandler::stackingOrderChanged, this, &BlurEffect::invalidateCaches);
+    connect(effects, static_cast<void (EffectsHandler::*)(int, int, EffectWindow *)>(&EffectsHandler::desktopChanged),
+            this, &BlurEffect::invalidateCaches);
     connect(effects, &EffectsHandler::xcbConnectionChanged, this,
         [this] {
             if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
@@ -75,6 +101,7 @@ BlurEffect::~BlurEffect()
 void BlurEffect::slotScreenGeometryChanged()
 {
     effects->makeOpenGLContextCurrent();
+    m_outputDamage.clear();
     updateTexture();
 
     // Fetch the blur regions for all windows
@@ -93,6 +120,7 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCaches.clear();
     qDeleteAll(m_renderTargets);
 
     m_renderTargets.clear();
@@ -317,10 +345,19 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
     }
 
     updateBlurRegion(w);
+    addChangedArea(w->expandedGeometry());
 }
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    if (m_blurCaches.contains(w)) {
+        effects->makeOpenGLContextCurrent();
+        m_blurCaches.remove(w);
+    }
+    for (OutputDamage &output : m_outputDamage) {
+        output.contentDamage.remove(w);
+    }
+
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -336,6 +373,104 @@ void BlurEffect::slotPropertyNotify(EffectWindow *w, long atom)
     }
 }
 
+void BlurEffect::slotWindowDamaged(EffectWindow *w, const QRect &r)
+{
+    if (m_blurCaches.isEmpty()) {
+        return;
+    }
+    // X11 windows report damage without knowing its extents yet.
+    const QRect bufferGeometry = w->bufferGeometry();
+    const QRect damage = r.isEmpty() ? bufferGeometry : r.translated(bufferGeometry.topLeft());
+    for (OutputDamage &output : m_outputDamage) {
+        if (output.screen.intersects(damage)) {
+            output.contentDamage[w] |= damage;
+        }
+    }
+}
+
+void BlurEffect::addChangedArea(const QRegion &region)
+{
+    if (m_blurCaches.isEmpty()) {
+        return;
+    }
+    for (OutputDamage &output : m_outputDamage) {
+        if (region.intersects(output.screen)) {
+            output.changedArea |= region & output.screen;
+        }
+    }
+}
+
+void BlurEffect::addChangedArea(const EffectWindow *w, const QRect &oldGeometry)
+{
+    // The shadow and decoration outside of the frame geometry move along with the window.
+    const QRect frameGeometry = w->frameGeometry();
+    const QRect expandedGeometry = w->expandedGeometry();
+    const QRect oldExpandedGeometry = oldGeometry.adjusted(expandedGeometry.left() - frameGeometry.left(),
+                                                           expandedGeometry.top() - frameGeometry.top(),
+                                                           expandedGeometry.right() - frameGeometry.right(),
+                                                           expandedGeometry.bottom() - frameGeometry.bottom());
+    addChangedArea(QRegion(expandedGeometry) | oldExpandedGeometry);
+}
+
+void BlurEffect::invalidateCaches()
+{
+    for (QVector<BlurCache> &caches : m_blurCaches) {
+        for (BlurCache &cache : caches) {
+            cache.valid = false;
+        }
+    }
+}
+
+BlurEffect::BlurCache *BlurEffect::findCache(const EffectWindow *w, const QRect &screen)
+{
+    auto it = m_blurCaches.find(w);
+    if (it == m_blurCaches.end()) {
+        return nullptr;
+    }
+    for (BlurCache &cache : *it) {
+        if (cache.screen == screen) {
+            return &cache;
+        }
+    }
+    return nullptr;
+}
+
+void BlurEffect::takeOutputDamage()
+{
+    auto output = std::find_if(m_outputDamage.begin(), m_outputDamage.end(),
+        [this](const OutputDamage &output) {
+            return output.screen == m_currentScreen;
+        }
+    );
+    if (output == m_outputDamage.end()) {
+        m_outputDamage.append(OutputDamage{m_currentScreen, {}, m_currentScreen});
+        output = m_outputDamage.end() - 1;
+    }
+    m_contentDamage = output->contentDamage;
+    m_changedArea = output->changedArea;
+    output->contentDamage.clear();
+    output->changedArea = QRegion();
+
+    if (!m_cachingEnabled) {
+        m_changedArea = m_currentScreen;
+    }
+
+    // The damage of a window's contents doesn't change what is behind the window or the
+    // windows below it.
+    m_contentDamageAbove.clear();
+    m_contentDamageBelow = QRegion();
+    if (!m_contentDamage.isEmpty()) {
+        QRegion above;
+        const EffectWindowList stackingOrder = effects->stackingOrder();
+        for (auto it = stackingOrder.crbegin(); it != stackingOrder.crend(); ++it) {
+            above |= m_contentDamage.value(*it);
+            if (m_blurCaches.contains(*it)) {
+                m_contentDamageAbove.insert(*it, above);
+            }
+        }
+    }
+}
+
 bool BlurEffect::eventFilter(QObject *watched, QEvent *event)
 {
     auto internal = qobject_cast<QWindow*>(watched);
@@ -476,6 +611,12 @@ void BlurEffect::prePaintScreen(ScreenPrePaintData &data, int time)
     m_currentBlur = QRegion();
 
     effects->prePaintScreen(data, time);
+
+    m_currentScreen = GLRenderTarget::virtualScreenGeometry();
+    m_frameDamage = data.paint;
+    m_cachingEnabled = !(data.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS))
+            && !effects->activeFullScreenEffect();
+    takeOutputDamage();
 }
 
 void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int time)
@@ -491,6 +632,9 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
         return;
     }
 
+    const QRegion contentDamageBelow = m_contentDamageBelow;
+    m_contentDamageBelow |= m_contentDamage.value(w);
+
     // to blur an area partially we have to shrink the opaque area of a window
     QRegion newClip;
     const QRegion oldClip = data.clip;
@@ -514,9 +658,22 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
     const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
+    // the cached blur can be used as long as nothing behind the window has changed
+    bool cached = false;
+    if (BlurCache *cache = findCache(w, m_currentScreen)) {
+        const QRegion damageBehind = (m_frameDamage - m_contentDamageAbove.value(w)) | contentDamageBelow | m_changedArea;
+        cache->valid = cache->valid && cache->region == (blurArea & m_currentScreen) && !damageBehind.intersects(expandedBlur);
+        cached = cache->valid;
+    }
+
+    // windows that are moved or faded by effects change what is behind the windows above them
+    if ((data.mask & PAINT_WINDOW_TRANSFORMED) || ((data.mask & PAINT_WINDOW_TRANSLUCENT) && !w->hasAlpha() && w->opacity() >= 1.0)) {
+        m_changedArea |= w->expandedGeometry();
+    }
+
     // if this window or a window underneath the blurred area is painted again we have to
     // blur everything
-    if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
+    if (!cached && (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea))) {
         data.paint |= expandedBlur;
         // we keep track of the "damage propagation"
         m_damagedArea |=  (w->isDock() ? (expandedBlur & m_damagedArea) : expand(expandedBlur & m_damagedArea)) & blurArea;
@@ -527,7 +684,9 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
         }
     }
 
-    m_currentBlur |= expandedBlur;
+    if (!cached) {
+        m_currentBlur |= expandedBlur;
+    }
 
     // we don't consider damaged areas which are occluded and are not
     // explicitly damaged by this window
@@ -595,7 +754,11 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         EffectWindow* modal = w->transientFor();
         const bool transientForIsDock = (modal ? modal->isDock() : false);
 
-        if (!shape.isEmpty()) {
+        if (shape.isEmpty()) {
+            // nothing to blur
+        } else if (m_cachingEnabled && !translated && !scaled) {
+            doCachedBlur(w, shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock);
+        } else {
             doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->geometry());
         }
     }
@@ -644,6 +807,95 @@ void BlurEffect::generateNoiseTexture()
     m_noiseTexture.setWrapMode(GL_REPEAT);
 }
 
+static float blurOpacity(float opacity)
+{
+#if 1 // bow shape, always above y = x
+    float o = 1.0f-opacity;
+    o = 1.0f - o*o;
+#else // sigmoid shape, above y = x for x > 0.5, below y = x for x < 0.5
+    float o = 2.0f*opacity - 1.0f;
+    o = 0.5f + o / (1.0f + qAbs(o));
+#endif
+    return o;
+}
+
+void BlurEffect::doCachedBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock)
+{
+    const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
+
+    BlurCache *cache = findCache(w, screen);
+    if (!cache) {
+        QVector<BlurCache> &caches = m_blurCaches[w];
+        caches.append(BlurCache());
+        cache = &caches.last();
+        cache->screen = screen;
+    }
+
+    if (cache->valid && cache->region == blurArea) {
+        drawCachedBlur(*cache, shape, opacity, screenProjection);
+        return;
+    }
+
+    doBlur(shape, screen, opacity, screenProjection, isDock, w->geometry());
+    cache->valid = false;
+
+    // The blurred background can only be read back if it has been painted as a whole and
+    // hasn't been mixed with what is behind it.
+    if (opacity >= 1.0 && (blurArea - shape).isEmpty()) {
+        updateCache(*cache, blurArea);
+    }
+}
+
+void BlurEffect::updateCache(BlurCache &cache, const QRegion &region)
+{
+    const QRect rect = region.boundingRect();
+    const QSize size = rect.size() * GLRenderTarget::virtualScreenScale();
+    if (cache.texture.isNull() || cache.texture.size() != size) {
+        cache.texture = GLTexture(m_renderTextures.first().internalFormat(), size);
+        cache.texture.setFilter(GL_LINEAR);
+        cache.texture.setWrapMode(GL_CLAMP_TO_EDGE);
+    }
+
+    GLRenderTarget target(cache.texture);
+    if (!target.valid()) {
+        return;
+    }
+    target.blitFromFramebuffer(rect);
+
+    cache.region = region;
+    cache.rect = rect;
+    cache.valid = true;
+}
+
+void BlurEffect::drawCachedBlur(BlurCache &cache, const QRegion &shape, const float opacity, const QMatrix4x4 &screenProjection)
+{
+    const bool useSRGB = m_renderTextures.first().internalFormat() == GL_SRGB8_ALPHA8;
+    if (useSRGB) {
+        glEnable(GL_FRAMEBUFFER_SRGB);
+    }
+    if (opacity < 1.0) {
+        glEnable(GL_BLEND);
+        glBlendColor(0, 0, 0, blurOpacity(opacity));
+        glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    }
+
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    QMatrix4x4 mvp = screenProjection;
+    mvp.translate(cache.rect.x(), cache.rect.y());
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+    cache.texture.bind();
+    cache.texture.render(shape, cache.rect, true);
+    cache.texture.unbind();
+
+    if (opacity < 1.0) {
+        glDisable(GL_BLEND);
+    }
+    if (useSRGB) {
+        glDisable(GL_FRAMEBUFFER_SRGB);
+    }
+}
+
 void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
@@ -700,14 +952,7 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
         glEnable(GL_BLEND);
-#if 1 // bow shape, always above y = x
-        float o = 1.0f-opacity;
-        o = 1.0f - o*o;
-#else // sigmoid shape, above y = x for x > 0.5, below y = x for x < 0.5
-        float o = 2.0f*opacity - 1.0f;
-        o = 0.5f + o / (1.0f + qAbs(o));
-#endif
-        glBlendColor(0, 0, 0, o);
+        glBlendColor(0, 0, 0, blurOpacity(opacity));
         glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
     }
 
@@ -12,6 +12,7 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QHash>
 #include <QVector>
 #include <QVector2D>
 #include <QStack>
@@ -51,6 +52,11 @@ public:
         return 75;
     }
 
+    bool blocksDirectScanout() const override {
+        // Only paints behind windows, which a scanned out fullscreen window covers.
+        return false;
+    }
+
     bool eventFilter(QObject *watched, QEvent *event) override;
 
 public Q_SLOTS:
@@ -58,8 +64,30 @@ public Q_SLOTS:
     void slotWindowDeleted(KWin::EffectWindow *w);
     void slotPropertyNotify(KWin::EffectWindow *w, long atom);
     void slotScreenGeometryChanged();
+    void slotWindowDamaged(KWin::EffectWindow *w, const QRect &r);
 
 private:
+    /**
+     * The blurred background of a window on an output. It is reused as long as nothing
+     * behind the window changes.
+     */
+    struct BlurCache {
+        QRect screen;
+        QRegion region;
+        QRect rect;
+        GLTexture texture;
+        bool valid = false;
+    };
+
+    /**
+     * The damage that happened since an output has been painted the last time.
+     */
+    struct OutputDamage {
+        QRect screen;
+        QHash<const EffectWindow *, QRegion> contentDamage;
+        QRegion changedArea;
+    };
+
     QRect expand(const QRect &rect) const;
     QRegion expand(const QRegion &region) const;
     bool renderTargetsValid() const;
@@ -70,6 +98,14 @@ private:
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
     void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    void doCachedBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock);
+    void drawCachedBlur(BlurCache &cache, const QRegion &shape, const float opacity, const QMatrix4x4 &screenProjection);
+    void updateCache(BlurCache &cache, const QRegion &region);
+    BlurCache *findCache(const EffectWindow *w, const QRect &screen);
+    void invalidateCaches();
+    void addChangedArea(const QRegion &region);
+    void addChangedArea(const EffectWindow *w, const QRect &oldGeometry);
+    void takeOutputDamage();
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
@@ -93,6 +129,16 @@ private:
     QRegion m_paintedArea; // actually painted area which is greater than m_damagedArea
     QRegion m_currentBlur; // keeps track of the currently blured area of the windows(from bottom to top)
 
+    QHash<const EffectWindow *, QVector<BlurCache>> m_blurCaches;
+    QVector<OutputDamage> m_outputDamage;
+    bool m_cachingEnabled = false; // whether cached blurs can be used in the current frame
+    QRect m_currentScreen;
+    QRegion m_frameDamage;
+    QRegion m_changedArea; // areas that changed in ways other than by window contents
+    QHash<const EffectWindow *, QRegion> m_contentDamage;
+    QHash<const EffectWindow *, QRegion> m_contentDamageAbove; // including the window itself
+    QRegion m_contentDamageBelow;
+
     int m_downSampleIterations; // number of times the texture will be downsized to half size
     int m_offset;
     int m_expandSize;
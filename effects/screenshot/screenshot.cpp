@@ -78,11 +78,24 @@ ScreenShotEffect::ScreenShotEffect()
 {
     connect(effects, &EffectsHandler::windowClosed, this, &ScreenShotEffect::windowClosed);
     QDBusConnection::sessionBus().registerObject(QStringLiteral("/Screenshot"), this, QDBusConnection::ExportScriptableContents);
+
+    // The readback is usually finished within a few milliseconds, poll for it until then.
+    m_readbackTimer.setSingleShot(true);
+    m_readbackTimer.setInterval(5);
+    connect(&m_readbackTimer, &QTimer::timeout, this, [this] {
+        if (effects->makeOpenGLContextCurrent()) {
+            finishReadbacks(false);
+        }
+        if (!m_pendingReadbacks.isEmpty()) {
+            m_readbackTimer.start();
+        }
+    });
 }
 
 ScreenShotEffect::~ScreenShotEffect()
 {
     QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/Screenshot"));
+    discardReadbacks();
 }
 
 #ifdef KWIN_HAVE_XRENDER_COMPOSITING
@@ -356,58 +369,64 @@ void ScreenShotEffect::postPaintScreen()
                 // doesn't intersect, not going onto this screenshot
                 return;
             }
-            QImage img = blitScreenshot(intersection, m_cachedScale);
-            if (img.size() == (m_scheduledGeometry.size() * m_cachedScale)) {
-                // we are done
-                sendReplyImage(img);
+            if (startReadback(intersection, m_cachedOutputGeometry, m_cachedScale)) {
                 return;
             }
-            img.setDevicePixelRatio(m_cachedScale);
+            addOutputImage(blitScreenshot(intersection, m_cachedScale), intersection, m_cachedOutputGeometry, m_cachedScale);
+        } else if (!startReadback(m_scheduledGeometry, QRect(), 1.0)) {
+            const QImage img = blitScreenshot(m_scheduledGeometry);
+            sendReplyImage(img);
+        }
+    }
+}
 
-            m_cacheOutputsImages.insert(ComparableQPoint(m_cachedOutputGeometry.topLeft()), img);
+void ScreenShotEffect::addOutputImage(QImage img, const QRect &geometry, const QRect &outputGeometry, qreal scale)
+{
+    if (img.size() == (m_scheduledGeometry.size() * scale)) {
+        // we are done
+        sendReplyImage(img);
+        return;
+    }
+    img.setDevicePixelRatio(scale);
 
-            m_multipleOutputsRendered = m_multipleOutputsRendered.united(intersection);
-            if (m_multipleOutputsRendered.boundingRect() == m_scheduledGeometry) {
+    m_cacheOutputsImages.insert(ComparableQPoint(outputGeometry.topLeft()), img);
 
-                // Recompute coordinates
-                if (m_nativeSize) {
-                    computeCoordinatesAfterScaling();
-                }
+    m_multipleOutputsRendered = m_multipleOutputsRendered.united(geometry);
+    if (m_multipleOutputsRendered.boundingRect() == m_scheduledGeometry) {
 
-                // find the output image size
-                int width = 0;
-                int height = 0;
-                QMap<ComparableQPoint, QImage>::const_iterator i;
-                for (i = m_cacheOutputsImages.constBegin(); i != m_cacheOutputsImages.constEnd(); ++i) {
-                    const auto pos = i.key();
-                    const auto img = i.value();
+        // Recompute coordinates
+        if (m_nativeSize) {
+            computeCoordinatesAfterScaling();
+        }
 
-                    width = qMax(width, pos.x() + img.width());
-                    height = qMax(height, pos.y() + img.height());
-                }
+        // find the output image size
+        int width = 0;
+        int height = 0;
+        QMap<ComparableQPoint, QImage>::const_iterator i;
+        for (i = m_cacheOutputsImages.constBegin(); i != m_cacheOutputsImages.constEnd(); ++i) {
+            const auto pos = i.key();
+            const auto img = i.value();
 
-                QImage multipleOutputsImage = QImage(width, height, QImage::Format_ARGB32);
+            width = qMax(width, pos.x() + img.width());
+            height = qMax(height, pos.y() + img.height());
+        }
 
-                QPainter p;
-                p.begin(&multipleOutputsImage);
+        QImage multipleOutputsImage = QImage(width, height, QImage::Format_ARGB32);
 
-                // reassemble images together
-                for (i = m_cacheOutputsImages.constBegin(); i != m_cacheOutputsImages.constEnd(); ++i) {
-                    auto pos = i.key();
-                    auto img = i.value();
-                    // disable dpr rendering, we already took care of this
-                    img.setDevicePixelRatio(1.0);
-                    p.drawImage(pos, img);
-                }
-                p.end();
+        QPainter p;
+        p.begin(&multipleOutputsImage);
 
-                sendReplyImage(multipleOutputsImage);
-            }
-
-        } else {
-            const QImage img = blitScreenshot(m_scheduledGeometry);
-            sendReplyImage(img);
+        // reassemble images together
+        for (i = m_cacheOutputsImages.constBegin(); i != m_cacheOutputsImages.constEnd(); ++i) {
+            auto pos = i.key();
+            auto img = i.value();
+            // disable dpr rendering, we already took care of this
+            img.setDevicePixelRatio(1.0);
+            p.drawImage(pos, img);
         }
+        p.end();
+
+        sendReplyImage(multipleOutputsImage);
     }
 }
 
@@ -435,6 +454,7 @@ void ScreenShotEffect::sendReplyImage(const QImage &img)
     m_windowMode = WindowMode::NoCapture;
     m_cacheOutputsImages.clear();
     m_cachedOutputGeometry = QRect();
+    discardReadbacks();
 }
 
 QString ScreenShotEffect::saveTempImage(const QImage &img)
@@ -690,31 +710,41 @@ QString ScreenShotEffect::screenshotArea(int x, int y, int width, int height, bo
     return QString();
 }
 
+// Returns the size of the image that readFramebuffer() produces for @p geometry.
+static QSize readbackSize(const QRect &geometry, qreal scale)
+{
+    if (GLRenderTarget::blitSupported() && !GLPlatform::instance()->isGLES()) {
+        return QSize(static_cast<int>(geometry.width() * scale), static_cast<int>(geometry.height() * scale));
+    }
+    return geometry.size();
+}
+
+// Reads @p geometry of the framebuffer into @p pixels, which is an offset into the bound
+// pixel pack buffer if there is one.
+static void readFramebuffer(const QRect &geometry, const QSize &size, GLvoid *pixels)
+{
+    if (GLRenderTarget::blitSupported() && !GLPlatform::instance()->isGLES()) {
+        GLTexture tex(GL_RGBA8, size.width(), size.height());
+        GLRenderTarget target(tex);
+        target.blitFromFramebuffer(geometry);
+        // copy content from framebuffer into image
+        tex.bind();
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        tex.unbind();
+    } else {
+        glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+}
+
 QImage ScreenShotEffect::blitScreenshot(const QRect &geometry, const qreal scale)
 {
     QImage img;
     if (effects->isOpenGLCompositing())
     {
-        int width = geometry.width();
-        int height = geometry.height();
-        if (GLRenderTarget::blitSupported() && !GLPlatform::instance()->isGLES()) {
-
-            width = static_cast<int>(width * scale);
-            height = static_cast<int>(height * scale);
-
-            img = QImage(width, height, QImage::Format_ARGB32);
-            GLTexture tex(GL_RGBA8, width, height);
-            GLRenderTarget target(tex);
-            target.blitFromFramebuffer(geometry);
-            // copy content from framebuffer into image
-            tex.bind();
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLvoid*>(img.bits()));
-            tex.unbind();
-        } else {
-            img = QImage(width, height, QImage::Format_ARGB32);
-            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)img.bits());
-        }
-        ScreenShotEffect::convertFromGLImage(img, width, height);
+        const QSize size = readbackSize(geometry, scale);
+        img = QImage(size, QImage::Format_ARGB32);
+        readFramebuffer(geometry, size, static_cast<GLvoid*>(img.bits()));
+        ScreenShotEffect::convertFromGLImage(img, size.width(), size.height());
     }
 
 #ifdef KWIN_HAVE_XRENDER_COMPOSITING
@@ -734,6 +764,83 @@ QImage ScreenShotEffect::blitScreenshot(const QRect &geometry, const qreal scale
     return img;
 }
 
+bool ScreenShotEffect::startReadback(const QRect &geometry, const QRect &outputGeometry, qreal scale)
+{
+    if (!effects->isOpenGLCompositing() || !GLPixelReadback::supported()) {
+        return false;
+    }
+    for (const PendingReadback &pending : qAsConst(m_pendingReadbacks)) {
+        if (pending.outputGeometry == outputGeometry) {
+            // this output is already being read back
+            return true;
+        }
+    }
+
+    PendingReadback pending;
+    pending.readback = new GLPixelReadback;
+    pending.geometry = geometry;
+    pending.outputGeometry = outputGeometry;
+    pending.size = readbackSize(geometry, scale);
+    pending.scale = scale;
+
+    pending.readback->begin(pending.size.width() * pending.size.height() * 4);
+    readFramebuffer(geometry, pending.size, nullptr);
+    pending.readback->end();
+
+    m_pendingReadbacks.append(pending);
+    if (!m_readbackTimer.isActive()) {
+        m_readbackTimer.start();
+    }
+    return true;
+}
+
+void ScreenShotEffect::finishReadbacks(bool wait)
+{
+    while (!m_pendingReadbacks.isEmpty()) {
+        const PendingReadback pending = m_pendingReadbacks.constFirst();
+        if (!pending.readback->isComplete(wait)) {
+            break;
+        }
+        m_pendingReadbacks.removeFirst();
+
+        QImage img(pending.size, QImage::Format_ARGB32);
+        if (const uchar *pixels = pending.readback->map()) {
+            memcpy(img.bits(), pixels, img.sizeInBytes());
+            pending.readback->unmap();
+        } else {
+            img.fill(Qt::transparent);
+        }
+        delete pending.readback;
+
+        convertFromGLImage(img, img.width(), img.height());
+        if (m_captureCursor) {
+            grabPointerImage(img, pending.geometry.x() * pending.scale, pending.geometry.y() * pending.scale);
+        }
+
+        if (pending.outputGeometry.isNull()) {
+            sendReplyImage(img);
+        } else {
+            addOutputImage(img, pending.geometry, pending.outputGeometry, pending.scale);
+        }
+    }
+
+    if (m_pendingReadbacks.isEmpty()) {
+        m_readbackTimer.stop();
+    }
+}
+
+void ScreenShotEffect::discardReadbacks()
+{
+    if (!m_pendingReadbacks.isEmpty()) {
+        effects->makeOpenGLContextCurrent();
+    }
+    for (const PendingReadback &pending : qAsConst(m_pendingReadbacks)) {
+        delete pending.readback;
+    }
+    m_pendingReadbacks.clear();
+    m_readbackTimer.stop();
+}
+
 void ScreenShotEffect::grabPointerImage(QImage& snapshot, int offsetx, int offsety)
 {
     const auto cursor = effects->cursorImage();
@@ -17,11 +17,14 @@
 #include <QDBusUnixFileDescriptor>
 #include <QObject>
 #include <QImage>
+#include <QTimer>
 
 class ComparableQPoint;
 namespace KWin
 {
 
+class GLPixelReadback;
+
 class ScreenShotEffect : public Effect, protected QDBusContext
 {
     Q_OBJECT
@@ -133,6 +136,10 @@ private Q_SLOTS:
 private:
     void grabPointerImage(QImage& snapshot, int offsetx, int offsety);
     QImage blitScreenshot(const QRect &geometry, const qreal scale = 1.0);
+    bool startReadback(const QRect &geometry, const QRect &outputGeometry, qreal scale);
+    void finishReadbacks(bool wait);
+    void discardReadbacks();
+    void addOutputImage(QImage img, const QRect &geometry, const QRect &outputGeometry, qreal scale);
     QString saveTempImage(const QImage &img);
     void sendReplyImage(const QImage &img);
     enum class InfoMessageMode {
@@ -163,6 +170,19 @@ private:
     WindowMode m_windowMode = WindowMode::NoCapture;
     int m_fd = -1;
     qreal m_cachedScale;
+
+    /**
+     * A part of the screen that is being read back without stalling the compositor.
+     */
+    struct PendingReadback {
+        GLPixelReadback *readback = nullptr;
+        QRect geometry;
+        QRect outputGeometry;
+        QSize size;
+        qreal scale = 1.0;
+    };
+    QVector<PendingReadback> m_pendingReadbacks;
+    QTimer m_readbackTimer;
 };
 
 } // namespace
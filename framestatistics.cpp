@@ -0,0 +1,262 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "framestatistics.h"
+#include "renderloop.h"
+
+#include <QJsonObject>
+
+#include <algorithm>
+#include <numeric>
+
+namespace KWin
+{
+
+FrameStatistics::FrameStatistics()
+{
+    m_frames.reserve(s_capacity);
+}
+
+void FrameStatistics::setScheduledTime(qint64 timestamp)
+{
+    m_scheduledTime = timestamp;
+}
+
+void FrameStatistics::setTargetPresentationTime(qint64 timestamp, qint64 vblankInterval)
+{
+    m_targetPresentationTime = timestamp;
+    m_vblankInterval = vblankInterval;
+}
+
+void FrameStatistics::beginFrame()
+{
+    if (m_frameActive) {
+        finishFrame();
+    }
+    m_current = FrameRecord();
+    m_current.sequence = ++m_sequence;
+    m_current.scheduledTime = m_scheduledTime;
+    m_current.targetPresentationTime = m_targetPresentationTime;
+    m_current.startTime = RenderLoop::currentTime();
+    m_targetPresentationTime = 0;
+    m_frameActive = true;
+}
+
+void FrameStatistics::setPaintTimes(qint64 prePaintStartTime, qint64 prePaintDuration, qint64 paintDuration)
+{
+    m_current.prePaintStartTime = prePaintStartTime;
+    m_current.prePaintDuration = prePaintDuration;
+    m_current.paintDuration = paintDuration;
+}
+
+void FrameStatistics::setPreviousGpuDuration(qint64 duration)
+{
+    if (duration < 0 || m_frames.isEmpty()) {
+        return;
+    }
+    const int previous = (m_next + m_frames.count() - 1) % m_frames.count();
+    m_frames[previous].gpuDuration = duration;
+}
+
+void FrameStatistics::endRendering()
+{
+    if (!m_current.renderEndTime) {
+        m_current.renderEndTime = RenderLoop::currentTime();
+    }
+}
+
+void FrameStatistics::swapScheduled()
+{
+    if (m_frameActive) {
+        // Rendering ends with scheduling the buffer swap.
+        m_current.swapTime = RenderLoop::currentTime();
+        m_current.renderEndTime = m_current.swapTime;
+    }
+}
+
+void FrameStatistics::framePresented(qint64 presentationTimestamp)
+{
+    // The frame is kept as the current one until the next frame begins, the buffer swap
+    // might complete before the Compositor has finished recording the frame.
+    if (!m_frameActive || !m_current.swapTime || m_current.presentationTime) {
+        return;
+    }
+    m_current.presentationTime = presentationTimestamp;
+    if (m_current.targetPresentationTime && m_vblankInterval > 0
+            && presentationTimestamp > m_current.targetPresentationTime) {
+        const qint64 delay = presentationTimestamp - m_current.targetPresentationTime;
+        m_current.missedVBlanks = (delay + m_vblankInterval / 2) / m_vblankInterval;
+    }
+}
+
+void FrameStatistics::finishFrame()
+{
+    if (m_frames.count() < s_capacity) {
+        m_frames.append(m_current);
+    } else {
+        m_frames[m_next] = m_current;
+    }
+    m_next = (m_next + 1) % s_capacity;
+    m_frameActive = false;
+}
+
+QVector<FrameRecord> FrameStatistics::frames() const
+{
+    QVector<FrameRecord> frames;
+    frames.reserve(m_frames.count() + 1);
+    if (m_frames.count() < s_capacity) {
+        frames = m_frames;
+    } else {
+        std::copy(m_frames.constBegin() + m_next, m_frames.constEnd(), std::back_inserter(frames));
+        std::copy(m_frames.constBegin(), m_frames.constBegin() + m_next, std::back_inserter(frames));
+    }
+    if (m_frameActive && m_current.presentationTime) {
+        frames.append(m_current);
+    }
+    return frames;
+}
+
+void FrameStatistics::clear()
+{
+    m_frames.clear();
+    m_next = 0;
+}
+
+namespace
+{
+
+class DurationStatistics
+{
+public:
+    void add(qint64 duration) {
+        if (duration < 0) {
+            return;
+        }
+        m_durations.append(duration);
+    }
+
+    void insertInto(QVariantMap &map, const QString &name) const {
+        if (m_durations.isEmpty()) {
+            return;
+        }
+        QVector<qint64> sorted = m_durations;
+        std::sort(sorted.begin(), sorted.end());
+        const qint64 sum = std::accumulate(sorted.constBegin(), sorted.constEnd(), qint64(0));
+        map.insert(name + QStringLiteral("Min"), sorted.constFirst());
+        map.insert(name + QStringLiteral("Average"), sum / sorted.count());
+        map.insert(name + QStringLiteral("P50"), percentile(sorted, 50));
+        map.insert(name + QStringLiteral("P95"), percentile(sorted, 95));
+        map.insert(name + QStringLiteral("P99"), percentile(sorted, 99));
+        map.insert(name + QStringLiteral("Max"), sorted.constLast());
+    }
+
+private:
+    // Nearest rank, so the result is always one of the recorded durations.
+    static qint64 percentile(const QVector<qint64> &sorted, int percent) {
+        const int rank = (sorted.count() * percent + 99) / 100;
+        return sorted.at(qMax(rank, 1) - 1);
+    }
+
+    QVector<qint64> m_durations;
+};
+
+}
+
+QVariantMap FrameStatistics::summary() const
+{
+    DurationStatistics prePaint;
+    DurationStatistics paint;
+    DurationStatistics render;
+    DurationStatistics gpu;
+    DurationStatistics swap;
+    DurationStatistics latency;
+    int missedVBlanks = 0;
+    int presentedFrames = 0;
+
+    const QVector<FrameRecord> records = frames();
+    for (const FrameRecord &frame : records) {
+        prePaint.add(frame.prePaintDuration);
+        paint.add(frame.paintDuration);
+        render.add(frame.renderEndTime - frame.startTime);
+        gpu.add(frame.gpuDuration);
+        if (frame.presentationTime) {
+            swap.add(frame.presentationTime - frame.swapTime);
+            latency.add(frame.presentationTime - frame.startTime);
+            presentedFrames++;
+        }
+        missedVBlanks += frame.missedVBlanks;
+    }
+
+    QVariantMap map;
+    map.insert(QStringLiteral("frames"), records.count());
+    map.insert(QStringLiteral("presentedFrames"), presentedFrames);
+    map.insert(QStringLiteral("missedVBlanks"), missedVBlanks);
+    prePaint.insertInto(map, QStringLiteral("prePaint"));
+    paint.insertInto(map, QStringLiteral("paint"));
+    render.insertInto(map, QStringLiteral("render"));
+    gpu.insertInto(map, QStringLiteral("gpu"));
+    swap.insertInto(map, QStringLiteral("swap"));
+    latency.insertInto(map, QStringLiteral("latency"));
+    return map;
+}
+
+static QJsonObject traceEvent(const QString &name, qint64 timestamp, qint64 duration, int tid)
+{
+    // Chrome traces use microseconds.
+    return QJsonObject{
+        {QStringLiteral("name"), name},
+        {QStringLiteral("cat"), QStringLiteral("kwin")},
+        {QStringLiteral("ph"), QStringLiteral("X")},
+        {QStringLiteral("ts"), timestamp / 1000.0},
+        {QStringLiteral("dur"), duration / 1000.0},
+        {QStringLiteral("pid"), 0},
+        {QStringLiteral("tid"), tid},
+    };
+}
+
+QJsonArray FrameStatistics::traceEvents(int tid) const
+{
+    QJsonArray events;
+    const QVector<FrameRecord> records = frames();
+    for (const FrameRecord &frame : records) {
+        QJsonObject event = traceEvent(QStringLiteral("frame"), frame.startTime,
+                                       frame.renderEndTime - frame.startTime, tid);
+        event.insert(QStringLiteral("args"), QJsonObject{
+            {QStringLiteral("sequence"), qint64(frame.sequence)},
+            {QStringLiteral("scheduleDelay"), (frame.startTime - frame.scheduledTime) / 1000.0},
+            {QStringLiteral("gpuTime"), frame.gpuDuration / 1000.0},
+            {QStringLiteral("missedVBlanks"), frame.missedVBlanks},
+        });
+        events.append(event);
+
+        if (frame.prePaintStartTime) {
+            events.append(traceEvent(QStringLiteral("prePaint"), frame.prePaintStartTime,
+                                     frame.prePaintDuration, tid));
+            events.append(traceEvent(QStringLiteral("paint"), frame.prePaintStartTime + frame.prePaintDuration,
+                                     frame.paintDuration, tid));
+        }
+        if (frame.presentationTime) {
+            events.append(traceEvent(QStringLiteral("swap"), frame.swapTime,
+                                     frame.presentationTime - frame.swapTime, tid));
+        }
+        if (frame.missedVBlanks) {
+            events.append(QJsonObject{
+                {QStringLiteral("name"), QStringLiteral("missed vblank")},
+                {QStringLiteral("cat"), QStringLiteral("kwin")},
+                {QStringLiteral("ph"), QStringLiteral("i")},
+                {QStringLiteral("s"), QStringLiteral("t")},
+                {QStringLiteral("ts"), frame.presentationTime / 1000.0},
+                {QStringLiteral("pid"), 0},
+                {QStringLiteral("tid"), tid},
+            });
+        }
+    }
+    return events;
+}
+
+} // namespace KWin
@@ -0,0 +1,123 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_FRAMESTATISTICS_H
+#define KWIN_FRAMESTATISTICS_H
+
+#include <kwinglobals.h>
+
+#include <QJsonArray>
+#include <QVariantMap>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The timing of a single composited frame. All timestamps are in nanoseconds on the
+ * CLOCK_MONOTONIC clock, durations are in nanoseconds.
+ */
+struct FrameRecord
+{
+    quint64 sequence = 0;
+    /**
+     * The time the frame timer has been scheduled to fire at.
+     */
+    qint64 scheduledTime = 0;
+    /**
+     * The time compositing of the frame has started.
+     */
+    qint64 startTime = 0;
+    qint64 prePaintStartTime = 0;
+    qint64 prePaintDuration = 0;
+    qint64 paintDuration = 0;
+    /**
+     * The time the scene has finished rendering the frame.
+     */
+    qint64 renderEndTime = 0;
+    /**
+     * The time the GPU needed to execute the rendering commands, or @c -1 if unknown.
+     */
+    qint64 gpuDuration = -1;
+    /**
+     * The time the buffer swap or page flip has been scheduled, or @c 0 if nothing
+     * has been presented.
+     */
+    qint64 swapTime = 0;
+    qint64 presentationTime = 0;
+    /**
+     * The vblank the frame was meant to be presented at, or @c 0 if the compositor
+     * didn't predict it.
+     */
+    qint64 targetPresentationTime = 0;
+    int missedVBlanks = 0;
+};
+
+/**
+ * The FrameStatistics class records the timing of the most recent frames of a RenderLoop.
+ *
+ * The Compositor feeds the statistics while it drives the render loop. They can be
+ * inspected over D-Bus, either summarized or as events in the Chrome trace format, which
+ * can be loaded into chrome://tracing or Perfetto.
+ */
+class KWIN_EXPORT FrameStatistics
+{
+public:
+    FrameStatistics();
+
+    void setScheduledTime(qint64 timestamp);
+    /**
+     * Sets the vblank the next frame should be presented at, @p vblankInterval is used
+     * to count how many vblanks the frame missed.
+     */
+    void setTargetPresentationTime(qint64 timestamp, qint64 vblankInterval);
+
+    void beginFrame();
+    void setPaintTimes(qint64 prePaintStartTime, qint64 prePaintDuration, qint64 paintDuration);
+    /**
+     * Sets the GPU time of the previously rendered frame, the result of a GPU timer
+     * query is only available once the following frame is rendered.
+     */
+    void setPreviousGpuDuration(qint64 duration);
+    void endRendering();
+    void swapScheduled();
+    void framePresented(qint64 presentationTimestamp);
+
+    /**
+     * Returns the recorded frames, oldest first.
+     */
+    QVector<FrameRecord> frames() const;
+    void clear();
+
+    /**
+     * Returns the minimum, average, median, 95th and 99th percentile, and maximum durations
+     * of the recorded frames.
+     */
+    QVariantMap summary() const;
+    /**
+     * Returns the recorded frames as Chrome trace events in thread @p tid.
+     */
+    QJsonArray traceEvents(int tid) const;
+
+private:
+    void finishFrame();
+
+    static const int s_capacity = 600;
+    QVector<FrameRecord> m_frames;
+    int m_next = 0;
+    FrameRecord m_current;
+    bool m_frameActive = false;
+    quint64 m_sequence = 0;
+    qint64 m_scheduledTime = 0;
+    qint64 m_targetPresentationTime = 0;
+    qint64 m_vblankInterval = 0;
+};
+
+} // namespace KWin
+
+#endif
@@ -0,0 +1,221 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "hittestindex.h"
+#include "screens.h"
+#include "toplevel.h"
+#include "unmanaged.h"
+#include "workspace.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+HitTestIndex::HitTestIndex(QObject *parent)
+    : QObject(parent)
+{
+    connect(workspace(), &Workspace::stackingOrderChanged, this, [this]() {
+        m_managed.dirty = true;
+    });
+    connect(workspace(), &Workspace::unmanagedAdded, this, [this]() {
+        m_unmanaged.dirty = true;
+    });
+    connect(workspace(), &Workspace::unmanagedRemoved, this, [this]() {
+        m_unmanaged.dirty = true;
+    });
+    connect(screens(), &Screens::changed, this, &HitTestIndex::invalidate);
+    invalidate();
+}
+
+HitTestIndex::~HitTestIndex() = default;
+
+void HitTestIndex::invalidate()
+{
+    m_area = screens()->geometry();
+    m_columns = (m_area.width() + s_cellSize - 1) / s_cellSize;
+    m_rows = (m_area.height() + s_cellSize - 1) / s_cellSize;
+    m_managed.dirty = true;
+    m_unmanaged.dirty = true;
+}
+
+const QVector<Toplevel *> *HitTestIndex::managedWindowsAt(const QPoint &pos)
+{
+    ensureUpToDate();
+    const int index = cellIndex(pos);
+    return index != -1 ? &m_managed.cells.at(index) : nullptr;
+}
+
+const QVector<Toplevel *> *HitTestIndex::unmanagedWindowsAt(const QPoint &pos)
+{
+    ensureUpToDate();
+    const int index = cellIndex(pos);
+    return index != -1 ? &m_unmanaged.cells.at(index) : nullptr;
+}
+
+void HitTestIndex::ensureUpToDate()
+{
+    // Not every change to the window lists is announced, e.g. new windows are put into the
+    // stacking order before it gets updated, so compare the number of windows as well.
+    const QList<Toplevel *> &stacking = workspace()->stackingOrder();
+    const QList<Unmanaged *> &unmanaged = workspace()->unmanagedList();
+    if (m_managed.sourceCount != stacking.count()) {
+        m_managed.dirty = true;
+    }
+    if (m_unmanaged.sourceCount != unmanaged.count()) {
+        m_unmanaged.dirty = true;
+    }
+    if (!m_managed.dirty && !m_unmanaged.dirty) {
+        return;
+    }
+    if (m_managed.dirty) {
+        rebuild(m_managed, stacking);
+    }
+    if (m_unmanaged.dirty) {
+        rebuild(m_unmanaged, unmanaged);
+    }
+
+    for (auto it = m_tracked.begin(); it != m_tracked.end();) {
+        if (m_managed.positions.contains(it.key()) || m_unmanaged.positions.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        for (const QMetaObject::Connection &connection : qAsConst(it.value())) {
+            disconnect(connection);
+        }
+        it = m_tracked.erase(it);
+    }
+}
+
+template <typename T>
+void HitTestIndex::rebuild(Layer &layer, const QList<T *> &windows)
+{
+    const int cellCount = m_columns * m_rows;
+    if (layer.cells.count() != cellCount) {
+        layer.cells.resize(cellCount);
+    }
+    for (QVector<Toplevel *> &cell : layer.cells) {
+        cell.clear();
+    }
+    layer.positions.clear();
+    layer.rects.clear();
+
+    for (int i = 0; i < windows.count(); ++i) {
+        Toplevel *window = windows.at(i);
+        if (window->isDeleted()) {
+            // a deleted window doesn't get input events
+            continue;
+        }
+        layer.positions.insert(window, i);
+        track(window);
+        const QRect rect = window->inputGeometry() & m_area;
+        layer.rects.insert(window, rect);
+        insert(layer, window, rect);
+    }
+    layer.sourceCount = windows.count();
+    layer.dirty = false;
+}
+
+int HitTestIndex::cellIndex(const QPoint &pos) const
+{
+    if (!m_area.contains(pos)) {
+        return -1;
+    }
+    const int column = (pos.x() - m_area.x()) / s_cellSize;
+    const int row = (pos.y() - m_area.y()) / s_cellSize;
+    return row * m_columns + column;
+}
+
+QRect HitTestIndex::cellRange(const QRect &rect) const
+{
+    return QRect(QPoint((rect.left() - m_area.x()) / s_cellSize, (rect.top() - m_area.y()) / s_cellSize),
+                 QPoint((rect.right() - m_area.x()) / s_cellSize, (rect.bottom() - m_area.y()) / s_cellSize));
+}
+
+void HitTestIndex::insert(Layer &layer, Toplevel *window, const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    const int position = layer.positions.value(window);
+    const auto lessThan = [&layer](Toplevel *a, int position) {
+        return layer.positions.value(a) < position;
+    };
+    const QRect range = cellRange(rect);
+    for (int row = range.top(); row <= range.bottom(); ++row) {
+        for (int column = range.left(); column <= range.right(); ++column) {
+            QVector<Toplevel *> &cell = layer.cells[row * m_columns + column];
+            cell.insert(std::lower_bound(cell.begin(), cell.end(), position, lessThan), window);
+        }
+    }
+}
+
+void HitTestIndex::remove(Layer &layer, Toplevel *window, const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    const QRect range = cellRange(rect);
+    for (int row = range.top(); row <= range.bottom(); ++row) {
+        for (int column = range.left(); column <= range.right(); ++column) {
+            layer.cells[row * m_columns + column].removeOne(window);
+        }
+    }
+}
+
+void HitTestIndex::track(Toplevel *window)
+{
+    if (m_tracked.contains(window)) {
+        return;
+    }
+    const auto geometryChanged = [this, window]() {
+        handleGeometryChanged(window);
+    };
+    m_tracked.insert(window, {
+        connect(window, &Toplevel::frameGeometryChanged, this, geometryChanged),
+        connect(window, &Toplevel::bufferGeometryChanged, this, geometryChanged),
+        connect(window, &Toplevel::geometryShapeChanged, this, geometryChanged),
+        connect(window, &QObject::destroyed, this, [this, window]() {
+            handleWindowDestroyed(window);
+        }),
+    });
+}
+
+void HitTestIndex::handleGeometryChanged(Toplevel *window)
+{
+    for (Layer *layer : {&m_managed, &m_unmanaged}) {
+        if (layer->dirty || !layer->positions.contains(window)) {
+            continue;
+        }
+        const QRect rect = window->inputGeometry() & m_area;
+        const QRect oldRect = layer->rects.value(window);
+        if (rect == oldRect) {
+            continue;
+        }
+        remove(*layer, window, oldRect);
+        layer->rects.insert(window, rect);
+        insert(*layer, window, rect);
+    }
+}
+
+void HitTestIndex::handleWindowDestroyed(Toplevel *window)
+{
+    for (Layer *layer : {&m_managed, &m_unmanaged}) {
+        if (!layer->positions.contains(window)) {
+            continue;
+        }
+        if (!layer->dirty) {
+            remove(*layer, window, layer->rects.value(window));
+        }
+        layer->positions.remove(window);
+        layer->rects.remove(window);
+    }
+    m_tracked.remove(window);
+}
+
+} // namespace KWin
@@ -0,0 +1,89 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_HITTESTINDEX_H
+#define KWIN_HITTESTINDEX_H
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+class Toplevel;
+
+/**
+ * The HitTestIndex class speeds up finding the window under the pointer.
+ *
+ * The screen area is divided into a grid of square cells, every cell lists the windows whose
+ * input geometry intersects it, in the same order as the stacking order or the list of
+ * unmanaged windows. A cell is usually a small fraction of all windows, so looking up the
+ * topmost window at a position doesn't have to walk the whole stacking order.
+ *
+ * Window geometry changes are applied incrementally, changes to the stacking order, the
+ * list of unmanaged windows or the screen layout rebuild the index on the next lookup.
+ * The index only tells which windows cover a cell, whether a window accepts input at a
+ * position still has to be checked by the caller.
+ */
+class KWIN_EXPORT HitTestIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HitTestIndex(QObject *parent = nullptr);
+    ~HitTestIndex() override;
+
+    /**
+     * Returns the managed windows whose input geometry may contain @p pos, bottom-most
+     * first. Returns @c nullptr if @p pos is outside of the indexed area.
+     */
+    const QVector<Toplevel *> *managedWindowsAt(const QPoint &pos);
+    /**
+     * Returns the unmanaged windows whose input geometry may contain @p pos, in the order
+     * of Workspace::unmanagedList(). Returns @c nullptr if @p pos is outside of the indexed area.
+     */
+    const QVector<Toplevel *> *unmanagedWindowsAt(const QPoint &pos);
+
+private:
+    struct Layer
+    {
+        QVector<QVector<Toplevel *>> cells;
+        QHash<Toplevel *, int> positions;
+        QHash<Toplevel *, QRect> rects;
+        int sourceCount = 0;
+        bool dirty = true;
+    };
+
+    void invalidate();
+    template <typename T>
+    void rebuild(Layer &layer, const QList<T *> &windows);
+    void ensureUpToDate();
+    int cellIndex(const QPoint &pos) const;
+    QRect cellRange(const QRect &rect) const;
+    void insert(Layer &layer, Toplevel *window, const QRect &rect);
+    void remove(Layer &layer, Toplevel *window, const QRect &rect);
+    void track(Toplevel *window);
+    void handleGeometryChanged(Toplevel *window);
+    void handleWindowDestroyed(Toplevel *window);
+
+    static const int s_cellSize = 256;
+    QRect m_area;
+    int m_columns = 0;
+    int m_rows = 0;
+    Layer m_managed;
+    Layer m_unmanaged;
+    QHash<Toplevel *, QVector<QMetaObject::Connection>> m_tracked;
+};
+
+} // namespace KWin
+
+#endif
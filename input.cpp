@@ -12,6 +12,7 @@
 #include "effects.h"
 #include "gestures.h"
 #include "globalshortcuts.h"
+#include "hittestindex.h"
 #include "input_event.h"
 #include "input_event_spy.h"
 #include "keyboard_input.h"
@@ -1377,7 +1378,12 @@ public:
         case QEvent::MouseMove: {
             seat->setPointerPos(event->globalPos());
             MouseEvent *e = static_cast<MouseEvent*>(event);
-            if (e->delta() != QSizeF()) {
+            const auto samples = e->motionSamples();
+            if (!samples.isEmpty()) {
+                for (const PointerMotionSample &sample : samples) {
+                    seat->relativePointerMotion(sample.delta, sample.deltaNonAccelerated, sample.timeMicroseconds);
+                }
+            } else if (e->delta() != QSizeF()) {
                 seat->relativePointerMotion(e->delta(), e->deltaUnaccelerated(), e->timestampMicroseconds());
             }
             break;
@@ -1971,6 +1977,7 @@ void InputRedirection::init()
 
 void InputRedirection::setupWorkspace()
 {
+    m_hitTestIndex = new HitTestIndex(this);
     if (waylandServer()) {
         using namespace KWaylandServer;
         FakeInputInterface *fakeInput = waylandServer()->display()->createFakeInput(this);
@@ -2190,8 +2197,9 @@ void InputRedirection::setupLibInput()
         connect(conn, &LibInput::Connection::swipeGestureCancelled, m_pointer, &PointerInputRedirection::processSwipeGestureCancelled);
         connect(conn, &LibInput::Connection::keyChanged, m_keyboard, &KeyboardInputRedirection::processKey);
         connect(conn, &LibInput::Connection::pointerMotion, this,
-            [this] (const QSizeF &delta, const QSizeF &deltaNonAccel, uint32_t time, quint64 timeMicroseconds, LibInput::Device *device) {
-                m_pointer->processMotion(m_pointer->pos() + QPointF(delta.width(), delta.height()), delta, deltaNonAccel, time, timeMicroseconds, device);
+            [this] (const QSizeF &delta, const QSizeF &deltaNonAccel, uint32_t time, quint64 timeMicroseconds,
+                    const QVector<PointerMotionSample> &samples, LibInput::Device *device) {
+                m_pointer->processMotion(m_pointer->pos() + QPointF(delta.width(), delta.height()), delta, deltaNonAccel, time, timeMicroseconds, device, samples);
             }
         );
         connect(conn, &LibInput::Connection::pointerMotionAbsolute, this,
@@ -2427,10 +2435,18 @@ Toplevel *InputRedirection::findToplevel(const QPoint &pos)
         if (effects && static_cast<EffectsHandlerImpl*>(effects)->isMouseInterception()) {
             return nullptr;
         }
-        const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
-        foreach (Unmanaged *u, unmanaged) {
-            if (u->inputGeometry().contains(pos) && acceptsInput(u, pos)) {
-                return u;
+        if (const QVector<Toplevel *> *unmanaged = m_hitTestIndex ? m_hitTestIndex->unmanagedWindowsAt(pos) : nullptr) {
+            for (Toplevel *u : *unmanaged) {
+                if (u->inputGeometry().contains(pos) && acceptsInput(u, pos)) {
+                    return u;
+                }
+            }
+        } else {
+            const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
+            foreach (Unmanaged *u, unmanaged) {
+                if (u->inputGeometry().contains(pos) && acceptsInput(u, pos)) {
+                    return u;
+                }
             }
         }
     }
@@ -2443,35 +2459,41 @@ Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
         return nullptr;
     }
     const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
-    const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
-    if (stacking.isEmpty()) {
-        return nullptr;
-    }
-    auto it = stacking.end();
-    do {
-        --it;
-        Toplevel *t = (*it);
+    const auto isTarget = [isScreenLocked, &pos](Toplevel *t) {
         if (t->isDeleted()) {
             // a deleted window doesn't get mouse events
-            continue;
+            return false;
         }
         if (AbstractClient *c = dynamic_cast<AbstractClient*>(t)) {
             if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
-                continue;
+                return false;
             }
         }
         if (!t->readyForPainting()) {
-            continue;
+            return false;
         }
         if (isScreenLocked) {
             if (!t->isLockScreen() && !t->isInputMethod()) {
-                continue;
+                return false;
+            }
+        }
+        return t->inputGeometry().contains(pos) && acceptsInput(t, pos);
+    };
+    // Only the windows covering the position have to be checked if it is on a screen.
+    if (const QVector<Toplevel *> *windows = m_hitTestIndex ? m_hitTestIndex->managedWindowsAt(pos) : nullptr) {
+        for (auto it = windows->crbegin(); it != windows->crend(); ++it) {
+            if (isTarget(*it)) {
+                return *it;
             }
         }
-        if (t->inputGeometry().contains(pos) && acceptsInput(t, pos)) {
-            return t;
+        return nullptr;
+    }
+    const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
+    for (auto it = stacking.crbegin(); it != stacking.crend(); ++it) {
+        if (isTarget(*it)) {
+            return *it;
         }
-    } while (it != stacking.begin());
+    }
     return nullptr;
 }
 
@@ -19,6 +19,7 @@
 
 #include <KSharedConfig>
 #include <QSet>
+#include <QSizeF>
 
 #include <functional>
 
@@ -31,6 +32,7 @@ class QWheelEvent;
 namespace KWin
 {
 class GlobalShortcutsManager;
+class HitTestIndex;
 class Toplevel;
 class InputEventFilter;
 class InputEventSpy;
@@ -54,6 +56,18 @@ namespace LibInput
     class Device;
 }
 
+/**
+ * A relative pointer motion as reported by the device. Motion events which are merged
+ * before they are passed through the input filters keep their individual samples, so
+ * that clients using relative pointer motion don't lose any resolution.
+ */
+struct PointerMotionSample
+{
+    QSizeF delta;
+    QSizeF deltaNonAccelerated;
+    quint64 timeMicroseconds;
+};
+
 /**
  * @brief This class is responsible for redirecting incoming input to the surface which currently
  * has input or send enter/leave events.
@@ -311,6 +325,7 @@ private:
     TabletInputFilter *m_tabletSupport = nullptr;
 
     GlobalShortcutsManager *m_shortcuts;
+    HitTestIndex *m_hitTestIndex = nullptr;
 
     LibInput::Connection *m_libInput = nullptr;
 
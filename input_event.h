@@ -12,6 +12,7 @@
 #include "input.h"
 
 #include <QInputEvent>
+#include <QVector>
 
 namespace KWin
 {
@@ -41,6 +42,18 @@ public:
         return m_timestampMicroseconds;
     }
 
+    /**
+     * The individual relative motions this motion event has been merged from, empty
+     * if delta() is the only one.
+     */
+    QVector<PointerMotionSample> motionSamples() const {
+        return m_motionSamples;
+    }
+
+    void setMotionSamples(const QVector<PointerMotionSample> &samples) {
+        m_motionSamples = samples;
+    }
+
     LibInput::Device *device() const {
         return m_device;
     }
@@ -65,6 +78,7 @@ private:
     QSizeF m_delta;
     QSizeF m_deltaUnccelerated;
     quint64 m_timestampMicroseconds;
+    QVector<PointerMotionSample> m_motionSamples;
     LibInput::Device *m_device;
     Qt::KeyboardModifiers m_modifiersRelevantForShortcuts = Qt::KeyboardModifiers();
     quint32 m_nativeButton = 0;
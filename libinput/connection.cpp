@@ -159,6 +159,9 @@ Connection::Connection(Context *input, QObject *parent)
     , m_leds()
 {
     Q_ASSERT(m_input);
+    if (qEnvironmentVariableIsSet("KWIN_LIBINPUT_MOTION_COALESCING")) {
+        m_motionCoalescing = qEnvironmentVariableIntValue("KWIN_LIBINPUT_MOTION_COALESCING") != 0;
+    }
     // need to connect to KGlobalSettings as the mouse KCM does not emit a dedicated signal
     QDBusConnection::sessionBus().connect(QString(), QStringLiteral("/KGlobalSettings"), QStringLiteral("org.kde.KGlobalSettings"),
                                           QStringLiteral("notifyChange"), this, SLOT(slotKGlobalSettingsNotifyChange(int,int)));
@@ -166,6 +169,11 @@ Connection::Connection(Context *input, QObject *parent)
 
 Connection::~Connection()
 {
+    QMutexLocker locker(Device::contextMutex());
+    while (!m_eventQueue.isEmpty()) {
+        libinput_event_destroy(m_eventQueue.peek());
+        m_eventQueue.pop();
+    }
     delete s_adaptor;
     s_adaptor = nullptr;
     s_self = nullptr;
@@ -198,7 +206,10 @@ void Connection::doSetup()
                 if (!m_input->isSuspended()) {
                     return;
                 }
-                m_input->resume();
+                {
+                    QMutexLocker locker(Device::contextMutex());
+                    m_input->resume();
+                }
                 wasSuspended = true;
             } else {
                 deactivate();
@@ -218,23 +229,39 @@ void Connection::deactivate()
     m_pointerBeforeSuspend = hasPointer();
     m_touchBeforeSuspend = hasTouch();
     m_tabletModeSwitchBeforeSuspend = hasTabletModeSwitch();
-    m_input->suspend();
+    {
+        QMutexLocker locker(Device::contextMutex());
+        m_input->suspend();
+    }
     handleEvent();
 }
 
 void Connection::handleEvent()
 {
-    QMutexLocker locker(&m_mutex);
-    const bool wasEmpty = m_eventQueue.isEmpty();
+    // Only the libinput calls are serialized with the main thread, which never holds the
+    // lock while it dispatches the events.
+    QMutexLocker locker(Device::contextMutex());
+    bool queued = false;
     do {
         m_input->dispatch();
-        Event *event = m_input->event();
+        if (m_eventQueue.isFull()) {
+            // Leave the remaining events in libinput's queue, processEvents() calls
+            // us again once it has made room.
+            m_eventQueueStalled = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_eventQueue.isFull()) {
+                break;
+            }
+        }
+        libinput_event *event = m_input->nativeEvent();
         if (!event) {
             break;
         }
-        m_eventQueue << event;
+        m_eventQueue.push(event);
+        queued = true;
     } while (true);
-    if (wasEmpty && !m_eventQueue.isEmpty()) {
+    locker.unlock();
+    if (queued && !m_eventsReadPending.exchange(true)) {
         emit eventsRead();
     }
 }
@@ -270,16 +297,50 @@ QPointF devicePointToGlobalPosition(const QPointF &devicePos, const AbstractWayl
 }
 #endif
 
+namespace
+{
+
+struct InPlaceEventDeleter
+{
+    static inline void cleanup(Event *event)
+    {
+        if (event) {
+            event->~Event();
+        }
+    }
+};
+
+}
+
+bool Connection::isNextEvent(libinput_event_type type, libinput_device *device) const
+{
+    if (m_eventQueue.isEmpty()) {
+        return false;
+    }
+    libinput_event *event = m_eventQueue.peek();
+    return libinput_event_get_type(event) == type && libinput_event_get_device(event) == device;
+}
+
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
+    // Events queued from now on will be picked up either by this or the next invocation.
+    m_eventsReadPending = false;
+    EventStorage storage;
     while (!m_eventQueue.isEmpty()) {
-        QScopedPointer<Event> event(m_eventQueue.takeFirst());
+        QScopedPointer<Event, InPlaceEventDeleter> event(Event::create(m_eventQueue.peek(), &storage));
+        m_eventQueue.pop();
         switch (event->type()) {
             case LIBINPUT_EVENT_DEVICE_ADDED: {
-                auto device = new Device(event->nativeDevice());
+                Device *device;
+                {
+                    QMutexLocker contextLocker(Device::contextMutex());
+                    device = new Device(event->nativeDevice());
+                }
                 device->moveToThread(s_thread);
-                m_devices << device;
+                {
+                    QMutexLocker locker(&m_mutex);
+                    m_devices << device;
+                }
                 if (device->isKeyboard()) {
                     m_keyboard++;
                     if (device->isAlphaNumericKeyboard()) {
@@ -314,7 +375,10 @@ void Connection::processEvents()
                 applyScreenToDevice(device);
 
                 // enable possible leds
-                libinput_device_led_update(device->device(), static_cast<libinput_led>(toLibinputLEDS(m_leds)));
+                {
+                    QMutexLocker contextLocker(Device::contextMutex());
+                    libinput_device_led_update(device->device(), static_cast<libinput_led>(toLibinputLEDS(m_leds)));
+                }
 
                 emit deviceAdded(device);
                 break;
@@ -326,7 +390,10 @@ void Connection::processEvents()
                     break;
                 }
                 auto device = *it;
-                m_devices.erase(it);
+                {
+                    QMutexLocker locker(&m_mutex);
+                    m_devices.erase(it);
+                }
                 emit deviceRemoved(device);
 
                 if (device->isKeyboard()) {
@@ -387,24 +454,28 @@ void Connection::processEvents()
                 auto deltaNonAccel = pe->deltaUnaccelerated();
                 quint32 latestTime = pe->time();
                 quint64 latestTimeUsec = pe->timeMicroseconds();
-                auto it = m_eventQueue.begin();
-                while (it != m_eventQueue.end()) {
-                    if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                        QScopedPointer<PointerEvent> p(static_cast<PointerEvent*>(*it));
-                        delta += p->delta();
-                        deltaNonAccel += p->deltaUnaccelerated();
-                        latestTime = p->time();
-                        latestTimeUsec = p->timeMicroseconds();
-                        it = m_eventQueue.erase(it);
-                    } else {
-                        break;
+                m_motionSamples.clear();
+                while (m_motionCoalescing && isNextEvent(LIBINPUT_EVENT_POINTER_MOTION, pe->nativeDevice())) {
+                    if (m_motionSamples.isEmpty()) {
+                        m_motionSamples.append({delta, deltaNonAccel, latestTimeUsec});
                     }
+                    PointerEvent p(m_eventQueue.peek(), LIBINPUT_EVENT_POINTER_MOTION);
+                    m_eventQueue.pop();
+                    m_motionSamples.append({p.delta(), p.deltaUnaccelerated(), p.timeMicroseconds()});
+                    delta += p.delta();
+                    deltaNonAccel += p.deltaUnaccelerated();
+                    latestTime = p.time();
+                    latestTimeUsec = p.timeMicroseconds();
                 }
-                emit pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
+                emit pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, m_motionSamples, pe->device());
                 break;
             }
             case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE: {
                 PointerEvent *pe = static_cast<PointerEvent*>(event.data());
+                if (m_motionCoalescing && isNextEvent(LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, pe->nativeDevice())) {
+                    // Only the last position matters, absolute motion has no relative motion samples.
+                    break;
+                }
                 emit pointerMotionAbsolute(pe->absolutePos(), pe->absolutePos(m_size), pe->time(), pe->device());
                 break;
             }
@@ -608,6 +679,10 @@ void Connection::processEvents()
                 break;
         }
     }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_eventQueueStalled.exchange(false)) {
+        QMetaObject::invokeMethod(this, &Connection::handleEvent, Qt::QueuedConnection);
+    }
     if (wasSuspended) {
         if (m_keyboardBeforeSuspend && !m_keyboard) {
             emit hasKeyboardChanged(false);
@@ -633,6 +708,12 @@ void Connection::setScreenSize(const QSize &size)
     m_size = size;
 }
 
+void Connection::setMotionCoalescingEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_motionCoalescing = enabled;
+}
+
 void Connection::updateScreens()
 {
     QMutexLocker locker(&m_mutex);
@@ -787,6 +868,7 @@ void Connection::updateLEDs(Xkb::LEDs leds)
     m_leds = leds;
     // update on devices
     const libinput_led l = static_cast<libinput_led>(toLibinputLEDS(leds));
+    QMutexLocker locker(Device::contextMutex());
     for (auto it = m_devices.constBegin(), end = m_devices.constEnd(); it != end; ++it) {
         libinput_device_led_update((*it)->device(), l);
     }
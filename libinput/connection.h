@@ -9,6 +9,7 @@
 #ifndef KWIN_LIBINPUT_CONNECTION_H
 #define KWIN_LIBINPUT_CONNECTION_H
 
+#include "eventring.h"
 #include "../input.h"
 #include "../keyboard_input.h"
 #include <kwinglobals.h>
@@ -20,6 +21,10 @@
 #include <QVector>
 #include <QStringList>
 
+#include <libinput.h>
+
+#include <atomic>
+
 class QSocketNotifier;
 class QThread;
 
@@ -52,6 +57,18 @@ public:
 
     void updateScreens();
 
+    /**
+     * Whether consecutive pointer motion events of a device are merged into one, so that
+     * the input filters and the focus update run once per batch of events read from
+     * libinput. The individual relative motions are kept in the motion samples. Enabled
+     * by default, can be disabled with the KWIN_LIBINPUT_MOTION_COALESCING environment
+     * variable.
+     */
+    bool isMotionCoalescingEnabled() const {
+        return m_motionCoalescing;
+    }
+    void setMotionCoalescingEnabled(bool enabled);
+
     bool hasKeyboard() const {
         return m_keyboard > 0;
     }
@@ -92,7 +109,8 @@ Q_SIGNALS:
     void keyChanged(quint32 key, KWin::InputRedirection::KeyboardKeyState, quint32 time, KWin::LibInput::Device *device);
     void pointerButtonChanged(quint32 button, KWin::InputRedirection::PointerButtonState state, quint32 time, KWin::LibInput::Device *device);
     void pointerMotionAbsolute(QPointF orig, QPointF screen, quint32 time, KWin::LibInput::Device *device);
-    void pointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint32 time, quint64 timeMicroseconds, KWin::LibInput::Device *device);
+    void pointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint32 time, quint64 timeMicroseconds,
+                       const QVector<KWin::PointerMotionSample> &samples, KWin::LibInput::Device *device);
     void pointerAxisChanged(KWin::InputRedirection::PointerAxis axis, qreal delta, qint32 discreteDelta,
         KWin::InputRedirection::PointerAxisSource source, quint32 time, KWin::LibInput::Device *device);
     void touchFrame(KWin::LibInput::Device *device);
@@ -142,6 +160,7 @@ private Q_SLOTS:
 private:
     Connection(Context *input, QObject *parent = nullptr);
     void handleEvent();
+    bool isNextEvent(libinput_event_type type, libinput_device *device) const;
     void applyDeviceConfig(Device *device);
     void applyScreenToDevice(Device *device);
     Context *m_input;
@@ -157,8 +176,17 @@ private:
     bool m_pointerBeforeSuspend = false;
     bool m_touchBeforeSuspend = false;
     bool m_tabletModeSwitchBeforeSuspend = false;
+    /**
+     * Guards the device state. The libinput calls are serialized by Device::contextMutex(),
+     * the events are passed from the libinput thread to the main thread through
+     * m_eventQueue without locking.
+     */
     QMutex m_mutex;
-    QVector<Event*> m_eventQueue;
+    EventRing<libinput_event *, 1024> m_eventQueue;
+    std::atomic<bool> m_eventsReadPending{false};
+    std::atomic<bool> m_eventQueueStalled{false};
+    bool m_motionCoalescing = true;
+    QVector<PointerMotionSample> m_motionSamples;
     bool wasSuspended = false;
     QVector<Device*> m_devices;
     KSharedConfigPtr m_config;
@@ -152,6 +152,11 @@ Event *Context::event()
     return Event::create(libinput_get_event(m_libinput));
 }
 
+libinput_event *Context::nativeEvent()
+{
+    return libinput_get_event(m_libinput);
+}
+
 void Context::suspend()
 {
     if (m_suspended) {
@@ -51,6 +51,11 @@ public:
      * The caller takes ownership of the returned pointer.
      */
     Event *event();
+    /**
+     * Like event(), but returns the native event without wrapping it. The caller
+     * has to destroy it with libinput_event_destroy.
+     */
+    libinput_event *nativeEvent();
 
     static int openRestrictedCallback(const char *path, int flags, void *user_data);
     static void closeRestrictedCallBack(int fd, void *user_data);
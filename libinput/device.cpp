@@ -9,6 +9,7 @@
 #include "device.h"
 
 #include <QDBusConnection>
+#include <QMutex>
 
 #include <linux/input.h>
 
@@ -46,6 +47,19 @@ static bool checkAlphaNumericKeyboard(libinput_device *device)
 
 QVector<Device*> Device::s_devices;
 
+QMutex *Device::contextMutex()
+{
+    static QMutex mutex(QMutex::Recursive);
+    return &mutex;
+}
+
+template <typename T>
+static bool applyConfig(T apply)
+{
+    QMutexLocker locker(Device::contextMutex());
+    return apply() == LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
 Device *Device::getDevice(libinput_device *native)
 {
     auto it = std::find_if(s_devices.constBegin(), s_devices.constEnd(),
@@ -259,6 +273,7 @@ Device::~Device()
 {
     s_devices.removeOne(this);
     QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/org/kde/KWin/InputDevice/") + m_sysName);
+    QMutexLocker locker(contextMutex());
     libinput_device_unref(m_device);
 }
 
@@ -313,7 +328,7 @@ void Device::setPointerAcceleration(qreal acceleration)
         return;
     }
     acceleration = qBound(-1.0, acceleration, 1.0);
-    if (libinput_device_config_accel_set_speed(m_device, acceleration) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_accel_set_speed(m_device, acceleration); })) {
         if (m_pointerAcceleration != acceleration) {
             m_pointerAcceleration = acceleration;
             emit pointerAccelerationChanged();
@@ -327,7 +342,7 @@ void Device::setScrollButton(quint32 button)
     if (!(m_supportedScrollMethods & LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN)) {
         return;
     }
-    if (libinput_device_config_scroll_set_button(m_device, button) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_scroll_set_button(m_device, button); })) {
         if (m_scrollButton != button) {
             m_scrollButton = button;
             writeEntry(ConfigKey::ScrollButton, m_scrollButton);
@@ -348,7 +363,7 @@ void Device::setPointerAccelerationProfile(bool set, enum  libinput_config_accel
         }
     }
 
-    if (libinput_device_config_accel_set_profile(m_device, profile) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_accel_set_profile(m_device, profile); })) {
         if (m_pointerAccelerationProfile != profile) {
             m_pointerAccelerationProfile = profile;
             emit pointerAccelerationProfileChanged();
@@ -369,7 +384,7 @@ void Device::setClickMethod(bool set, enum libinput_config_click_method method)
         }
     }
 
-    if (libinput_device_config_click_set_method(m_device, method) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_click_set_method(m_device, method); })) {
         if (m_clickMethod != method) {
             m_clickMethod = method;
             emit clickMethodChanged();
@@ -394,7 +409,7 @@ void Device::setScrollMethod(bool set, enum libinput_config_scroll_method method
         }
     }
 
-    if (libinput_device_config_scroll_set_method(m_device, method) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_scroll_set_method(m_device, method); })) {
         if (!isCurrent) {
             m_scrollMethod = method;
             emit scrollMethodChanged();
@@ -414,7 +429,7 @@ void Device::setLmrTapButtonMap(bool set)
         map = LIBINPUT_CONFIG_TAP_MAP_LRM;
     }
 
-    if (libinput_device_config_tap_set_button_map(m_device, map) == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+    if (applyConfig([&] { return libinput_device_config_tap_set_button_map(m_device, map); })) {
         if (m_tapButtonMap != map) {
             m_tapButtonMap = map;
             writeEntry(ConfigKey::LmrTapButtonMap, set);
@@ -439,7 +454,7 @@ void Device::method(bool set) \
     if (condition) { \
         return; \
     } \
-    if (libinput_device_config_##function(m_device, set) == LIBINPUT_CONFIG_STATUS_SUCCESS) { \
+    if (applyConfig([&] { return libinput_device_config_##function(m_device, set); })) { \
         if (m_##variable != set) { \
             m_##variable = set; \
             writeEntry(ConfigKey::key, m_##variable); \
@@ -459,7 +474,7 @@ void Device::method(bool set) \
     if (condition) { \
         return; \
     } \
-    if (libinput_device_config_##function(m_device, set ? LIBINPUT_CONFIG_##enum##_ENABLED : LIBINPUT_CONFIG_##enum##_DISABLED) == LIBINPUT_CONFIG_STATUS_SUCCESS) { \
+    if (applyConfig([&] { return libinput_device_config_##function(m_device, set ? LIBINPUT_CONFIG_##enum##_ENABLED : LIBINPUT_CONFIG_##enum##_DISABLED); })) { \
         if (m_##variable != set) { \
             m_##variable = set; \
             writeEntry(ConfigKey::key, m_##variable); \
@@ -534,7 +549,7 @@ void Device::setOrientation(Qt::ScreenOrientation orientation)
         columnOrder[0], columnOrder[4], columnOrder[8],
         columnOrder[1], columnOrder[5], columnOrder[9]
     };
-    libinput_device_config_calibration_set_matrix(m_device, m);
+    applyConfig([&] { return libinput_device_config_calibration_set_matrix(m_device, m); });
 }
 
 }
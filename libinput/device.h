@@ -13,6 +13,7 @@
 
 #include <KConfigGroup>
 
+#include <QMutex>
 #include <QObject>
 #include <QMatrix4x4>
 #include <QSizeF>
@@ -484,6 +485,11 @@ public:
      * Gets the Device for @p native. @c null if there is no Device for @p native.
      */
     static Device *getDevice(libinput_device *native);
+    /**
+     * Serializes the calls into libinput. The context is used by both the libinput thread
+     * and the main thread, but libinput is not thread-safe.
+     */
+    static QMutex *contextMutex();
 
 Q_SIGNALS:
     void tapButtonMapChanged();
@@ -0,0 +1,86 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_LIBINPUT_EVENTRING_H
+#define KWIN_LIBINPUT_EVENTRING_H
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+
+namespace KWin
+{
+namespace LibInput
+{
+
+/**
+ * The EventRing class is a bounded single producer, single consumer queue.
+ *
+ * The libinput thread pushes events while the main thread takes them, neither side ever
+ * blocks or allocates memory. Push must only be called from the producer thread, peek()
+ * and pop() only from the consumer thread.
+ */
+template <typename T, int Capacity>
+class EventRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * Appends @p value to the ring. Returns @c false if the ring is full.
+     */
+    bool push(const T &value) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_values[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isFull() const {
+        return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) == Capacity;
+    }
+
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Returns the oldest value without removing it, the ring must not be empty.
+     */
+    const T &peek() const {
+        Q_ASSERT(!isEmpty());
+        return m_values[m_head.load(std::memory_order_relaxed) & (Capacity - 1)];
+    }
+
+    /**
+     * Removes the oldest value, the ring must not be empty.
+     */
+    void pop() {
+        Q_ASSERT(!isEmpty());
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    static constexpr int capacity() {
+        return Capacity;
+    }
+
+private:
+    std::array<T, Capacity> m_values;
+    // Keep the indices in separate cache lines, each is written by one thread only.
+    alignas(64) std::atomic<quint32> m_head{0};
+    alignas(64) std::atomic<quint32> m_tail{0};
+};
+
+}
+}
+
+#endif
@@ -9,14 +9,23 @@
 #include "events.h"
 #include "device.h"
 
+#include <QMutex>
 #include <QSize>
 
+#include <new>
+
 namespace KWin
 {
 namespace LibInput
 {
 
-Event *Event::create(libinput_event *event)
+template <typename T, typename... Args>
+static Event *constructEvent(void *storage, Args... args)
+{
+    return storage ? new (storage) T(args...) : new T(args...);
+}
+
+Event *Event::create(libinput_event *event, void *storage)
 {
     if (!event) {
         return nullptr;
@@ -26,42 +35,42 @@ Event *Event::create(libinput_event *event)
     // TODO: add device notify events
     switch (t) {
     case LIBINPUT_EVENT_KEYBOARD_KEY:
-        return new KeyEvent(event);
+        return constructEvent<KeyEvent>(storage, event);
     case LIBINPUT_EVENT_POINTER_AXIS:
     case LIBINPUT_EVENT_POINTER_BUTTON:
     case LIBINPUT_EVENT_POINTER_MOTION:
     case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-        return new PointerEvent(event, t);
+        return constructEvent<PointerEvent>(storage, event, t);
     case LIBINPUT_EVENT_TOUCH_DOWN:
     case LIBINPUT_EVENT_TOUCH_UP:
     case LIBINPUT_EVENT_TOUCH_MOTION:
     case LIBINPUT_EVENT_TOUCH_CANCEL:
     case LIBINPUT_EVENT_TOUCH_FRAME:
-        return new TouchEvent(event, t);
+        return constructEvent<TouchEvent>(storage, event, t);
     case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
     case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
     case LIBINPUT_EVENT_GESTURE_SWIPE_END:
-        return new SwipeGestureEvent(event, t);
+        return constructEvent<SwipeGestureEvent>(storage, event, t);
     case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
     case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
     case LIBINPUT_EVENT_GESTURE_PINCH_END:
-        return new PinchGestureEvent(event, t);
+        return constructEvent<PinchGestureEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
     case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
     case LIBINPUT_EVENT_TABLET_TOOL_TIP:
-        return new TabletToolEvent(event, t);
+        return constructEvent<TabletToolEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
-        return new TabletToolButtonEvent(event, t);
+        return constructEvent<TabletToolButtonEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_RING:
-        return new TabletPadRingEvent(event, t);
+        return constructEvent<TabletPadRingEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_STRIP:
-        return new TabletPadStripEvent(event, t);
+        return constructEvent<TabletPadStripEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
-        return new TabletPadButtonEvent(event, t);
+        return constructEvent<TabletPadButtonEvent>(storage, event, t);
     case LIBINPUT_EVENT_SWITCH_TOGGLE:
-        return new SwitchEvent(event, t);
+        return constructEvent<SwitchEvent>(storage, event, t);
     default:
-        return new Event(event, t);
+        return storage ? new (storage) Event(event, t) : new Event(event, t);
     }
 }
 
@@ -74,6 +83,7 @@ Event::Event(libinput_event *event, libinput_event_type type)
 
 Event::~Event()
 {
+    QMutexLocker locker(Device::contextMutex());
     libinput_event_destroy(m_event);
 }
 
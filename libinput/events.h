@@ -13,6 +13,8 @@
 
 #include <libinput.h>
 
+#include <type_traits>
+
 namespace KWin
 {
 namespace LibInput
@@ -36,7 +38,12 @@ public:
         return m_event;
     }
 
-    static Event *create(libinput_event *event);
+    /**
+     * Wraps @p event in the matching Event subclass. If @p storage is not @c null the
+     * Event is constructed in place, it has to provide at least sizeof(EventStorage)
+     * bytes and the caller has to invoke the destructor instead of deleting it.
+     */
+    static Event *create(libinput_event *event, void *storage = nullptr);
 
 protected:
     Event(libinput_event *event, libinput_event_type type);
@@ -355,6 +362,14 @@ private:
     libinput_event_tablet_pad *m_tabletPadEvent;
 };
 
+/**
+ * Storage suitable for constructing any Event in place.
+ */
+using EventStorage = std::aligned_union_t<0, Event, KeyEvent, PointerEvent, TouchEvent,
+                                          PinchGestureEvent, SwipeGestureEvent, SwitchEvent,
+                                          TabletToolEvent, TabletToolButtonEvent, TabletPadRingEvent,
+                                          TabletPadStripEvent, TabletPadButtonEvent>;
+
 inline
 libinput_event_type Event::type() const
 {
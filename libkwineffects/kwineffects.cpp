@@ -687,6 +687,11 @@ bool Effect::touchUp(qint32 id, quint32 time)
     return false;
 }
 
+bool Effect::blocksDirectScanout() const
+{
+    return true;
+}
+
 bool Effect::perform(Feature feature, const QVariantList &arguments)
 {
     Q_UNUSED(feature)
@@ -928,6 +933,7 @@ bool WindowQuad::smoothNeeded() const
 WindowQuadList WindowQuadList::splitAtX(double x) const
 {
     WindowQuadList ret;
+    ret.reserve(count() * 2);
     foreach (const WindowQuad & quad, *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
@@ -960,6 +966,7 @@ WindowQuadList WindowQuadList::splitAtX(double x) const
 WindowQuadList WindowQuadList::splitAtY(double y) const
 {
     WindowQuadList ret;
+    ret.reserve(count() * 2);
     foreach (const WindowQuad & quad, *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
@@ -1011,7 +1018,21 @@ WindowQuadList WindowQuadList::makeGrid(int maxQuadSize) const
         bottom = qMax(bottom, quad.bottom());
     }
 
+    // Grids with thousands of quads are rebuilt every frame, avoid growing the list
+    // step by step.
+    int cellCount = 0;
+    foreach (const WindowQuad &quad, *this) {
+        if (quad.left() == quad.right() || quad.top() == quad.bottom()) {
+            cellCount++;
+            continue;
+        }
+        const int columns = qFloor((quad.right() - left) / maxQuadSize) - qFloor((quad.left() - left) / maxQuadSize) + 1;
+        const int rows = qFloor((quad.bottom() - top) / maxQuadSize) - qFloor((quad.top() - top) / maxQuadSize) + 1;
+        cellCount += columns * rows;
+    }
+
     WindowQuadList ret;
+    ret.reserve(cellCount);
 
     foreach (const WindowQuad &quad, *this) {
         const double quadLeft   = quad.left();
@@ -1071,7 +1092,19 @@ WindowQuadList WindowQuadList::makeRegularGrid(int xSubdivisions, int ySubdivisi
     double xIncrement = (right - left) / xSubdivisions;
     double yIncrement = (bottom - top) / ySubdivisions;
 
+    int cellCount = 0;
+    foreach (const WindowQuad &quad, *this) {
+        if (quad.left() == quad.right() || quad.top() == quad.bottom()) {
+            cellCount++;
+            continue;
+        }
+        const int columns = qFloor((quad.right() - left) / xIncrement) - qFloor((quad.left() - left) / xIncrement) + 1;
+        const int rows = qFloor((quad.bottom() - top) / yIncrement) - qFloor((quad.top() - top) / yIncrement) + 1;
+        cellCount += columns * rows;
+    }
+
     WindowQuadList ret;
+    ret.reserve(cellCount);
 
     foreach (const WindowQuad &quad, *this) {
         const double quadLeft   = quad.left();
@@ -71,6 +71,7 @@ class EffectFrame;
 class EffectFramePrivate;
 class EffectQuickView;
 class Effect;
+class WindowVertex;
 class WindowQuad;
 class GLShader;
 class XRenderPicture;
@@ -175,7 +176,7 @@ X-KDE-Library=kwin4_effect_cooleffect
 
 #define KWIN_EFFECT_API_MAKE_VERSION( major, minor ) (( major ) << 8 | ( minor ))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 230
+#define KWIN_EFFECT_API_VERSION_MINOR 232
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
         KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR )
 
@@ -619,6 +620,18 @@ public:
      */
     virtual bool touchUp(qint32 id, quint32 time);
 
+    /**
+     * Whether this effect prevents fullscreen windows from being scanned out directly.
+     *
+     * While a window is scanned out the compositor doesn't paint the output at all, so
+     * effects can neither alter the window nor paint on top of it. Effects that don't need
+     * to do either while they are active should reimplement this method and return @c false.
+     *
+     * The method is only called for active effects. The default implementation returns @c true.
+     * @since 5.20
+     */
+    virtual bool blocksDirectScanout() const;
+
     static QPoint cursorPos();
 
     /**
@@ -2508,6 +2521,9 @@ struct GLVertex3D
  *
  * A vertex is one position in a window. WindowQuad consists of four WindowVertex objects
  * and represents one part of a window.
+ *
+ * The coordinates are stored with single precision, which is what the GPU uses anyway,
+ * in order to keep grids of thousands of quads small.
  */
 class KWINEFFECTS_EXPORT WindowVertex
 {
@@ -2531,9 +2547,9 @@ public:
 private:
     friend class WindowQuad;
     friend class WindowQuadList;
-    double px, py; // position
-    double ox, oy; // origional position
-    double tx, ty; // texture coords
+    float px, py; // position
+    float ox, oy; // origional position
+    float tx, ty; // texture coords
 };
 
 /**
@@ -2573,8 +2589,23 @@ private:
     int quadID;
 };
 
+} // namespace KWin
+
+// Vertices and quads are relocated with memcpy when a WindowQuadList grows.
+Q_DECLARE_TYPEINFO(KWin::WindowVertex, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(KWin::WindowQuad, Q_MOVABLE_TYPE);
+
+namespace KWin
+{
+
+/**
+ * @short List of WindowQuad objects.
+ *
+ * The quads are stored contiguously, effects that transform every vertex of a grid
+ * walk linear memory.
+ */
 class KWINEFFECTS_EXPORT WindowQuadList
-    : public QList< WindowQuad >
+    : public QVector< WindowQuad >
 {
 public:
     WindowQuadList splitAtX(double x) const;
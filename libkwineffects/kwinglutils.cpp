@@ -69,6 +69,9 @@ void initGL(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
 
     GLTexturePrivate::initStatic();
     GLRenderTarget::initStatic();
+    GLRenderTimeQuery::initStatic();
+    GLPixelReadback::initStatic();
+    GLPixelUploadBuffer::initStatic();
     GLVertexBuffer::initStatic();
 }
 
@@ -77,6 +80,9 @@ void cleanupGL()
     ShaderManager::cleanup();
     GLTexturePrivate::cleanup();
     GLRenderTarget::cleanup();
+    GLRenderTimeQuery::cleanup();
+    GLPixelReadback::cleanup();
+    GLPixelUploadBuffer::cleanup();
     GLVertexBuffer::cleanup();
     GLPlatform::cleanup();
 
@@ -1318,6 +1324,344 @@ void GLRenderTarget::detachTexture()
 }
 
 
+/***  GLRenderTimeQuery  ***/
+bool GLRenderTimeQuery::s_supported = false;
+
+void GLRenderTimeQuery::initStatic()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        s_supported = hasGLExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"));
+    } else {
+        s_supported = hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query"));
+    }
+}
+
+void GLRenderTimeQuery::cleanup()
+{
+    s_supported = false;
+}
+
+GLRenderTimeQuery::GLRenderTimeQuery()
+{
+    if (!s_supported) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glGenQueriesEXT(1, &m_query);
+    } else {
+        glGenQueries(1, &m_query);
+    }
+}
+
+GLRenderTimeQuery::~GLRenderTimeQuery()
+{
+    if (!m_query) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glDeleteQueriesEXT(1, &m_query);
+    } else {
+        glDeleteQueries(1, &m_query);
+    }
+}
+
+void GLRenderTimeQuery::begin()
+{
+    if (!m_query) {
+        return;
+    }
+    // The current GPU time is returned once all previous commands have been submitted,
+    // but without waiting for them to finish.
+    if (GLPlatform::instance()->isGLES()) {
+        glGetInteger64vEXT(GL_TIMESTAMP_EXT, &m_beginTimestamp);
+    } else {
+        glGetInteger64v(GL_TIMESTAMP, &m_beginTimestamp);
+    }
+    m_pending = false;
+}
+
+void GLRenderTimeQuery::end()
+{
+    if (!m_query) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glQueryCounterEXT(m_query, GL_TIMESTAMP_EXT);
+    } else {
+        glQueryCounter(m_query, GL_TIMESTAMP);
+    }
+    m_pending = true;
+}
+
+qint64 GLRenderTimeQuery::result()
+{
+    if (!m_pending) {
+        return -1;
+    }
+
+    GLuint64 endTimestamp = 0;
+    if (GLPlatform::instance()->isGLES()) {
+        GLint available = 0;
+        glGetQueryObjectivEXT(m_query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available) {
+            return -1;
+        }
+        glGetQueryObjectui64vEXT(m_query, GL_QUERY_RESULT_EXT, &endTimestamp);
+
+        // The timestamps are meaningless if the GPU has been reset or changed its clock.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            m_pending = false;
+            return -1;
+        }
+    } else {
+        GLint available = 0;
+        glGetQueryObjectiv(m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return -1;
+        }
+        glGetQueryObjectui64v(m_query, GL_QUERY_RESULT, &endTimestamp);
+    }
+    m_pending = false;
+
+    return qMax<qint64>(0, qint64(endTimestamp) - m_beginTimestamp);
+}
+
+
+/***  GLTimestampQuery  ***/
+GLTimestampQuery::GLTimestampQuery()
+{
+    if (!GLRenderTimeQuery::supported()) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glGenQueriesEXT(1, &m_query);
+    } else {
+        glGenQueries(1, &m_query);
+    }
+}
+
+GLTimestampQuery::~GLTimestampQuery()
+{
+    if (!m_query) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glDeleteQueriesEXT(1, &m_query);
+    } else {
+        glDeleteQueries(1, &m_query);
+    }
+}
+
+void GLTimestampQuery::record()
+{
+    if (!m_query) {
+        return;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        glQueryCounterEXT(m_query, GL_TIMESTAMP_EXT);
+    } else {
+        glQueryCounter(m_query, GL_TIMESTAMP);
+    }
+}
+
+bool GLTimestampQuery::isAvailable() const
+{
+    if (!m_query) {
+        return false;
+    }
+    GLint available = 0;
+    if (GLPlatform::instance()->isGLES()) {
+        glGetQueryObjectivEXT(m_query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+    } else {
+        glGetQueryObjectiv(m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    return available;
+}
+
+qint64 GLTimestampQuery::timestamp() const
+{
+    if (!m_query) {
+        return 0;
+    }
+    GLuint64 timestamp = 0;
+    if (GLPlatform::instance()->isGLES()) {
+        glGetQueryObjectui64vEXT(m_query, GL_QUERY_RESULT_EXT, &timestamp);
+    } else {
+        glGetQueryObjectui64v(m_query, GL_QUERY_RESULT, &timestamp);
+    }
+    return timestamp;
+}
+
+bool GLTimestampQuery::isDisjoint()
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        return false;
+    }
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    return disjoint;
+}
+
+
+/***  GLPixelReadback  ***/
+bool GLPixelReadback::s_supported = false;
+
+void GLPixelReadback::initStatic()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        s_supported = hasGLVersion(3, 0);
+    } else {
+        s_supported = hasGLVersion(3, 2) || (hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+    }
+}
+
+void GLPixelReadback::cleanup()
+{
+    s_supported = false;
+}
+
+GLPixelReadback::GLPixelReadback()
+{
+    if (s_supported) {
+        glGenBuffers(1, &m_buffer);
+    }
+}
+
+GLPixelReadback::~GLPixelReadback()
+{
+    if (m_sync) {
+        glDeleteSync(m_sync);
+    }
+    if (m_buffer) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+void GLPixelReadback::begin(int size)
+{
+    if (!m_buffer) {
+        return;
+    }
+    if (m_sync) {
+        glDeleteSync(m_sync);
+        m_sync = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    if (m_size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        m_size = size;
+    }
+}
+
+void GLPixelReadback::end()
+{
+    if (!m_buffer) {
+        return;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool GLPixelReadback::isComplete(bool wait)
+{
+    if (!m_sync) {
+        return false;
+    }
+    // Flush the pending commands, otherwise the fence might never be signaled.
+    const GLenum result = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+const uchar *GLPixelReadback::map()
+{
+    if (!m_buffer) {
+        return nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    const void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_size, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return static_cast<const uchar *>(data);
+}
+
+void GLPixelReadback::unmap()
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+/***  GLPixelUploadBuffer  ***/
+bool GLPixelUploadBuffer::s_supported = false;
+GLPixelUploadBuffer *GLPixelUploadBuffer::s_streamingBuffer = nullptr;
+
+void GLPixelUploadBuffer::initStatic()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        s_supported = hasGLVersion(3, 0);
+    } else {
+        s_supported = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range"));
+    }
+}
+
+void GLPixelUploadBuffer::cleanup()
+{
+    delete s_streamingBuffer;
+    s_streamingBuffer = nullptr;
+    s_supported = false;
+}
+
+GLPixelUploadBuffer *GLPixelUploadBuffer::streamingBuffer()
+{
+    if (!s_supported) {
+        return nullptr;
+    }
+    if (!s_streamingBuffer) {
+        s_streamingBuffer = new GLPixelUploadBuffer;
+    }
+    return s_streamingBuffer;
+}
+
+GLPixelUploadBuffer::GLPixelUploadBuffer()
+{
+    glGenBuffers(s_poolSize, m_buffers);
+}
+
+GLPixelUploadBuffer::~GLPixelUploadBuffer()
+{
+    glDeleteBuffers(s_poolSize, m_buffers);
+}
+
+uchar *GLPixelUploadBuffer::map(int size)
+{
+    m_index = (m_index + 1) % s_poolSize;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_index]);
+    if (m_sizes[m_index] < size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        m_sizes[m_index] = size;
+    }
+    // Invalidating the buffer lets the driver hand out fresh storage while the previous
+    // upload from it is still in flight.
+    void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!data) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    return static_cast<uchar *>(data);
+}
+
+void GLPixelUploadBuffer::unmap()
+{
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void GLPixelUploadBuffer::release()
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+
 // ------------------------------------------------------------------
 
 static const uint16_t indices[] = {
@@ -559,6 +559,229 @@ private:
     GLuint mFramebuffer;
 };
 
+/**
+ * @short Measures the time it takes the GPU to render a frame
+ *
+ * The query records the GPU time when begin() is called and a GPU timestamp once all
+ * commands issued before end() have been executed. The result is the time between these
+ * two points, that is the combined CPU and GPU time needed to render the frame.
+ *
+ * The result is read back without stalling the pipeline, if the GPU has not finished
+ * executing the commands yet, result() returns @c -1.
+ *
+ * Timer queries require OpenGL 3.3, GL_ARB_timer_query or GL_EXT_disjoint_timer_query on
+ * OpenGL ES. If they are not supported, the query does nothing.
+ * @since 5.20
+ */
+class KWINGLUTILS_EXPORT GLRenderTimeQuery
+{
+public:
+    GLRenderTimeQuery();
+    ~GLRenderTimeQuery();
+
+    /**
+     * Marks the beginning of the frame.
+     */
+    void begin();
+    /**
+     * Marks the end of the frame.
+     */
+    void end();
+    /**
+     * Returns the time between begin() and the completion of all commands issued
+     * before end(), in nanoseconds, or @c -1 if the result is not available yet.
+     *
+     * The result can be read only once.
+     */
+    qint64 result();
+
+    /**
+     * @return @c true if timer queries are supported
+     */
+    static bool supported() {
+        return s_supported;
+    }
+
+    /**
+     * @internal
+     */
+    static void initStatic();
+
+private:
+    friend void KWin::cleanupGL();
+    static void cleanup();
+    static bool s_supported;
+
+    GLuint m_query = 0;
+    GLint64 m_beginTimestamp = 0;
+    bool m_pending = false;
+};
+
+/**
+ * @short Records the GPU time at which all previously issued commands have been executed
+ *
+ * Unlike GL_TIME_ELAPSED queries, timestamp queries can be issued while other queries are
+ * in flight, so the time spent in nested sections of a frame can be measured by recording
+ * a timestamp at the beginning and the end of every section.
+ *
+ * Timestamp queries are supported if GLRenderTimeQuery::supported() returns @c true.
+ * @since 5.20
+ */
+class KWINGLUTILS_EXPORT GLTimestampQuery
+{
+public:
+    GLTimestampQuery();
+    ~GLTimestampQuery();
+
+    /**
+     * Records the GPU timestamp once all commands issued so far have been executed.
+     */
+    void record();
+    /**
+     * Returns @c true if the timestamp of the last record() call can be read without
+     * stalling the pipeline.
+     */
+    bool isAvailable() const;
+    /**
+     * Returns the recorded GPU timestamp in nanoseconds. Blocks until the GPU has executed
+     * the commands if isAvailable() returns @c false.
+     */
+    qint64 timestamp() const;
+
+    /**
+     * Returns @c true if the GPU timestamps recorded since the last call can't be compared,
+     * for example because the GPU has been reset or changed its clock. Reading the state
+     * clears it.
+     */
+    static bool isDisjoint();
+
+private:
+    GLuint m_query = 0;
+};
+
+/**
+ * @short Reads back pixels from the GPU without stalling the pipeline
+ *
+ * Between begin() and end() the buffer is bound as the pixel pack buffer, so glReadPixels()
+ * and glGet*Tex*Image() write into the buffer at the offset passed in place of the pixel
+ * pointer and return immediately. end() inserts a fence after the read commands, once
+ * isComplete() returns @c true the pixels can be accessed with map() without waiting for
+ * the GPU.
+ *
+ * Asynchronous readback requires OpenGL 3.2, OpenGL 3.0 with GL_ARB_sync or OpenGL ES 3.0.
+ * @since 5.20
+ */
+class KWINGLUTILS_EXPORT GLPixelReadback
+{
+public:
+    GLPixelReadback();
+    ~GLPixelReadback();
+
+    /**
+     * Binds the buffer as GL_PIXEL_PACK_BUFFER and makes sure it can hold @p size bytes.
+     */
+    void begin(int size);
+    /**
+     * Unbinds the buffer and inserts a fence after the read commands.
+     */
+    void end();
+    /**
+     * Returns @c true if all read commands issued before end() have finished. If @p wait
+     * is @c true, blocks until that's the case.
+     */
+    bool isComplete(bool wait = false);
+    /**
+     * Maps the buffer for reading. Returns @c nullptr if the buffer could not be mapped.
+     */
+    const uchar *map();
+    void unmap();
+
+    /**
+     * @return @c true if asynchronous readback is supported
+     */
+    static bool supported() {
+        return s_supported;
+    }
+
+    /**
+     * @internal
+     */
+    static void initStatic();
+
+private:
+    friend void KWin::cleanupGL();
+    static void cleanup();
+    static bool s_supported;
+
+    GLuint m_buffer = 0;
+    GLsync m_sync = nullptr;
+    int m_size = 0;
+};
+
+/**
+ * @short Streams pixel data to textures through pixel buffer objects
+ *
+ * The pixels are written into a mapped buffer, which is bound as the pixel unpack buffer
+ * until release() is called. glTexSubImage2D() takes offsets into the buffer in place of
+ * pixel pointers and returns without copying the pixels, the transfer to the texture
+ * happens asynchronously.
+ *
+ * The uploader keeps a small pool of buffers that are used in turn and orphaned when they
+ * are mapped, so mapping never waits for a previous upload to finish.
+ *
+ * Streaming uploads require OpenGL 3.0, GL_ARB_map_buffer_range or OpenGL ES 3.0.
+ * @since 5.20
+ */
+class KWINGLUTILS_EXPORT GLPixelUploadBuffer
+{
+public:
+    /**
+     * Binds the next buffer of the pool as GL_PIXEL_UNPACK_BUFFER and maps @p size bytes
+     * of it for writing. Returns @c nullptr if the buffer could not be mapped, in which
+     * case no buffer is bound.
+     */
+    uchar *map(int size);
+    /**
+     * Unmaps the buffer. It stays bound until release() is called.
+     */
+    void unmap();
+    /**
+     * Unbinds the buffer after the uploads from it have been issued.
+     */
+    void release();
+
+    /**
+     * @return @c true if streaming uploads are supported
+     */
+    static bool supported() {
+        return s_supported;
+    }
+
+    /**
+     * Returns the shared uploader, or @c nullptr if streaming uploads are not supported.
+     */
+    static GLPixelUploadBuffer *streamingBuffer();
+
+    /**
+     * @internal
+     */
+    static void initStatic();
+
+private:
+    GLPixelUploadBuffer();
+    ~GLPixelUploadBuffer();
+
+    friend void KWin::cleanupGL();
+    static void cleanup();
+    static bool s_supported;
+    static GLPixelUploadBuffer *s_streamingBuffer;
+
+    static const int s_poolSize = 4;
+    GLuint m_buffers[s_poolSize] = {};
+    int m_sizes[s_poolSize] = {};
+    int m_index = 0;
+};
+
 enum VertexAttributeType {
     VA_Position = 0,
     VA_TexCoord = 1,
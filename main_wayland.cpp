@@ -210,7 +210,8 @@ void ApplicationWayland::continueStartupWithScene()
         exit(code);
     });
     connect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
-    m_xwayland->start();
+    m_xwayland->start(m_startXwaylandOnDemand ? Xwl::Xwayland::StartMode::OnDemand
+                                              : Xwl::Xwayland::StartMode::Immediately);
 }
 
 void ApplicationWayland::startSession()
@@ -458,6 +459,8 @@ int main(int argc, char * argv[])
 
     QCommandLineOption xwaylandOption(QStringLiteral("xwayland"),
                                       i18n("Start a rootless Xwayland server."));
+    QCommandLineOption xwaylandOnDemandOption(QStringLiteral("xwayland-on-demand"),
+                                              i18n("Start a rootless Xwayland server once the first X11 client connects."));
     QCommandLineOption waylandSocketOption(QStringList{QStringLiteral("s"), QStringLiteral("socket")},
                                            i18n("Name of the Wayland socket to listen on. If not set \"wayland-0\" is used."),
                                            QStringLiteral("socket"));
@@ -495,6 +498,7 @@ int main(int argc, char * argv[])
     QCommandLineParser parser;
     a.setupCommandLine(&parser);
     parser.addOption(xwaylandOption);
+    parser.addOption(xwaylandOnDemandOption);
     parser.addOption(waylandSocketOption);
     if (hasX11Option) {
         parser.addOption(x11DisplayOption);
@@ -695,7 +699,8 @@ int main(int argc, char * argv[])
     QObject::connect(&a, &KWin::Application::workspaceCreated, server, &KWin::WaylandServer::initWorkspace);
     environment.insert(QStringLiteral("WAYLAND_DISPLAY"), server->display()->socketName());
     a.setProcessStartupEnvironment(environment);
-    a.setStartXwayland(parser.isSet(xwaylandOption));
+    a.setStartXwayland(parser.isSet(xwaylandOption) || parser.isSet(xwaylandOnDemandOption));
+    a.setStartXwaylandOnDemand(parser.isSet(xwaylandOnDemandOption));
     a.setApplicationsToStart(parser.positionalArguments());
     a.setInputMethodServerToStart(parser.value(inputMethodOption));
     a.start();
@@ -28,6 +28,9 @@ public:
     void setStartXwayland(bool start) {
         m_startXWayland = start;
     }
+    void setStartXwaylandOnDemand(bool onDemand) {
+        m_startXwaylandOnDemand = onDemand;
+    }
     void setApplicationsToStart(const QStringList &applications) {
         m_applicationsToStart = applications;
     }
@@ -56,6 +59,7 @@ private:
     void startSession() override;
 
     bool m_startXWayland = false;
+    bool m_startXwaylandOnDemand = false;
     QStringList m_applicationsToStart;
     QString m_inputMethodServerToStart;
     QProcessEnvironment m_environment;
@@ -0,0 +1,144 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "occlusionmask.h"
+
+namespace KWin
+{
+
+static const int s_bitsPerWord = 64;
+
+static quint64 wordMask(int firstBit, int lastBit)
+{
+    const quint64 upper = lastBit == s_bitsPerWord - 1 ? ~quint64(0) : (quint64(1) << (lastBit + 1)) - 1;
+    return upper & ~((quint64(1) << firstBit) - 1);
+}
+
+OcclusionMask::OcclusionMask(const QRect &area, int tileSize)
+    : m_tileSize(tileSize)
+{
+    Q_ASSERT(tileSize > 0);
+    reset(area);
+}
+
+void OcclusionMask::reset(const QRect &area)
+{
+    if (m_area != area) {
+        m_area = area;
+        m_columns = (area.width() + m_tileSize - 1) / m_tileSize;
+        m_rows = (area.height() + m_tileSize - 1) / m_tileSize;
+        m_wordsPerRow = (m_columns + s_bitsPerWord - 1) / s_bitsPerWord;
+        m_bits.resize(m_rows * m_wordsPerRow);
+    }
+    m_bits.fill(0);
+}
+
+void OcclusionMask::add(const QRegion &region)
+{
+    for (const QRect &rect : region) {
+        add(rect);
+    }
+}
+
+void OcclusionMask::add(const QRect &rect)
+{
+    const QRect clipped = rect & m_area;
+    if (clipped.isEmpty()) {
+        return;
+    }
+
+    // The last tile of a row or column may be cut off by the edge of the area, it is
+    // covered if the part inside the area is.
+    const int left = clipped.left() - m_area.left();
+    const int top = clipped.top() - m_area.top();
+    const int right = clipped.right() + 1 - m_area.left();
+    const int bottom = clipped.bottom() + 1 - m_area.top();
+
+    const int firstColumn = (left + m_tileSize - 1) / m_tileSize;
+    const int firstRow = (top + m_tileSize - 1) / m_tileSize;
+    const int lastColumn = right == m_area.width() ? m_columns - 1 : right / m_tileSize - 1;
+    const int lastRow = bottom == m_area.height() ? m_rows - 1 : bottom / m_tileSize - 1;
+
+    if (firstColumn > lastColumn) {
+        return;
+    }
+    for (int row = firstRow; row <= lastRow; ++row) {
+        setRowRange(row, firstColumn, lastColumn);
+    }
+}
+
+bool OcclusionMask::covers(const QRegion &region) const
+{
+    if (region.isEmpty()) {
+        return true;
+    }
+    if (covers(region.boundingRect())) {
+        return true;
+    }
+    if (region.rectCount() == 1) {
+        return false;
+    }
+    for (const QRect &rect : region) {
+        if (!covers(rect)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OcclusionMask::covers(const QRect &rect) const
+{
+    if (rect.isEmpty()) {
+        return true;
+    }
+    if (!m_area.contains(rect)) {
+        return false;
+    }
+
+    const int firstColumn = (rect.left() - m_area.left()) / m_tileSize;
+    const int firstRow = (rect.top() - m_area.top()) / m_tileSize;
+    const int lastColumn = (rect.right() - m_area.left()) / m_tileSize;
+    const int lastRow = (rect.bottom() - m_area.top()) / m_tileSize;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        if (!isRowRangeSet(row, firstColumn, lastColumn)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OcclusionMask::isRowRangeSet(int row, int firstColumn, int lastColumn) const
+{
+    const quint64 *words = m_bits.constData() + row * m_wordsPerRow;
+    const int firstWord = firstColumn / s_bitsPerWord;
+    const int lastWord = lastColumn / s_bitsPerWord;
+    for (int word = firstWord; word <= lastWord; ++word) {
+        const int firstBit = word == firstWord ? firstColumn % s_bitsPerWord : 0;
+        const int lastBit = word == lastWord ? lastColumn % s_bitsPerWord : s_bitsPerWord - 1;
+        const quint64 mask = wordMask(firstBit, lastBit);
+        if ((words[word] & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void OcclusionMask::setRowRange(int row, int firstColumn, int lastColumn)
+{
+    quint64 *words = m_bits.data() + row * m_wordsPerRow;
+    const int firstWord = firstColumn / s_bitsPerWord;
+    const int lastWord = lastColumn / s_bitsPerWord;
+    for (int word = firstWord; word <= lastWord; ++word) {
+        const int firstBit = word == firstWord ? firstColumn % s_bitsPerWord : 0;
+        const int lastBit = word == lastWord ? lastColumn % s_bitsPerWord : s_bitsPerWord - 1;
+        words[word] |= wordMask(firstBit, lastBit);
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,79 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_OCCLUSIONMASK_H
+#define KWIN_OCCLUSIONMASK_H
+
+#include <kwin_export.h>
+
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The OcclusionMask class is a coarse bitmap of the parts of an area that are known to be
+ * occluded.
+ *
+ * The area is divided into square tiles, a tile is marked once it is completely covered
+ * by one of the rectangles added to the mask. The mask therefore never claims more than
+ * the union of the added regions, but it may claim less. Checking whether a region is
+ * covered only tests a few bits, while the same question answered with QRegion gets more
+ * expensive with every rectangle in the accumulated occluded region.
+ */
+class KWIN_EXPORT OcclusionMask
+{
+public:
+    explicit OcclusionMask(const QRect &area = QRect(), int tileSize = 32);
+
+    QRect area() const;
+    int tileSize() const;
+
+    /**
+     * Resets the mask to @p area, nothing is occluded afterwards.
+     */
+    void reset(const QRect &area);
+    /**
+     * Marks all tiles that are completely covered by a rectangle of @p region.
+     */
+    void add(const QRegion &region);
+    void add(const QRect &rect);
+    /**
+     * Returns @c true if every rectangle of @p region lies in occluded tiles. An empty region
+     * is always covered, a region that reaches outside of the area never is.
+     */
+    bool covers(const QRegion &region) const;
+    bool covers(const QRect &rect) const;
+
+private:
+    bool isRowRangeSet(int row, int firstColumn, int lastColumn) const;
+    void setRowRange(int row, int firstColumn, int lastColumn);
+
+    QRect m_area;
+    int m_tileSize;
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_wordsPerRow = 0;
+    QVector<quint64> m_bits;
+};
+
+inline QRect OcclusionMask::area() const
+{
+    return m_area;
+}
+
+inline int OcclusionMask::tileSize() const
+{
+    return m_tileSize;
+}
+
+} // namespace KWin
+
+#endif
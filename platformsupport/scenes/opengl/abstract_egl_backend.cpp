@@ -472,28 +472,92 @@ bool AbstractEglTexture::createTextureImage(const QImage &image)
     return true;
 }
 
-void AbstractEglTexture::createTextureSubImage(const QImage &image, const QRegion &damage)
+// Damage below this size is uploaded straight from the image, mapping a pixel buffer
+// isn't worth it for a blinking cursor.
+static const int s_minimumStreamingUploadSize = 64 * 1024;
+
+void AbstractEglTexture::createTextureSubImage(const QImage &image, const QRegion &damagedRegion)
 {
-    q->bind();
+    // The pixels are accessed directly, so the damage must not exceed the image.
+    const QRegion damage = damagedRegion & image.rect();
+
+    // Pick the pixel format matching the texture and check whether the image already
+    // has it, in which case the damaged rects can be uploaded without any conversion.
+    GLenum format = GL_BGRA;
+    QImage::Format imageFormat = QImage::Format_ARGB32_Premultiplied;
+    bool canUploadDirectly = false;
     if (GLPlatform::instance()->isGLES()) {
         if (s_supportsARGB32 && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)) {
-            const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-            for (const QRect &rect : damage) {
-                glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, im.copy(rect).bits());
-            }
+            format = GL_BGRA_EXT;
+            canUploadDirectly = image.format() == QImage::Format_ARGB32_Premultiplied;
         } else {
-            const QImage im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-            for (const QRect &rect : damage) {
-                glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                                GL_RGBA, GL_UNSIGNED_BYTE, im.copy(rect).bits());
+            format = GL_RGBA;
+            imageFormat = QImage::Format_RGBA8888_Premultiplied;
+            canUploadDirectly = image.format() == QImage::Format_RGBA8888_Premultiplied;
+        }
+    } else {
+        // The alpha channel of an RGB32 image is ignored by the GL_RGB8 texture.
+        canUploadDirectly = image.format() == QImage::Format_ARGB32_Premultiplied || image.format() == QImage::Format_RGB32;
+    }
+
+    q->bind();
+    if (!canUploadDirectly) {
+        // Only the damaged rects are converted, not the whole image.
+        for (const QRect &rect : damage) {
+            const QImage im = image.copy(rect).convertToFormat(imageFormat);
+            glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            format, GL_UNSIGNED_BYTE, im.constBits());
+        }
+        q->unbind();
+        return;
+    }
+
+    const int bytesPerLine = image.bytesPerLine();
+    int uploadSize = 0;
+    for (const QRect &rect : damage) {
+        uploadSize += rect.width() * rect.height() * 4;
+    }
+
+    if (uploadSize >= s_minimumStreamingUploadSize) {
+        if (GLPixelUploadBuffer *buffer = GLPixelUploadBuffer::streamingBuffer()) {
+            if (uchar *data = buffer->map(uploadSize)) {
+                // Pack the damaged rects tightly into the pixel buffer.
+                int offset = 0;
+                for (const QRect &rect : damage) {
+                    const uchar *source = image.constBits() + rect.y() * bytesPerLine + rect.x() * 4;
+                    for (int y = 0; y < rect.height(); ++y) {
+                        memcpy(data + offset + y * rect.width() * 4, source + y * bytesPerLine, rect.width() * 4);
+                    }
+                    offset += rect.width() * rect.height() * 4;
+                }
+                buffer->unmap();
+
+                offset = 0;
+                for (const QRect &rect : damage) {
+                    glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                                    format, GL_UNSIGNED_BYTE, reinterpret_cast<const GLvoid *>(quintptr(offset)));
+                    offset += rect.width() * rect.height() * 4;
+                }
+                buffer->release();
+                q->unbind();
+                return;
             }
         }
+    }
+
+    if (s_supportsUnpack) {
+        // Let the driver pick the rects straight out of the image.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bytesPerLine / 4);
+        for (const QRect &rect : damage) {
+            glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            format, GL_UNSIGNED_BYTE, image.constBits() + rect.y() * bytesPerLine + rect.x() * 4);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     } else {
-        const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
         for (const QRect &rect : damage) {
+            const QImage im = image.copy(rect);
             glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                            GL_BGRA, GL_UNSIGNED_BYTE, im.copy(rect).bits());
+                            format, GL_UNSIGNED_BYTE, im.constBits());
         }
     }
     q->unbind();
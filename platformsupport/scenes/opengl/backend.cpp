@@ -47,26 +47,14 @@ void OpenGLBackend::idle()
 
 void OpenGLBackend::addToDamageHistory(const QRegion &region)
 {
-    if (m_damageHistory.count() > 10)
-        m_damageHistory.removeLast();
-
-    m_damageHistory.prepend(region);
+    m_damageJournal.add(region);
 }
 
 QRegion OpenGLBackend::accumulatedDamageHistory(int bufferAge) const
 {
-    QRegion region;
-
-    // Note: An age of zero means the buffer contents are undefined
-    if (bufferAge > 0 && bufferAge <= m_damageHistory.count()) {
-        for (int i = 0; i < bufferAge - 1; i++)
-            region |= m_damageHistory[i];
-    } else {
-        const QSize &s = screens()->size();
-        region = QRegion(0, 0, s.width(), s.height());
-    }
-
-    return region;
+    const QSize &s = screens()->size();
+    const QRegion displayRegion(0, 0, s.width(), s.height());
+    return m_damageJournal.accumulate(bufferAge, displayRegion) & displayRegion;
 }
 
 OverlayWindow* OpenGLBackend::overlayWindow() const
@@ -92,6 +80,31 @@ bool OpenGLBackend::perScreenRendering() const
     return false;
 }
 
+bool OpenGLBackend::hasPerOutputRenderLoops() const
+{
+    return false;
+}
+
+bool OpenGLBackend::scanout(int screenId, KWaylandServer::SurfaceInterface *surface)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(surface)
+    return false;
+}
+
+void OpenGLBackend::resetOverlayPlanes(int screenId)
+{
+    Q_UNUSED(screenId)
+}
+
+bool OpenGLBackend::assignOverlayPlane(int screenId, KWaylandServer::SurfaceInterface *surface, const QRect &geometry)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(surface)
+    Q_UNUSED(geometry)
+    return false;
+}
+
 void OpenGLBackend::copyPixels(const QRegion &region)
 {
     const int height = screens()->size().height();
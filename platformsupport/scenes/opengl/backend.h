@@ -13,8 +13,15 @@
 #include <QElapsedTimer>
 #include <QRegion>
 
+#include "damagejournal.h"
+
 #include <kwin_export.h>
 
+namespace KWaylandServer
+{
+class SurfaceInterface;
+}
+
 namespace KWin
 {
 class AbstractOutput;
@@ -81,7 +88,37 @@ public:
      * Default implementation returns @c false.
      */
     virtual bool perScreenRendering() const;
+    /**
+     * Whether every screen is presented on its own in endRenderingFrameForScreen() and the
+     * platform reports the completion of the buffer swap per output, so that each output
+     * can be scheduled by its own RenderLoop.
+     * Default implementation returns @c false.
+     */
+    virtual bool hasPerOutputRenderLoops() const;
     virtual QRegion prepareRenderingForScreen(int screenId);
+    /**
+     * Tries to present the current buffer of @p surface on the screen @p screenId directly,
+     * without compositing. The surface covers the whole screen. Returns @c false if the
+     * buffer cannot be scanned out, in which case the screen needs to be painted as usual.
+     * Only called if perScreenRendering() returns @c true.
+     * Default implementation returns @c false.
+     */
+    virtual bool scanout(int screenId, KWaylandServer::SurfaceInterface *surface);
+    /**
+     * Removes all surfaces from the overlay planes of the screen @p screenId. Called before
+     * overlay planes are assigned for a new frame, see assignOverlayPlane().
+     * Only called if perScreenRendering() returns @c true.
+     */
+    virtual void resetOverlayPlanes(int screenId);
+    /**
+     * Tries to show @p surface on a hardware overlay plane of the screen @p screenId with the
+     * next frame. @p geometry is the area covered by the surface in global compositor
+     * coordinates. The overlay plane is shown on top of the composited frame, so nothing may
+     * be painted above the surface. If @c true is returned the surface must not be painted.
+     * Only called if perScreenRendering() returns @c true.
+     * Default implementation returns @c false.
+     */
+    virtual bool assignOverlayPlane(int screenId, KWaylandServer::SurfaceInterface *surface, const QRect &geometry);
     /**
      * @brief Compositor is going into idle mode, flushes any pending paints.
      */
@@ -303,7 +340,7 @@ private:
     /**
      * @brief The damage history for the past 10 frames.
      */
-    QList<QRegion> m_damageHistory;
+    DamageJournal m_damageJournal;
     /**
      * @brief Timer to measure how long a frame renders.
      */
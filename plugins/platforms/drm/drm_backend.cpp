@@ -12,6 +12,7 @@
 #include "drm_object_crtc.h"
 #include "drm_object_plane.h"
 #include "composite.h"
+#include "renderloop.h"
 #include "cursor.h"
 #include "logging.h"
 #include "logind.h"
@@ -198,7 +199,15 @@ void DrmBackend::reactivate()
     // restart compositor
     m_pageFlipsPending = 0;
     if (Compositor *compositor = Compositor::self()) {
-        compositor->bufferSwapComplete();
+        if (compositor->hasPerOutputRenderLoops()) {
+            for (DrmOutput *output : qAsConst(m_enabledOutputs)) {
+                if (output->renderLoop()->isFramePending()) {
+                    compositor->bufferSwapComplete(output);
+                }
+            }
+        } else {
+            compositor->bufferSwapComplete();
+        }
         compositor->addRepaintFull();
     }
 }
@@ -209,8 +218,16 @@ void DrmBackend::deactivate()
         return;
     }
     // block compositor
-    if (m_pageFlipsPending == 0 && Compositor::self()) {
-        Compositor::self()->aboutToSwapBuffers();
+    if (Compositor *compositor = Compositor::self()) {
+        if (compositor->hasPerOutputRenderLoops()) {
+            for (DrmOutput *output : qAsConst(m_enabledOutputs)) {
+                if (!output->renderLoop()->isFramePending()) {
+                    compositor->aboutToSwapBuffers(output);
+                }
+            }
+        } else if (m_pageFlipsPending == 0) {
+            compositor->aboutToSwapBuffers();
+        }
     }
     // hide cursor and disable
     for (auto it = m_outputs.constBegin(); it != m_outputs.constEnd(); ++it) {
@@ -224,19 +241,25 @@ void DrmBackend::pageFlipHandler(int fd, unsigned int frame, unsigned int sec, u
 {
     Q_UNUSED(fd)
     Q_UNUSED(frame)
-    Q_UNUSED(sec)
-    Q_UNUSED(usec)
     auto output = reinterpret_cast<DrmOutput*>(data);
 
     output->pageFlipped();
     output->m_backend->m_pageFlipsPending--;
-    if (output->m_backend->m_pageFlipsPending == 0) {
-        // TODO: improve, this currently means we wait for all page flips or all outputs.
-        // It would be better to driver the repaint per output
 
-        if (Compositor::self()) {
-            Compositor::self()->bufferSwapComplete();
+    Compositor *compositor = Compositor::self();
+    if (!compositor) {
+        return;
+    }
+    if (compositor->hasPerOutputRenderLoops()) {
+        // Each output is repainted as soon as its own page flip has completed.
+        if (output->renderLoop()->isFramePending()) {
+            // The kernel reports page flip timestamps on the CLOCK_MONOTONIC clock.
+            const qint64 timestamp = qint64(sec) * 1000000000 + qint64(usec) * 1000;
+            compositor->bufferSwapComplete(output, timestamp);
         }
+    } else if (output->m_backend->m_pageFlipsPending == 0) {
+        // Without per output render loops we have to wait for the page flips of all outputs.
+        compositor->bufferSwapComplete();
     }
 }
 
@@ -607,10 +630,7 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
     }
 
     if (output->present(buffer)) {
-        m_pageFlipsPending++;
-        if (m_pageFlipsPending == 1 && Compositor::self()) {
-            Compositor::self()->aboutToSwapBuffers();
-        }
+        pageFlipScheduled(output);
         return true;
     } else if (m_deleteBufferAfterPageFlip) {
         delete buffer;
@@ -618,6 +638,28 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
     return false;
 }
 
+bool DrmBackend::directScanout(DrmBuffer *buffer, DrmOutput *output)
+{
+    if (buffer->bufferId() != 0 && output->directScanout(buffer)) {
+        pageFlipScheduled(output);
+        return true;
+    }
+    delete buffer;
+    return false;
+}
+
+void DrmBackend::pageFlipScheduled(DrmOutput *output)
+{
+    m_pageFlipsPending++;
+    if (Compositor *compositor = Compositor::self()) {
+        if (compositor->hasPerOutputRenderLoops()) {
+            compositor->aboutToSwapBuffers(output);
+        } else if (m_pageFlipsPending == 1) {
+            compositor->aboutToSwapBuffers();
+        }
+    }
+}
+
 void DrmBackend::initCursor()
 {
 
@@ -66,6 +66,11 @@ public:
     DrmSurfaceBuffer *createBuffer(const std::shared_ptr<GbmSurface> &surface);
 #endif
     bool present(DrmBuffer *buffer, DrmOutput *output);
+    /**
+     * Shows the client buffer @p buffer on @p output without compositing, see
+     * DrmOutput::directScanout(). Takes ownership of the buffer.
+     */
+    bool directScanout(DrmBuffer *buffer, DrmOutput *output);
 
     int fd() const {
         return m_fd;
@@ -159,6 +164,7 @@ private:
     QByteArray generateOutputConfigurationUuid() const;
     DrmOutput *findOutput(quint32 connector);
     void updateOutputsEnabled();
+    void pageFlipScheduled(DrmOutput *output);
     QScopedPointer<Udev> m_udev;
     QScopedPointer<UdevMonitor> m_udevMonitor;
     int m_fd = -1;
@@ -11,11 +11,15 @@
 #include "gbm_surface.h"
 
 #include "logging.h"
+#include "platformsupport/scenes/opengl/drm_fourcc.h"
+
+#include <KWaylandServer/buffer_interface.h>
 
 // system
 #include <sys/mman.h>
 // c++
 #include <cerrno>
+#include <cstring>
 // drm
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -24,9 +28,14 @@
 namespace KWin
 {
 
+DrmGbmBuffer::DrmGbmBuffer(int fd)
+    : DrmBuffer(fd)
+{
+}
+
 // DrmSurfaceBuffer
 DrmSurfaceBuffer::DrmSurfaceBuffer(int fd, const std::shared_ptr<GbmSurface> &surface)
-    : DrmBuffer(fd)
+    : DrmGbmBuffer(fd)
     , m_surface(surface)
 {
     m_bo = m_surface->lockFrontBuffer();
@@ -55,4 +64,51 @@ void DrmSurfaceBuffer::releaseGbm()
     m_bo = nullptr;
 }
 
+// DrmDmabufBuffer
+DrmDmabufBuffer::DrmDmabufBuffer(int fd, gbm_bo *bo, KWaylandServer::BufferInterface *buffer)
+    : DrmGbmBuffer(fd)
+    , m_buffer(buffer)
+{
+    m_bo = bo;
+    m_buffer->ref();
+    m_size = QSize(gbm_bo_get_width(m_bo), gbm_bo_get_height(m_bo));
+
+    uint32_t handles[4] = {};
+    uint32_t strides[4] = {};
+    uint32_t offsets[4] = {};
+    uint64_t modifiers[4] = {};
+    const uint64_t modifier = gbm_bo_get_modifier(m_bo);
+    for (int i = 0; i < gbm_bo_get_plane_count(m_bo); i++) {
+        handles[i] = gbm_bo_get_handle_for_plane(m_bo, i).u32;
+        strides[i] = gbm_bo_get_stride_for_plane(m_bo, i);
+        offsets[i] = gbm_bo_get_offset(m_bo, i);
+        modifiers[i] = modifier;
+    }
+
+    int ret;
+    if (modifier != DRM_FORMAT_MOD_INVALID) {
+        ret = drmModeAddFB2WithModifiers(fd, m_size.width(), m_size.height(), gbm_bo_get_format(m_bo),
+                                         handles, strides, offsets, modifiers, &m_bufferId, DRM_MODE_FB_MODIFIERS);
+    } else {
+        ret = drmModeAddFB2(fd, m_size.width(), m_size.height(), gbm_bo_get_format(m_bo),
+                            handles, strides, offsets, &m_bufferId, 0);
+    }
+    if (ret != 0) {
+        // Not every client buffer can be scanned out, the caller falls back to compositing.
+        qCDebug(KWIN_DRM) << "Adding a framebuffer for a client buffer failed:" << strerror(errno);
+        m_bufferId = 0;
+    }
+}
+
+DrmDmabufBuffer::~DrmDmabufBuffer()
+{
+    if (m_bufferId) {
+        drmModeRmFB(fd(), m_bufferId);
+    }
+    gbm_bo_destroy(m_bo);
+    if (m_buffer) {
+        m_buffer->unref();
+    }
+}
+
 }
@@ -12,24 +12,28 @@
 
 #include "drm_buffer.h"
 
+#include <QPointer>
+
 #include <memory>
 
 struct gbm_bo;
 
+namespace KWaylandServer
+{
+class BufferInterface;
+}
+
 namespace KWin
 {
 
 class GbmSurface;
 
-class DrmSurfaceBuffer : public DrmBuffer
+class DrmGbmBuffer : public DrmBuffer
 {
 public:
-    DrmSurfaceBuffer(int fd, const std::shared_ptr<GbmSurface> &surface);
-    ~DrmSurfaceBuffer() override;
-
     bool needsModeChange(DrmBuffer *b) const override {
-        if (DrmSurfaceBuffer *sb = dynamic_cast<DrmSurfaceBuffer*>(b)) {
-            return hasBo() != sb->hasBo();
+        if (DrmGbmBuffer *gb = dynamic_cast<DrmGbmBuffer*>(b)) {
+            return hasBo() != gb->hasBo();
         } else {
             return true;
         }
@@ -43,11 +47,37 @@ public:
         return m_bo;
     }
 
+protected:
+    DrmGbmBuffer(int fd);
+
+    gbm_bo *m_bo = nullptr;
+};
+
+class DrmSurfaceBuffer : public DrmGbmBuffer
+{
+public:
+    DrmSurfaceBuffer(int fd, const std::shared_ptr<GbmSurface> &surface);
+    ~DrmSurfaceBuffer() override;
+
     void releaseGbm() override;
 
 private:
     std::shared_ptr<GbmSurface> m_surface;
-    gbm_bo *m_bo = nullptr;
+};
+
+/**
+ * A client buffer which is scanned out directly. Takes ownership of the imported @p bo and
+ * keeps the client buffer referenced until this buffer is deleted after it has been replaced
+ * on the screen.
+ */
+class DrmDmabufBuffer : public DrmGbmBuffer
+{
+public:
+    DrmDmabufBuffer(int fd, gbm_bo *bo, KWaylandServer::BufferInterface *buffer);
+    ~DrmDmabufBuffer() override;
+
+private:
+    QPointer<KWaylandServer::BufferInterface> m_buffer;
 };
 
 }
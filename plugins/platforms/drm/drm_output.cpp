@@ -72,6 +72,7 @@ void DrmOutput::teardown()
     if (m_cursorPlane) {
         m_cursorPlane->setOutput(nullptr);
     }
+    releaseOverlayPlanes();
 
     m_crtc->setOutput(nullptr);
     m_conn->setOutput(nullptr);
@@ -771,6 +772,16 @@ void DrmOutput::pageFlipped()
                 p->flipBufferWithDelete();
             }
             m_nextPlanesFlipList.clear();
+
+            // overlay planes that have been disabled can be used by other outputs again
+            for (auto it = m_overlayPlanes.begin(); it != m_overlayPlanes.end();) {
+                if (!(*it)->current() && !(*it)->next()) {
+                    (*it)->setOutput(nullptr);
+                    it = m_overlayPlanes.erase(it);
+                } else {
+                    ++it;
+                }
+            }
         } else {
             if (!m_crtc->next()) {
                 // on manual vt switch
@@ -809,6 +820,150 @@ bool DrmOutput::present(DrmBuffer *buffer)
     }
 }
 
+bool DrmOutput::directScanout(DrmBuffer *buffer)
+{
+    // The first frame after a mode set is always composited.
+    if (!m_backend->atomicModeSetting() || m_modesetRequested || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    // The buffer is shown as is, the primary plane must neither scale nor rotate it.
+    if (transform() != Transform::Normal || buffer->size() != modeSize()) {
+        return false;
+    }
+    if (!LogindIntegration::self()->isActiveSession() || m_pageFlipPending) {
+        return false;
+    }
+
+    // The scanned out window covers the whole output.
+    resetOverlayPlanes();
+
+    m_primaryPlane->setNext(buffer);
+    m_nextPlanesFlipList << m_primaryPlane;
+    m_nextPlanesFlipList << m_overlayPlanes;
+
+    // On failure doAtomicCommit() resets the next buffers of the planes.
+    if (!doAtomicCommit(AtomicCommitMode::Test)) {
+        qCDebug(KWIN_DRM) << "Atomic test commit for direct scanout failed, falling back to compositing.";
+        return false;
+    }
+    if (!doAtomicCommit(AtomicCommitMode::Real)) {
+        qCDebug(KWIN_DRM) << "Atomic commit for direct scanout failed. This should have never happened!";
+        return false;
+    }
+    m_overlayPlanesChanged = false;
+    m_pageFlipPending = true;
+    return true;
+}
+
+void DrmOutput::resetOverlayPlanes()
+{
+    if (m_pageFlipPending) {
+        return;
+    }
+    for (DrmPlane *plane : qAsConst(m_overlayPlanes)) {
+        // assigned for a frame that has never been presented
+        if (plane->next() != plane->current()) {
+            delete plane->next();
+        }
+        plane->setNext(nullptr);
+        plane->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+    }
+    m_overlayPlanesChanged = true;
+}
+
+bool DrmOutput::assignOverlayPlane(DrmBuffer *buffer, uint32_t format, const QRect &geometry)
+{
+    if (!m_backend->atomicModeSetting() || !m_backend->deleteBufferAfterPageFlip()) {
+        return false;
+    }
+    if (m_modesetRequested || m_pageFlipPending || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    // The overlay plane is positioned in the coordinate system of the output's mode.
+    if (transform() != Transform::Normal || !QRect(QPoint(0, 0), modeSize()).contains(geometry)) {
+        return false;
+    }
+
+    DrmPlane *plane = nullptr;
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (!p->next() && p->formats().contains(format)) {
+            plane = p;
+            break;
+        }
+    }
+    if (!plane) {
+        const auto overlayPlanes = m_backend->overlayPlanes();
+        for (DrmPlane *p : overlayPlanes) {
+            if (!p->output() && p->isCrtcSupported(m_crtc->resIndex()) && p->formats().contains(format)) {
+                p->setOutput(this);
+                m_overlayPlanes << p;
+                plane = p;
+                break;
+            }
+        }
+    }
+    if (!plane) {
+        return false;
+    }
+
+    plane->setValue(int(DrmPlane::PropertyIndex::SrcX), 0);
+    plane->setValue(int(DrmPlane::PropertyIndex::SrcY), 0);
+    plane->setValue(int(DrmPlane::PropertyIndex::SrcW), buffer->size().width() << 16);
+    plane->setValue(int(DrmPlane::PropertyIndex::SrcH), buffer->size().height() << 16);
+    plane->setValue(int(DrmPlane::PropertyIndex::CrtcX), geometry.x());
+    plane->setValue(int(DrmPlane::PropertyIndex::CrtcY), geometry.y());
+    plane->setValue(int(DrmPlane::PropertyIndex::CrtcW), geometry.width());
+    plane->setValue(int(DrmPlane::PropertyIndex::CrtcH), geometry.height());
+    plane->setValue(int(DrmPlane::PropertyIndex::CrtcId), m_crtc->id());
+    plane->setTransformation(DrmPlane::Transformation::Rotate0);
+    plane->setNext(buffer);
+
+    if (!testOverlayPlanes()) {
+        plane->setNext(nullptr);
+        plane->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+        if (!plane->current()) {
+            plane->setOutput(nullptr);
+            m_overlayPlanes.removeOne(plane);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool DrmOutput::testOverlayPlanes()
+{
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    // Planes that are not part of the request keep their current state, so this tests
+    // the new overlay planes together with the primary plane's current buffer.
+    bool ret = true;
+    for (DrmPlane *plane : qAsConst(m_overlayPlanes)) {
+        ret &= plane->atomicPopulate(req);
+    }
+    if (ret) {
+        ret = drmModeAtomicCommit(m_backend->fd(), req, DRM_MODE_ATOMIC_TEST_ONLY, this) == 0;
+    }
+    drmModeAtomicFree(req);
+    return ret;
+}
+
+void DrmOutput::releaseOverlayPlanes()
+{
+    for (DrmPlane *plane : qAsConst(m_overlayPlanes)) {
+        if (plane->next() != plane->current()) {
+            delete plane->next();
+        }
+        delete plane->current();
+        plane->setCurrent(nullptr);
+        plane->setNext(nullptr);
+        plane->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+        plane->setOutput(nullptr);
+    }
+    m_overlayPlanes.clear();
+}
+
 bool DrmOutput::dpmsAtomicOff()
 {
     m_atomicOffPending = false;
@@ -817,6 +972,8 @@ bool DrmOutput::dpmsAtomicOff()
     delete m_primaryPlane->next();
     m_primaryPlane->setNext(nullptr);
     m_nextPlanesFlipList << m_primaryPlane;
+    resetOverlayPlanes();
+    m_nextPlanesFlipList << m_overlayPlanes;
 
     if (!doAtomicCommit(AtomicCommitMode::Test)) {
         qCDebug(KWIN_DRM) << "Atomic test commit to Dpms Off failed. Aborting.";
@@ -827,6 +984,8 @@ bool DrmOutput::dpmsAtomicOff()
         return false;
     }
     m_nextPlanesFlipList.clear();
+    m_overlayPlanesChanged = false;
+    releaseOverlayPlanes();
     dpmsFinishOff();
 
     return true;
@@ -855,9 +1014,12 @@ bool DrmOutput::presentAtomically(DrmBuffer *buffer)
 
     m_primaryPlane->setNext(buffer);
     m_nextPlanesFlipList << m_primaryPlane;
+    if (m_overlayPlanesChanged) {
+        m_nextPlanesFlipList << m_overlayPlanes;
+    }
 
     if (!doAtomicCommit(AtomicCommitMode::Test)) {
-        //TODO: When we use planes for layered rendering, fallback to renderer instead. Also for direct scanout?
+        //TODO: When we use planes for layered rendering, fallback to renderer instead.
         //TODO: Probably should undo setNext and reset the flip list
         qCDebug(KWIN_DRM) << "Atomic test commit failed. Aborting present.";
         // go back to previous state
@@ -886,6 +1048,7 @@ bool DrmOutput::presentAtomically(DrmBuffer *buffer)
         //TODO: Probably should undo setNext and reset the flip list
         return false;
     }
+    m_overlayPlanesChanged = false;
     if (wasModeset) {
         // store current mode set as new good state
         m_lastWorkingState.mode = m_mode;
@@ -940,7 +1103,23 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
 {
     drmModeAtomicReq *req = drmModeAtomicAlloc();
 
-    auto errorHandler = [this, mode, req] () {
+    auto resetNextPlanes = [this] () {
+        // TODO: rework later for overlay planes!
+        for (DrmPlane *p : m_nextPlanesFlipList) {
+            // Buffers of the primary plane are owned by the caller of present(),
+            // overlay planes are disabled.
+            if (p != m_primaryPlane) {
+                if (p->next() != p->current() && m_backend->deleteBufferAfterPageFlip()) {
+                    delete p->next();
+                }
+                p->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+            }
+            p->setNext(nullptr);
+        }
+        m_nextPlanesFlipList.clear();
+    };
+
+    auto errorHandler = [this, mode, req, &resetNextPlanes] () {
         if (mode == AtomicCommitMode::Test) {
             // TODO: when we later test overlay planes, make sure we change only the right stuff back
         }
@@ -956,12 +1135,7 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
             }
         }
 
-        // TODO: see above, rework later for overlay planes!
-        for (DrmPlane *p : m_nextPlanesFlipList) {
-            p->setNext(nullptr);
-        }
-        m_nextPlanesFlipList.clear();
-
+        resetNextPlanes();
     };
 
     if (!req) {
@@ -1021,6 +1195,14 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
     }
 
     if (drmModeAtomicCommit(m_backend->fd(), req, flags, this)) {
+        if (mode == AtomicCommitMode::Test && m_dpmsMode == m_dpmsModePending) {
+            // Rejected configurations, e.g. client buffers that can't be scanned out, are
+            // expected to be tested every frame, the caller falls back to something else.
+            qCDebug(KWIN_DRM) << "Atomic test commit failed:" << strerror(errno);
+            drmModeAtomicFree(req);
+            resetNextPlanes();
+            return false;
+        }
         qCWarning(KWIN_DRM) << "Atomic request failed to commit:" << strerror(errno);
         errorHandler();
         return false;
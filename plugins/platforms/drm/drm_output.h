@@ -48,6 +48,24 @@ public:
     void moveCursor(Cursor* cursor, const QPoint &globalPos);
     bool init(drmModeConnector *connector);
     bool present(DrmBuffer *buffer);
+    /**
+     * Tries to show the client buffer @p buffer on the primary plane. Unlike present(), a
+     * rejected test commit leaves the output untouched, the caller is expected to composite
+     * the frame instead. Only supported with atomic mode setting.
+     */
+    bool directScanout(DrmBuffer *buffer);
+    /**
+     * Disables all overlay planes of this output with the next present(). Has to be called
+     * before overlay planes are assigned for a new frame.
+     */
+    void resetOverlayPlanes();
+    /**
+     * Tries to show @p buffer with the given DRM @p format on a free overlay plane at
+     * @p geometry, in device pixels relative to the output. The assignment is validated
+     * with a test commit and shown together with the next present(). Takes ownership of
+     * the buffer if @c true is returned.
+     */
+    bool assignOverlayPlane(DrmBuffer *buffer, uint32_t format, const QRect &geometry);
     void pageFlipped();
 
     // These values are defined by the kernel
@@ -129,6 +147,8 @@ private:
     void updateEnablement(bool enable) override;
 
     bool dpmsAtomicOff();
+    bool testOverlayPlanes();
+    void releaseOverlayPlanes();
     bool dpmsLegacyApply();
 
     void dpmsFinishOn();
@@ -160,6 +180,9 @@ private:
     DrmPlane* m_primaryPlane = nullptr;
     DrmPlane* m_cursorPlane = nullptr;
     QVector<DrmPlane*> m_nextPlanesFlipList;
+    // overlay planes claimed by this output
+    QVector<DrmPlane*> m_overlayPlanes;
+    bool m_overlayPlanesChanged = false;
     bool m_pageFlipPending = false;
     bool m_atomicOffPending = false;
     bool m_modesetRequested = true;
@@ -10,7 +10,9 @@
 // kwin
 #include "composite.h"
 #include "drm_backend.h"
+#include "drm_buffer_gbm.h"
 #include "drm_output.h"
+#include "egl_dmabuf.h"
 #include "gbm_surface.h"
 #include "logging.h"
 #include "options.h"
@@ -18,6 +20,9 @@
 // kwin libs
 #include <kwinglplatform.h>
 #include <kwineglimagetexture.h>
+// KWayland
+#include <KWaylandServer/buffer_interface.h>
+#include <KWaylandServer/surface_interface.h>
 // system
 #include <gbm.h>
 
@@ -465,20 +470,101 @@ QRegion EglGbmBackend::prepareRenderingForScreen(int screenId)
     prepareRenderFramebuffer(output);
     setViewport(output);
 
+    const QRect geometry = output.output->geometry();
     if (supportsBufferAge()) {
-        QRegion region;
-
-        // Note: An age of zero means the buffer contents are undefined
-        if (output.bufferAge > 0 && output.bufferAge <= output.damageHistory.count()) {
-            for (int i = 0; i < output.bufferAge - 1; i++)
-                region |= output.damageHistory[i];
-        } else {
-            region = output.output->geometry();
-        }
+        return output.damageJournal.accumulate(output.bufferAge, geometry) & geometry;
+    }
+    return geometry;
+}
+
+DrmDmabufBuffer *EglGbmBackend::importBuffer(KWaylandServer::BufferInterface *buffer, const QSize &size) const
+{
+    auto dmabuf = static_cast<EglDmabufBuffer *>(buffer->linuxDmabufBuffer());
+    if (!dmabuf || dmabuf->size() != size) {
+        return nullptr;
+    }
+    // The buffer is shown as is, so its origin has to be the top-left corner.
+    if (dmabuf->flags() & KWaylandServer::LinuxDmabufUnstableV1Interface::YInverted) {
+        return nullptr;
+    }
+    const auto planes = dmabuf->planes();
+    if (planes.isEmpty() || planes.count() > 4) {
+        return nullptr;
+    }
+
+    // Whether the modifier is supported is left to the test commit.
+    gbm_import_fd_modifier_data data = {};
+    data.width = dmabuf->size().width();
+    data.height = dmabuf->size().height();
+    data.format = dmabuf->format();
+    data.num_fds = planes.count();
+    for (int i = 0; i < planes.count(); i++) {
+        data.fds[i] = planes[i].fd;
+        data.strides[i] = planes[i].stride;
+        data.offsets[i] = planes[i].offset;
+    }
+    data.modifier = planes.first().modifier;
+    gbm_bo *bo = gbm_bo_import(m_backend->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+    if (!bo) {
+        return nullptr;
+    }
+    return new DrmDmabufBuffer(m_backend->fd(), bo, buffer);
+}
 
-        return region;
+bool EglGbmBackend::scanout(int screenId, KWaylandServer::SurfaceInterface *surface)
+{
+    Output &output = m_outputs[screenId];
+    KWaylandServer::BufferInterface *buffer = surface->buffer();
+    if (!buffer->linuxDmabufBuffer()
+            || !output.output->primaryPlane()->formats().contains(buffer->linuxDmabufBuffer()->format())) {
+        return false;
     }
-    return output.output->geometry();
+    DrmDmabufBuffer *scanoutBuffer = importBuffer(buffer, output.output->modeSize());
+    if (!scanoutBuffer) {
+        return false;
+    }
+    if (!m_backend->directScanout(scanoutBuffer, output.output)) {
+        return false;
+    }
+    output.buffer = scanoutBuffer;
+    Q_EMIT output.output->outputChange(output.output->geometry());
+
+    // The contents of the back buffers are outdated now, so the next composited frame
+    // has to be repainted entirely.
+    output.bufferAge = 0;
+    output.damageJournal.clear();
+    return true;
+}
+
+void EglGbmBackend::resetOverlayPlanes(int screenId)
+{
+    m_outputs[screenId].output->resetOverlayPlanes();
+}
+
+bool EglGbmBackend::assignOverlayPlane(int screenId, KWaylandServer::SurfaceInterface *surface, const QRect &geometry)
+{
+    DrmOutput *drmOutput = m_outputs[screenId].output;
+    KWaylandServer::BufferInterface *buffer = surface->buffer();
+    if (!buffer || !buffer->linuxDmabufBuffer()) {
+        return false;
+    }
+    // Overlay planes may scale the buffer, but the surface must not be transformed.
+    if (surface->bufferTransform() != KWaylandServer::OutputInterface::Transform::Normal) {
+        return false;
+    }
+    DrmDmabufBuffer *overlayBuffer = importBuffer(buffer, buffer->linuxDmabufBuffer()->size());
+    if (!overlayBuffer) {
+        return false;
+    }
+
+    const qreal scale = drmOutput->scale();
+    const QRect outputGeometry = geometry.translated(-drmOutput->geometry().topLeft());
+    const QRect deviceGeometry(outputGeometry.topLeft() * scale, outputGeometry.size() * scale);
+    if (!drmOutput->assignOverlayPlane(overlayBuffer, buffer->linuxDmabufBuffer()->format(), deviceGeometry)) {
+        delete overlayBuffer;
+        return false;
+    }
+    return true;
 }
 
 void EglGbmBackend::endRenderingFrame(const QRegion &renderedRegion, const QRegion &damagedRegion)
@@ -494,7 +580,8 @@ void EglGbmBackend::endRenderingFrameForScreen(int screenId,
     Output &output = m_outputs[screenId];
     renderFramebufferToSurface(output);
 
-    if (damagedRegion.intersected(output.output->geometry()).isEmpty() && screenId == 0) {
+    const QRegion damage = damagedRegion.intersected(output.output->geometry());
+    if (damage.isEmpty()) {
 
         // If the damaged region of a window is fully occluded, the only
         // rendering done, if any, will have been to repair a reused back
@@ -506,26 +593,16 @@ void EglGbmBackend::endRenderingFrameForScreen(int screenId,
         if (!renderedRegion.intersected(output.output->geometry()).isEmpty())
             glFlush();
 
-        for (auto &output: m_outputs) {
-            output.bufferAge = 1;
-        }
+        output.bufferAge = 1;
         return;
     }
     presentOnOutput(output, damagedRegion);
 
     // Save the damaged region to history
-    // Note: damage history is only collected for the first screen. For any other screen full
-    // repaints are triggered. This is due to a limitation in Scene::paintGenericScreen which resets
-    // the Toplevel's repaint. So multiple calls to Scene::paintScreen as it's done in multi-output
-    // rendering only have correct damage information for the first screen. If we try to track
-    // damage nevertheless, it creates artifacts. So for the time being we work around the problem
-    // by only supporting buffer age on the first output. To properly support buffer age on all
-    // outputs the rendering needs to be refactored in general.
-    if (supportsBufferAge() && screenId == 0) {
-        if (output.damageHistory.count() > 10) {
-            output.damageHistory.removeLast();
-        }
-        output.damageHistory.prepend(damagedRegion.intersected(output.output->geometry()));
+    // Every output has its own render loop, which gets the window repaints that belong to it,
+    // so the damage painted for an output is complete and its buffer age can be used.
+    if (supportsBufferAge()) {
+        output.damageJournal.add(damage);
     }
 }
 
@@ -539,6 +616,11 @@ bool EglGbmBackend::perScreenRendering() const
     return true;
 }
 
+bool EglGbmBackend::hasPerOutputRenderLoops() const
+{
+    return true;
+}
+
 QSharedPointer<GLTexture> EglGbmBackend::textureForOutput(AbstractOutput *abstractOutput) const
 {
     const QVector<KWin::EglGbmBackend::Output>::const_iterator itOutput = std::find_if(m_outputs.begin(), m_outputs.end(),
@@ -14,12 +14,18 @@
 
 struct gbm_surface;
 
+namespace KWaylandServer
+{
+class BufferInterface;
+}
+
 namespace KWin
 {
 class AbstractOutput;
 class DrmBackend;
 class DrmBuffer;
-class DrmSurfaceBuffer;
+class DrmDmabufBuffer;
+class DrmGbmBuffer;
 class DrmOutput;
 class GbmSurface;
 
@@ -39,7 +45,11 @@ public:
     void endRenderingFrameForScreen(int screenId, const QRegion &damage, const QRegion &damagedRegion) override;
     bool usesOverlayWindow() const override;
     bool perScreenRendering() const override;
+    bool hasPerOutputRenderLoops() const override;
     QRegion prepareRenderingForScreen(int screenId) override;
+    bool scanout(int screenId, KWaylandServer::SurfaceInterface *surface) override;
+    void resetOverlayPlanes(int screenId) override;
+    bool assignOverlayPlane(int screenId, KWaylandServer::SurfaceInterface *surface, const QRect &geometry) override;
     void init() override;
 
     QSharedPointer<GLTexture> textureForOutput(AbstractOutput *requestedOutput) const override;
@@ -55,14 +65,14 @@ private:
 
     struct Output {
         DrmOutput *output = nullptr;
-        DrmSurfaceBuffer *buffer = nullptr;
+        DrmGbmBuffer *buffer = nullptr;
         std::shared_ptr<GbmSurface> gbmSurface;
         EGLSurface eglSurface = EGL_NO_SURFACE;
         int bufferAge = 0;
         /**
          * @brief The damage history for the past 10 frames.
          */
-        QList<QRegion> damageHistory;
+        DamageJournal damageJournal;
 
         struct {
             GLuint framebuffer = 0;
@@ -86,6 +96,7 @@ private:
     void renderFramebufferToSurface(Output &output);
 
     void presentOnOutput(Output &output, const QRegion &damagedRegion);
+    DrmDmabufBuffer *importBuffer(KWaylandServer::BufferInterface *buffer, const QSize &size) const;
 
     void removeOutput(DrmOutput *drmOutput);
     void cleanupOutput(Output &output);
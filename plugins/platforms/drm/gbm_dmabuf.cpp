@@ -29,6 +29,12 @@ GbmDmaBuf::~GbmDmaBuf()
 }
 
 
+quint64 GbmDmaBuf::modifier() const
+{
+    // The buffers are always allocated with a linear layout.
+    return DRM_FORMAT_MOD_NONE;
+}
+
 KWin::GbmDmaBuf *GbmDmaBuf::createBuffer(const QSize &size, gbm_device *device)
 {
     auto bo = gbm_bo_create(device, size.width(), size.height(), GBM_BO_FORMAT_ARGB8888, GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
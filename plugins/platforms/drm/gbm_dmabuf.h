@@ -26,6 +26,7 @@ public:
     quint32 stride() const override {
         return gbm_bo_get_stride(m_bo);
     }
+    quint64 modifier() const override;
 
     static GbmDmaBuf *createBuffer(const QSize &size, gbm_device *device);
 
@@ -15,8 +15,94 @@
 // Qt
 #include <QPainter>
 
+#include <cstring>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#  include <arm_neon.h>
+#  define KWIN_FB_NEON 1
+#endif
+
 namespace KWin
 {
+
+namespace
+{
+
+// The render buffer is a QImage::Format_RGB32, the following functions convert a run of its
+// pixels to the pixel format of the framebuffer.
+
+void copyRow(uchar *dst, const uchar *src, int width)
+{
+    std::memcpy(dst, src, width * 4);
+}
+
+void convertRowToRGBA8888(uchar *dst, const uchar *src, int width)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    // 0xffRRGGBB becomes 0xffBBGGRR, which is R, G, B, A in memory
+    const __m128i lowMask = _mm_set1_epi32(0x000000ff);
+    const __m128i greenMask = _mm_set1_epi32(0x0000ff00);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    for (; i + 4 <= width; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), lowMask);
+        const __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, lowMask), 16);
+        const __m128i green = _mm_and_si128(pixels, greenMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+                         _mm_or_si128(_mm_or_si128(red, blue), _mm_or_si128(green, alpha)));
+    }
+#elif defined(KWIN_FB_NEON)
+    for (; i + 16 <= width; i += 16) {
+        uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+        const uint8x16_t blue = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = blue;
+        pixels.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + i * 4, pixels);
+    }
+#endif
+    const QRgb *pixels = reinterpret_cast<const QRgb *>(src);
+    for (; i < width; ++i) {
+        dst[i * 4] = qRed(pixels[i]);
+        dst[i * 4 + 1] = qGreen(pixels[i]);
+        dst[i * 4 + 2] = qBlue(pixels[i]);
+        dst[i * 4 + 3] = 0xff;
+    }
+}
+
+void convertRowToBGR888(uchar *dst, const uchar *src, int width)
+{
+    int i = 0;
+#if defined(KWIN_FB_NEON)
+    for (; i + 16 <= width; i += 16) {
+        const uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+        const uint8x16x3_t packed = {{ pixels.val[0], pixels.val[1], pixels.val[2] }};
+        vst3q_u8(dst + i * 3, packed);
+    }
+#endif
+    const QRgb *pixels = reinterpret_cast<const QRgb *>(src);
+    for (; i < width; ++i) {
+        dst[i * 3] = qBlue(pixels[i]);
+        dst[i * 3 + 1] = qGreen(pixels[i]);
+        dst[i * 3 + 2] = qRed(pixels[i]);
+    }
+}
+
+void convertRowToRGB16(uchar *dst, const uchar *src, int width)
+{
+    const QRgb *pixels = reinterpret_cast<const QRgb *>(src);
+    quint16 *out = reinterpret_cast<quint16 *>(dst);
+    for (int i = 0; i < width; ++i) {
+        const QRgb pixel = pixels[i];
+        out[i] = ((pixel >> 8) & 0xf800) | ((pixel >> 5) & 0x07e0) | ((pixel >> 3) & 0x001f);
+    }
+}
+
+}
+
 FramebufferQPainterBackend::FramebufferQPainterBackend(FramebufferBackend *backend)
     : QObject()
     , QPainterBackend()
@@ -33,6 +119,25 @@ FramebufferQPainterBackend::FramebufferQPainterBackend(FramebufferBackend *backe
                           m_backend->bytesPerLine(), m_backend->imageFormat());
     m_backBuffer.fill(Qt::black);
 
+    switch (m_backBuffer.format()) {
+    case QImage::Format_RGB32:
+        m_convertRow = copyRow;
+        break;
+    case QImage::Format_RGBA8888:
+        m_convertRow = convertRowToRGBA8888;
+        break;
+    case QImage::Format_RGB888:
+        if (m_backend->isBGR()) {
+            m_convertRow = convertRowToBGR888;
+        }
+        break;
+    case QImage::Format_RGB16:
+        m_convertRow = convertRowToRGB16;
+        break;
+    default:
+        break;
+    }
+
     connect(VirtualTerminal::self(), &VirtualTerminal::activeChanged, this,
         [] (bool active) {
             if (active) {
@@ -65,21 +170,37 @@ bool FramebufferQPainterBackend::needsFullRepaint() const
 
 void FramebufferQPainterBackend::prepareRenderingFrame()
 {
-    m_needsFullRepaint = true;
 }
 
 void FramebufferQPainterBackend::present(int mask, const QRegion &damage)
 {
     Q_UNUSED(mask)
-    Q_UNUSED(damage)
 
     if (!LogindIntegration::self()->isActiveSession()) {
         return;
     }
     m_needsFullRepaint = false;
 
-    QPainter p(&m_backBuffer);
-    p.drawImage(QPoint(0, 0), m_backend->isBGR() ? m_renderBuffer.rgbSwapped() : m_renderBuffer);
+    // The render buffer keeps its contents, only what has been repainted needs to be copied.
+    const QRegion region = damage & m_renderBuffer.rect() & m_backBuffer.rect();
+
+    if (!m_convertRow) {
+        QPainter p(&m_backBuffer);
+        for (const QRect &rect : region) {
+            p.drawImage(rect.topLeft(), m_renderBuffer, rect);
+        }
+        return;
+    }
+
+    uchar *framebuffer = static_cast<uchar *>(m_backend->mappedMemory());
+    const int bytesPerLine = m_backend->bytesPerLine();
+    const int bytesPerPixel = m_backend->bitsPerPixel() / 8;
+    for (const QRect &rect : region) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            m_convertRow(framebuffer + y * bytesPerLine + rect.x() * bytesPerPixel,
+                         m_renderBuffer.constScanLine(y) + rect.x() * 4, rect.width());
+        }
+    }
 }
 
 bool FramebufferQPainterBackend::usesOverlayWindow() const
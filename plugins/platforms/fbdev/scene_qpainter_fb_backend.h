@@ -33,6 +33,11 @@ public:
     bool perScreenRendering() const override;
 
 private:
+    /**
+     * Converts @p width pixels of the render buffer to the format of the framebuffer.
+     */
+    typedef void (*ConvertRowFunction)(uchar *dst, const uchar *src, int width);
+
     /**
      * @brief mapped memory buffer on fb device
      */
@@ -44,6 +49,7 @@ private:
 
     FramebufferBackend *m_backend;
     bool m_needsFullRepaint;
+    ConvertRowFunction m_convertRow = nullptr;
 };
 
 }
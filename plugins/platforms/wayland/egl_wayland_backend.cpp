@@ -334,17 +334,8 @@ QRegion EglWaylandBackend::prepareRenderingForScreen(int screenId)
     auto *output = m_outputs.at(screenId);
     makeContextCurrent(output);
     if (supportsBufferAge()) {
-        QRegion region;
-
-        // Note: An age of zero means the buffer contents are undefined
-        if (output->m_bufferAge > 0 && output->m_bufferAge <= output->m_damageHistory.count()) {
-            for (int i = 0; i < output->m_bufferAge - 1; i++)
-                region |= output->m_damageHistory[i];
-        } else {
-            region = output->m_waylandOutput->geometry();
-        }
-
-        return region;
+        const QRect geometry = output->m_waylandOutput->geometry();
+        return output->m_damageJournal.accumulate(output->m_bufferAge, geometry) & geometry;
     }
     return QRegion();
 }
@@ -380,14 +371,13 @@ void EglWaylandBackend::endRenderingFrameForScreen(int screenId, const QRegion &
     presentOnSurface(output, damage);
 
     // Save the damaged region to history
-    // Note: damage history is only collected for the first screen. See EglGbmBackend
-    // for mor information regarding this limitation.
+    // Note: damage history is only collected for the first screen. For any other screen full
+    // repaints are triggered. All outputs are painted from one render loop, and
+    // Scene::paintGenericScreen resets the Toplevel's repaint, so only the first of multiple
+    // calls to Scene::paintScreen has correct damage information. Tracking damage for the
+    // other outputs nevertheless creates artifacts.
     if (supportsBufferAge() && screenId == 0) {
-        if (output->m_damageHistory.count() > 10) {
-            output->m_damageHistory.removeLast();
-        }
-
-        output->m_damageHistory.prepend(damage);
+        output->m_damageJournal.add(damage);
     }
 }
 
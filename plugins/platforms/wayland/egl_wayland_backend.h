@@ -45,7 +45,7 @@ private:
     /**
     * @brief The damage history for the past 10 frames.
     */
-    QVector<QRegion> m_damageHistory;
+    DamageJournal m_damageJournal;
 
     friend class EglWaylandBackend;
 };
@@ -26,7 +26,9 @@
 #include <kwineffectquickview.h>
 
 #include "utils.h"
+#include "waylandclient.h"
 #include "x11client.h"
+#include "xdgshellclient.h"
 #include "composite.h"
 #include "deleted.h"
 #include "effects.h"
@@ -45,6 +47,7 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <unistd.h>
 
 #include <QDBusConnection>
@@ -52,6 +55,7 @@
 #include <QDBusInterface>
 #include <QGraphicsScale>
 #include <QPainter>
+#include <QtConcurrentRun>
 #include <QStringList>
 #include <QVector2D>
 #include <QVector4D>
@@ -360,6 +364,7 @@ SceneOpenGL::~SceneOpenGL()
     SceneOpenGL::EffectFrame::cleanup();
 
     delete m_syncManager;
+    qDeleteAll(m_renderTimeQueries);
 
     // backend might be still needed for a different scene
     delete m_backend;
@@ -492,6 +497,11 @@ bool SceneOpenGL::blocksForRetrace() const
     return m_backend->blocksForRetrace();
 }
 
+bool SceneOpenGL::hasPerOutputRenderLoops() const
+{
+    return m_backend->perScreenRendering() && m_backend->hasPerOutputRenderLoops();
+}
+
 void SceneOpenGL::idle()
 {
     m_backend->idle();
@@ -606,7 +616,7 @@ void SceneOpenGL2::paintCursor()
     glDisable(GL_BLEND);
 }
 
-qint64 SceneOpenGL::paint(const QRegion &damage, const QList<Toplevel *> &toplevels)
+qint64 SceneOpenGL::paint(int screenId, const QRegion &damage, const QList<Toplevel *> &toplevels)
 {
     // actually paint the frame, flushed with the NEXT frame
     createStackingOrder(toplevels);
@@ -617,15 +627,36 @@ qint64 SceneOpenGL::paint(const QRegion &damage, const QList<Toplevel *> &toplev
     // by prepareRenderingFrame(). validRegion is the region that has been
     // repainted, and may be larger than updateRegion.
     QRegion updateRegion, validRegion;
+
+    // The time it took to render the previous frame including the time the GPU needed to
+    // execute the commands, if it can be measured. Otherwise only the CPU time is reported.
+    qint64 gpuRenderTime = -1;
     if (m_backend->perScreenRendering()) {
         // trigger start render timer
         m_backend->prepareRenderingFrame();
         for (int i = 0; i < screens()->count(); ++i) {
+            if (screenId != -1 && i != screenId) {
+                continue;
+            }
+            // A fullscreen window might be shown without compositing the screen at all.
+            if (KWaylandServer::SurfaceInterface *surface = directScanoutCandidate(i)) {
+                if (m_backend->scanout(i, surface)) {
+                    continue;
+                }
+            }
+
             const QRect &geo = screens()->geometry(i);
+            // Surfaces that have been removed from overlay planes have to be painted again.
+            const QRegion overlayDamage = assignOverlayPlanes(i);
             QRegion update;
             QRegion valid;
             // prepare rendering makes context current on the output
             QRegion repaint = m_backend->prepareRenderingForScreen(i);
+
+            // The previous frame on this screen has been presented, so the result is available.
+            GLRenderTimeQuery *renderTimeQuery = this->renderTimeQuery(i);
+            gpuRenderTime = qMax(gpuRenderTime, renderTimeQuery->result());
+            renderTimeQuery->begin();
             GLVertexBuffer::setVirtualScreenGeometry(geo);
             GLRenderTarget::setVirtualScreenGeometry(geo);
             GLVertexBuffer::setVirtualScreenScale(screens()->scale(i));
@@ -639,19 +670,25 @@ qint64 SceneOpenGL::paint(const QRegion &damage, const QList<Toplevel *> &toplev
 
             int mask = 0;
             updateProjectionMatrix();
-            paintScreen(&mask, damage.intersected(geo), repaint, &update, &valid, projectionMatrix(), geo, screens()->scale(i));   // call generic implementation
+            paintScreen(&mask, (damage | overlayDamage).intersected(geo), repaint, &update, &valid, projectionMatrix(), geo, screens()->scale(i));   // call generic implementation
             paintCursor();
 
             GLVertexBuffer::streamingBuffer()->endOfFrame();
 
+            renderTimeQuery->end();
             m_backend->endRenderingFrameForScreen(i, valid, update);
 
             GLVertexBuffer::streamingBuffer()->framePosted();
         }
+        m_overlaySurfaces.clear();
     } else {
         m_backend->makeCurrent();
         QRegion repaint = m_backend->prepareRenderingFrame();
 
+        GLRenderTimeQuery *renderTimeQuery = this->renderTimeQuery(0);
+        gpuRenderTime = renderTimeQuery->result();
+        renderTimeQuery->begin();
+
         const GLenum status = glGetGraphicsResetStatus();
         if (status != GL_NO_ERROR) {
             handleGraphicsReset(status);
@@ -683,11 +720,14 @@ qint64 SceneOpenGL::paint(const QRegion &damage, const QList<Toplevel *> &toplev
 
         GLVertexBuffer::streamingBuffer()->endOfFrame();
 
+        renderTimeQuery->end();
         m_backend->endRenderingFrame(validRegion, updateRegion);
 
         GLVertexBuffer::streamingBuffer()->framePosted();
     }
 
+    m_paintTimes.previousGpu = gpuRenderTime;
+
     if (m_currentFence) {
         if (!m_syncManager->updateFences()) {
             qCDebug(KWIN_OPENGL) << "Aborting explicit synchronization with the X command stream.";
@@ -700,7 +740,156 @@ qint64 SceneOpenGL::paint(const QRegion &damage, const QList<Toplevel *> &toplev
 
     // do cleanup
     clearStackingOrder();
-    return m_backend->renderTime();
+    return qMax(m_backend->renderTime(), gpuRenderTime);
+}
+
+GLRenderTimeQuery *SceneOpenGL::renderTimeQuery(int screenId)
+{
+    if (m_renderTimeQueries.size() <= screenId) {
+        m_renderTimeQueries.resize(screenId + 1);
+    }
+    if (!m_renderTimeQueries[screenId]) {
+        m_renderTimeQueries[screenId] = new GLRenderTimeQuery;
+    }
+    return m_renderTimeQueries[screenId];
+}
+
+KWaylandServer::SurfaceInterface *SceneOpenGL::directScanoutCandidate(int screenId) const
+{
+    if (static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return nullptr;
+    }
+    if (kwinApp()->platform()->usesSoftwareCursor() && !kwinApp()->platform()->isCursorHidden()) {
+        return nullptr;
+    }
+
+    // Only the topmost visible window on the screen can be scanned out, and only if it
+    // covers the whole screen with a single opaque surface.
+    const QRect screenGeometry = screens()->geometry(screenId);
+    for (int i = stacking_order.count() - 1; i >= 0; --i) {
+        Window *window = stacking_order[i];
+        Toplevel *toplevel = window->window();
+        if (!window->isVisible() || !window->isPaintingEnabled()
+                || !toplevel->frameGeometry().intersects(screenGeometry)) {
+            continue;
+        }
+        XdgToplevelClient *client = qobject_cast<XdgToplevelClient *>(toplevel);
+        if (!client || !client->isFullScreen() || !window->isOpaque()) {
+            return nullptr;
+        }
+        if (client->frameGeometry() != screenGeometry || client->bufferGeometry() != screenGeometry) {
+            return nullptr;
+        }
+        KWaylandServer::SurfaceInterface *surface = client->surface();
+        if (!surface || !surface->buffer() || !surface->childSubSurfaces().isEmpty()) {
+            return nullptr;
+        }
+        return surface;
+    }
+    return nullptr;
+}
+
+QVector<QPair<KWaylandServer::SurfaceInterface *, QRect>> SceneOpenGL::overlayCandidates(int screenId) const
+{
+    QVector<QPair<KWaylandServer::SurfaceInterface *, QRect>> candidates;
+    if (static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return candidates;
+    }
+
+    // Overlay planes are shown above the composited frame, so a surface can only be put on
+    // an overlay plane if nothing is painted above it.
+    QRegion above;
+    if (kwinApp()->platform()->usesSoftwareCursor() && !kwinApp()->platform()->isCursorHidden()) {
+        above += Cursors::self()->currentCursor()->geometry();
+    }
+
+    struct Node {
+        WindowPixmap *pixmap;
+        QRect geometry;
+        int parent;
+    };
+
+    const QRect screenGeometry = screens()->geometry(screenId);
+    for (int i = stacking_order.count() - 1; i >= 0; --i) {
+        Window *window = stacking_order[i];
+        Toplevel *toplevel = window->window();
+        if (!window->isVisible() || !window->isPaintingEnabled()) {
+            continue;
+        }
+        const QRect visibleRect = toplevel->visibleRect();
+        if (!visibleRect.intersects(screenGeometry)) {
+            continue;
+        }
+        WindowPixmap *rootPixmap = window->windowPixmap<WindowPixmap>();
+        if (!rootPixmap || !qobject_cast<WaylandClient *>(toplevel) || toplevel->opacity() != 1.0) {
+            above += visibleRect;
+            continue;
+        }
+
+        // Flatten the surface tree in painting order, children are painted above their parent.
+        QVector<Node> nodes;
+        nodes.append({rootPixmap, QRect(toplevel->pos() + rootPixmap->framePosition(), rootPixmap->surface()->size()), -1});
+        for (int j = 0; j < nodes.count(); ++j) {
+            const QVector<WindowPixmap *> children = nodes[j].pixmap->children();
+            for (WindowPixmap *child : children) {
+                if (child->isValid() && child->surface()) {
+                    nodes.append({child, QRect(toplevel->pos() + child->framePosition(), child->surface()->size()), j});
+                }
+            }
+        }
+
+        for (int j = 0; j < nodes.count(); ++j) {
+            const Node &node = nodes[j];
+            KWaylandServer::SurfaceInterface *surface = node.pixmap->surface();
+            KWaylandServer::BufferInterface *buffer = surface->buffer();
+            if (!buffer || !buffer->linuxDmabufBuffer() || !screenGeometry.contains(node.geometry)
+                    || above.intersects(node.geometry)) {
+                continue;
+            }
+            if (buffer->hasAlphaChannel() && surface->opaque() != QRegion(QRect(QPoint(0, 0), surface->size()))) {
+                continue;
+            }
+            // Only ancestors of the surface may be painted below it.
+            bool occluded = false;
+            for (int k = 0; k < nodes.count() && !occluded; ++k) {
+                if (k == j || !nodes[k].geometry.intersects(node.geometry)) {
+                    continue;
+                }
+                int ancestor = node.parent;
+                while (ancestor != -1 && ancestor != k) {
+                    ancestor = nodes[ancestor].parent;
+                }
+                occluded = ancestor == -1;
+            }
+            if (!occluded) {
+                candidates.append(qMakePair(surface, node.geometry));
+            }
+        }
+        above += visibleRect;
+    }
+    return candidates;
+}
+
+QRegion SceneOpenGL::assignOverlayPlanes(int screenId)
+{
+    m_overlaySurfaces.clear();
+    m_backend->resetOverlayPlanes(screenId);
+
+    QRegion overlayRegion;
+    const auto candidates = overlayCandidates(screenId);
+    for (const auto &candidate : candidates) {
+        if (m_backend->assignOverlayPlane(screenId, candidate.first, candidate.second)) {
+            m_overlaySurfaces.insert(candidate.first);
+            overlayRegion += candidate.second;
+        }
+    }
+
+    if (m_overlayRegions.size() <= screenId) {
+        m_overlayRegions.resize(screenId + 1);
+    }
+    const QRegion damage = m_overlayRegions[screenId] - overlayRegion;
+    m_overlayRegions[screenId] = overlayRegion;
+    return damage;
 }
 
 QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) const
@@ -1002,7 +1191,15 @@ void SceneOpenGL2::paintSimpleScreen(int mask, const QRegion &region)
 {
     m_screenProjectionMatrix = m_projectionMatrix;
 
+    // Windows can only be drawn together if no effect gets a chance to draw in between.
+    const bool wasBatchingWindows = m_batchWindows;
+    m_drawBatch.flush();
+    m_batchWindows = !static_cast<EffectsHandlerImpl *>(effects)->hasActiveEffects();
+
     Scene::paintSimpleScreen(mask, region);
+
+    m_drawBatch.flush();
+    m_batchWindows = wasBatchingWindows;
 }
 
 void SceneOpenGL2::paintGenericScreen(int mask, const ScreenPaintData &data)
@@ -1011,7 +1208,13 @@ void SceneOpenGL2::paintGenericScreen(int mask, const ScreenPaintData &data)
 
     m_screenProjectionMatrix = m_projectionMatrix * screenMatrix;
 
+    const bool wasBatchingWindows = m_batchWindows;
+    m_drawBatch.flush();
+    m_batchWindows = false;
+
     Scene::paintGenericScreen(mask, data);
+
+    m_batchWindows = wasBatchingWindows;
 }
 
 void SceneOpenGL2::doPaintBackground(const QVector< float >& vertices)
@@ -1043,6 +1246,8 @@ void SceneOpenGL2::finalDrawWindow(EffectWindowImpl* w, int mask, const QRegion
 void SceneOpenGL2::performPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (mask & PAINT_WINDOW_LANCZOS) {
+        // the lanczos filter renders on its own
+        m_drawBatch.flush();
         if (!m_lanczosFilter) {
             m_lanczosFilter = new LanczosFilter(this);
             // reset the lanczos filter when the screen gets resized
@@ -1058,6 +1263,112 @@ void SceneOpenGL2::performPaintWindow(EffectWindowImpl* w, int mask, const QRegi
         w->sceneWindow()->performPaint(mask, region, data);
 }
 
+//****************************************
+// OpenGLDrawBatch
+//****************************************
+
+GLVertex2D *OpenGLDrawBatch::addDraw(const Draw &draw)
+{
+    const int firstVertex = m_vertices.count();
+    m_vertices.resize(firstVertex + draw.vertexCount);
+    m_draws.append(draw);
+    m_draws.last().firstVertex = firstVertex;
+    return m_vertices.data() + firstVertex;
+}
+
+static bool canMergeDraws(const OpenGLDrawBatch::Draw &a, const OpenGLDrawBatch::Draw &b)
+{
+    return a.texture == b.texture && a.traits == b.traits && a.filter == b.filter && a.blend == b.blend
+        && a.modulation == b.modulation && a.saturation == b.saturation && a.mvpMatrix == b.mvpMatrix;
+}
+
+void OpenGLDrawBatch::flush()
+{
+    if (m_draws.isEmpty()) {
+        return;
+    }
+
+    const GLVertexAttrib attribs[] = {
+        { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+        { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+    };
+
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
+    const size_t size = m_vertices.count() * sizeof(GLVertex2D);
+    void *map = vbo->map(size);
+    memcpy(map, m_vertices.constData(), size);
+    vbo->unmap();
+    vbo->bindArrays();
+
+    const GLenum primitiveType = GLVertexBuffer::supportsIndexedQuads() ? GL_QUADS : GL_TRIANGLES;
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLShader *shader = nullptr;
+    const Draw *state = nullptr;
+    GLTexture *texture = nullptr;
+    bool blending = false;
+
+    for (int i = 0; i < m_draws.count();) {
+        const Draw &draw = m_draws[i];
+        int vertexCount = draw.vertexCount;
+        for (++i; i < m_draws.count() && canMergeDraws(draw, m_draws[i]); ++i) {
+            vertexCount += m_draws[i].vertexCount;
+        }
+
+        if (!shader || state->traits != draw.traits) {
+            if (shader) {
+                ShaderManager::instance()->popShader();
+            }
+            shader = ShaderManager::instance()->pushShader(draw.traits);
+            shader->setUniform(GLShader::ModelViewProjectionMatrix, draw.mvpMatrix);
+            shader->setUniform(GLShader::ModulationConstant, draw.modulation);
+            shader->setUniform(GLShader::Saturation, draw.saturation);
+            shader->setUniform(GLShader::TextureClamp, QVector4D({0, 0, 1, 1}));
+        } else {
+            if (state->mvpMatrix != draw.mvpMatrix) {
+                shader->setUniform(GLShader::ModelViewProjectionMatrix, draw.mvpMatrix);
+            }
+            if (state->modulation != draw.modulation) {
+                shader->setUniform(GLShader::ModulationConstant, draw.modulation);
+            }
+            if (state->saturation != draw.saturation) {
+                shader->setUniform(GLShader::Saturation, draw.saturation);
+            }
+        }
+        const bool filterChanged = state && state->filter != draw.filter;
+        state = &draw;
+
+        if (blending != draw.blend) {
+            if (draw.blend) {
+                glEnable(GL_BLEND);
+            } else {
+                glDisable(GL_BLEND);
+            }
+            blending = draw.blend;
+        }
+
+        draw.texture->setFilter(draw.filter);
+        draw.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        if (texture != draw.texture || filterChanged) {
+            draw.texture->bind();
+            texture = draw.texture;
+        }
+
+        vbo->draw(primitiveType, draw.firstVertex, vertexCount);
+    }
+
+    vbo->unbindArrays();
+    if (blending) {
+        glDisable(GL_BLEND);
+    }
+    ShaderManager::instance()->popShader();
+
+    m_vertices.clear();
+    m_draws.clear();
+}
+
 //****************************************
 // OpenGLWindow
 //****************************************
@@ -1319,7 +1630,10 @@ void OpenGLWindow::initializeRenderContext(RenderContext &context, const WindowP
             continue;
 
         RenderNode &contentRenderNode = renderNodes[context.contentOffset + i++];
-        contentRenderNode.texture = windowPixmap->texture();
+        // Surfaces on overlay planes are shown by the hardware.
+        if (!m_scene->isOnOverlayPlane(windowPixmap->surface())) {
+            contentRenderNode.texture = windowPixmap->texture();
+        }
         contentRenderNode.hasAlpha = windowPixmap->hasAlphaChannel();
         contentRenderNode.opacity = contentOpacity;
         contentRenderNode.coordinateType = UnnormalizedCoordinates;
@@ -1423,27 +1737,36 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
         }
     }
 
-    if (!shader) {
-        ShaderTraits traits = ShaderTrait::MapTexture;
-        if (useX11TextureClamp) {
-            traits |= ShaderTrait::ClampTexture;
-        }
+    ShaderTraits traits = ShaderTrait::MapTexture;
+    if (useX11TextureClamp) {
+        traits |= ShaderTrait::ClampTexture;
+    }
 
-        if (data.opacity() != 1.0 || data.brightness() != 1.0 || data.crossFadeProgress() != 1.0)
-            traits |= ShaderTrait::Modulate;
+    if (data.opacity() != 1.0 || data.brightness() != 1.0 || data.crossFadeProgress() != 1.0)
+        traits |= ShaderTrait::Modulate;
 
-        if (data.saturation() != 1.0)
-            traits |= ShaderTrait::AdjustSaturation;
+    if (data.saturation() != 1.0)
+        traits |= ShaderTrait::AdjustSaturation;
 
+    RenderContext renderContext;
+    initializeRenderContext(renderContext, data);
+
+    // Untransformed windows painted with the default shader only differ in the textures,
+    // their vertices are moved to the window position so they share the same matrix.
+    OpenGLDrawBatch *batch = static_cast<SceneOpenGL2 *>(m_scene)->drawBatch();
+    if (batch && !shader && !(mask & Scene::PAINT_WINDOW_TRANSFORMED)) {
+        addToDrawBatch(batch, renderContext, traits, modelViewProjection, data, filter);
+        endRenderWindow();
+        return;
+    }
+
+    if (!shader) {
         shader = ShaderManager::instance()->pushShader(traits);
     }
     shader->setUniform(GLShader::ModelViewProjectionMatrix, mvpMatrix);
 
     shader->setUniform(GLShader::Saturation, data.saturation());
 
-    RenderContext renderContext;
-    initializeRenderContext(renderContext, data);
-
     const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
     const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
     const int verticesPerQuad = indexedQuads ? 4 : 6;
@@ -1525,6 +1848,36 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
     endRenderWindow();
 }
 
+void OpenGLWindow::addToDrawBatch(OpenGLDrawBatch *batch, RenderContext &context, ShaderTraits traits,
+                                  const QMatrix4x4 &mvpMatrix, const WindowPaintData &data, GLenum filter)
+{
+    const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
+    const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
+    const int verticesPerQuad = indexedQuads ? 4 : 6;
+    const QVector2D offset(x(), y());
+
+    for (const RenderNode &renderNode : qAsConst(context.renderNodes)) {
+        if (renderNode.quads.isEmpty() || !renderNode.texture)
+            continue;
+
+        OpenGLDrawBatch::Draw draw;
+        draw.texture = renderNode.texture;
+        draw.traits = traits;
+        draw.mvpMatrix = mvpMatrix;
+        draw.modulation = modulate(renderNode.opacity, data.brightness());
+        draw.saturation = data.saturation();
+        draw.filter = filter;
+        draw.blend = renderNode.hasAlpha || renderNode.opacity < 1.0;
+        draw.vertexCount = renderNode.quads.count() * verticesPerQuad;
+
+        GLVertex2D *vertices = batch->addDraw(draw);
+        renderNode.quads.makeInterleavedArrays(primitiveType, vertices, renderNode.texture->matrix(renderNode.coordinateType));
+        for (int i = 0; i < draw.vertexCount; ++i) {
+            vertices[i].position += offset;
+        }
+    }
+}
+
 QSharedPointer<GLTexture> OpenGLWindow::windowTexture()
 {
     auto frame = windowPixmap<OpenGLWindowPixmap>();
@@ -2157,6 +2510,109 @@ QSharedPointer<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLSh
     return d.texture;
 }
 
+/**
+ * Shares the shadow textures of windows with identical shadow elements, like the many
+ * windows of an application that all use the same shadow. The elements are compared by
+ * their contents, as every window provides its own pixmaps.
+ */
+class ShadowTextureCache
+{
+public:
+    ~ShadowTextureCache();
+    ShadowTextureCache(const ShadowTextureCache&) = delete;
+    static ShadowTextureCache &instance();
+
+    void unregister(SceneOpenGLShadow *shadow);
+    /**
+     * Returns the texture of a shadow with the same @p elements and shares it with @p shadow,
+     * or a null pointer if there is none yet.
+     */
+    QSharedPointer<GLTexture> findTexture(SceneOpenGLShadow *shadow, const QVector<QImage> &elements);
+    void insert(SceneOpenGLShadow *shadow, const QVector<QImage> &elements, const QSharedPointer<GLTexture> &texture);
+
+private:
+    ShadowTextureCache() = default;
+    static uint hashElements(const QVector<QImage> &elements);
+    struct Data {
+        QVector<QImage> elements;
+        QSharedPointer<GLTexture> texture;
+        QVector<SceneOpenGLShadow*> shadows;
+    };
+    QMultiHash<uint, Data> m_cache;
+    QHash<SceneOpenGLShadow*, uint> m_keys;
+};
+
+ShadowTextureCache &ShadowTextureCache::instance()
+{
+    static ShadowTextureCache s_instance;
+    return s_instance;
+}
+
+ShadowTextureCache::~ShadowTextureCache()
+{
+    Q_ASSERT(m_cache.isEmpty());
+}
+
+void ShadowTextureCache::unregister(SceneOpenGLShadow *shadow)
+{
+    auto keyIt = m_keys.find(shadow);
+    if (keyIt == m_keys.end()) {
+        return;
+    }
+    auto it = m_cache.find(keyIt.value());
+    while (it != m_cache.end() && it.key() == keyIt.value()) {
+        if (it.value().shadows.removeOne(shadow)) {
+            // if there are no shadows any more we can erase the cache entry
+            if (it.value().shadows.isEmpty()) {
+                m_cache.erase(it);
+            }
+            break;
+        }
+        ++it;
+    }
+    m_keys.erase(keyIt);
+}
+
+QSharedPointer<GLTexture> ShadowTextureCache::findTexture(SceneOpenGLShadow *shadow, const QVector<QImage> &elements)
+{
+    unregister(shadow);
+    const uint key = hashElements(elements);
+    for (auto it = m_cache.find(key); it != m_cache.end() && it.key() == key; ++it) {
+        if (it.value().elements == elements) {
+            it.value().shadows << shadow;
+            m_keys.insert(shadow, key);
+            return it.value().texture;
+        }
+    }
+    return QSharedPointer<GLTexture>();
+}
+
+void ShadowTextureCache::insert(SceneOpenGLShadow *shadow, const QVector<QImage> &elements, const QSharedPointer<GLTexture> &texture)
+{
+    unregister(shadow);
+    const uint key = hashElements(elements);
+    Data d;
+    d.elements = elements;
+    d.texture = texture;
+    d.shadows << shadow;
+    m_cache.insert(key, d);
+    m_keys.insert(shadow, key);
+}
+
+uint ShadowTextureCache::hashElements(const QVector<QImage> &elements)
+{
+    uint hash = 0;
+    for (const QImage &element : elements) {
+        hash = qHash(element.width(), hash);
+        hash = qHash(element.height(), hash);
+        // only the pixels count, not the padding at the end of the lines
+        for (int y = 0; y < element.height(); ++y) {
+            hash = qHashBits(element.constScanLine(y), element.width() * 4, hash);
+        }
+    }
+    return hash;
+}
+
 SceneOpenGLShadow::SceneOpenGLShadow(Toplevel *toplevel)
     : Shadow(toplevel)
 {
@@ -2168,6 +2624,7 @@ SceneOpenGLShadow::~SceneOpenGLShadow()
     if (scene) {
         scene->makeOpenGLContextCurrent();
         DecorationShadowTextureCache::instance().unregister(this);
+        ShadowTextureCache::instance().unregister(this);
         m_texture.reset();
     }
 }
@@ -2427,18 +2884,34 @@ bool SceneOpenGLShadow::prepareBackend()
         // simplifies a lot by going directly to
         Scene *scene = Compositor::self()->scene();
         scene->makeOpenGLContextCurrent();
+        ShadowTextureCache::instance().unregister(this);
         m_texture = DecorationShadowTextureCache::instance().getTexture(this);
 
         return true;
     }
-    const QSize top(shadowPixmap(ShadowElementTop).size());
-    const QSize topRight(shadowPixmap(ShadowElementTopRight).size());
-    const QSize right(shadowPixmap(ShadowElementRight).size());
-    const QSize bottom(shadowPixmap(ShadowElementBottom).size());
-    const QSize bottomLeft(shadowPixmap(ShadowElementBottomLeft).size());
-    const QSize left(shadowPixmap(ShadowElementLeft).size());
-    const QSize topLeft(shadowPixmap(ShadowElementTopLeft).size());
-    const QSize bottomRight(shadowPixmap(ShadowElementBottomRight).size());
+    Scene *scene = Compositor::self()->scene();
+    scene->makeOpenGLContextCurrent();
+    DecorationShadowTextureCache::instance().unregister(this);
+
+    // windows with identical shadows share the texture, the expensive part is only done once
+    QVector<QImage> elements;
+    elements.reserve(ShadowElementsCount);
+    for (int i = 0; i < ShadowElementsCount; ++i) {
+        elements << shadowPixmap(ShadowElements(i)).toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    m_texture = ShadowTextureCache::instance().findTexture(this, elements);
+    if (!m_texture.isNull()) {
+        return true;
+    }
+
+    const QSize top(elements[ShadowElementTop].size());
+    const QSize topRight(elements[ShadowElementTopRight].size());
+    const QSize right(elements[ShadowElementRight].size());
+    const QSize bottom(elements[ShadowElementBottom].size());
+    const QSize bottomLeft(elements[ShadowElementBottomLeft].size());
+    const QSize left(elements[ShadowElementLeft].size());
+    const QSize topLeft(elements[ShadowElementTopLeft].size());
+    const QSize bottomRight(elements[ShadowElementBottomRight].size());
 
     const int width = std::max({topLeft.width(), left.width(), bottomLeft.width()}) +
                       std::max(top.width(), bottom.width()) +
@@ -2460,17 +2933,17 @@ bool SceneOpenGLShadow::prepareBackend()
     QPainter p;
     p.begin(&image);
 
-    p.drawPixmap(0, 0, topLeft.width(), topLeft.height(), shadowPixmap(ShadowElementTopLeft));
-    p.drawPixmap(innerRectLeft, 0, top.width(), top.height(), shadowPixmap(ShadowElementTop));
-    p.drawPixmap(width - topRight.width(), 0, topRight.width(), topRight.height(), shadowPixmap(ShadowElementTopRight));
+    p.drawImage(QRect(0, 0, topLeft.width(), topLeft.height()), elements[ShadowElementTopLeft]);
+    p.drawImage(QRect(innerRectLeft, 0, top.width(), top.height()), elements[ShadowElementTop]);
+    p.drawImage(QRect(width - topRight.width(), 0, topRight.width(), topRight.height()), elements[ShadowElementTopRight]);
 
-    p.drawPixmap(0, innerRectTop, left.width(), left.height(), shadowPixmap(ShadowElementLeft));
-    p.drawPixmap(width - right.width(), innerRectTop, right.width(), right.height(), shadowPixmap(ShadowElementRight));
+    p.drawImage(QRect(0, innerRectTop, left.width(), left.height()), elements[ShadowElementLeft]);
+    p.drawImage(QRect(width - right.width(), innerRectTop, right.width(), right.height()), elements[ShadowElementRight]);
+
+    p.drawImage(QRect(0, height - bottomLeft.height(), bottomLeft.width(), bottomLeft.height()), elements[ShadowElementBottomLeft]);
+    p.drawImage(QRect(innerRectLeft, height - bottom.height(), bottom.width(), bottom.height()), elements[ShadowElementBottom]);
+    p.drawImage(QRect(width - bottomRight.width(), height - bottomRight.height(), bottomRight.width(), bottomRight.height()), elements[ShadowElementBottomRight]);
 
-    p.drawPixmap(0, height - bottomLeft.height(), bottomLeft.width(), bottomLeft.height(), shadowPixmap(ShadowElementBottomLeft));
-    p.drawPixmap(innerRectLeft, height - bottom.height(), bottom.width(), bottom.height(), shadowPixmap(ShadowElementBottom));
-    p.drawPixmap(width - bottomRight.width(), height - bottomRight.height(), bottomRight.width(), bottomRight.height(), shadowPixmap(ShadowElementBottomRight));
-    
     p.end();
 
     // Check if the image is alpha-only in practice, and if so convert it to an 8-bpp format
@@ -2495,8 +2968,6 @@ bool SceneOpenGLShadow::prepareBackend()
         }
     }
 
-    Scene *scene = Compositor::self()->scene();
-    scene->makeOpenGLContextCurrent();
     m_texture = QSharedPointer<GLTexture>::create(image);
 
     if (m_texture->internalFormat() == GL_R8) {
@@ -2505,6 +2976,8 @@ bool SceneOpenGLShadow::prepareBackend()
         m_texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
     }
 
+    ShadowTextureCache::instance().insert(this, elements, m_texture);
+
     return true;
 }
 
@@ -2513,10 +2986,18 @@ SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::Decorat
     , m_texture()
 {
     connect(this, &Renderer::renderScheduled, client->client(), static_cast<void (AbstractClient::*)(const QRect&)>(&AbstractClient::addRepaint));
+    // The rasterized parts are uploaded when the decoration texture is needed for the next frame.
+    connect(&m_rasterizationWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        if (m_rasterizing) {
+            emit renderScheduled(m_rasterizedRect);
+        }
+    });
 }
 
 SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
 {
+    // The worker doesn't reference the renderer, an unfinished job is simply dropped.
+    m_rasterizing = false;
     if (Scene *scene = Compositor::self()->scene()) {
         scene->makeOpenGLContextCurrent();
     }
@@ -2524,11 +3005,11 @@ SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
 
 // Rotates the given source rect 90° counter-clockwise,
 // and flips it vertically
-static QImage rotate(const QImage &srcImage, const QRect &srcRect)
+static void rotate(const QImage &srcImage, const QRect &srcRect, QImage &image)
 {
-    auto dpr = srcImage.devicePixelRatio();
-    QImage image(srcRect.height() * dpr, srcRect.width() * dpr, srcImage.format());
-    image.setDevicePixelRatio(dpr);
+    const qreal dpr = srcImage.devicePixelRatio();
+    Q_ASSERT(image.width() == qRound(srcRect.height() * dpr));
+    Q_ASSERT(image.height() == qRound(srcRect.width() * dpr));
     const QPoint srcPoint(srcRect.x() * dpr, srcRect.y() * dpr);
 
     const uint32_t *src = reinterpret_cast<const uint32_t *>(srcImage.bits());
@@ -2543,8 +3024,6 @@ static QImage rotate(const QImage &srcImage, const QRect &srcRect)
             d += image.width();
         }
     }
-
-    return image;
 }
 
 static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
@@ -2593,8 +3072,66 @@ static void clamp(QImage &image, const QRect &viewport)
     }
 }
 
+static void rasterizeDirtyPart(SceneOpenGLDecorationRenderer::DirtyPart &part)
+{
+    const qreal devicePixelRatio = part.devicePixelRatio;
+    const QRect viewport(part.viewport.topLeft(), part.viewport.size() * devicePixelRatio);
+
+    part.image.fill(Qt::transparent);
+
+    QPainter painter(&part.image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setViewport(viewport);
+    painter.setWindow(QRect(part.geometry.topLeft(), part.geometry.size() * devicePixelRatio));
+    painter.setClipRect(part.geometry);
+    painter.drawPicture(0, 0, part.picture);
+    painter.end();
+
+    clamp(part.image, viewport);
+
+    if (part.rotated) {
+        rotate(part.image, QRect(QPoint(), part.rect.size()), part.rotatedImage);
+    }
+}
+
+static QImage acquireImage(QVector<QImage> &pool, const QSize &size, qreal devicePixelRatio)
+{
+    for (int i = 0; i < pool.count(); ++i) {
+        if (pool.at(i).size() == size) {
+            QImage image = pool.takeAt(i);
+            image.setDevicePixelRatio(devicePixelRatio);
+            return image;
+        }
+    }
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    return image;
+}
+
+static void releaseImage(QVector<QImage> &pool, QImage &image)
+{
+    // A decoration has four parts, each needs at most two images.
+    const int maxPoolSize = 8;
+    if (!image.isNull() && pool.count() < maxPoolSize) {
+        pool.append(image);
+    }
+    image = QImage();
+}
+
 void SceneOpenGLDecorationRenderer::render()
 {
+    render(false);
+}
+
+void SceneOpenGLDecorationRenderer::render(bool synchronous)
+{
+    // A resize replaces the texture, the new layout mustn't be drawn from the old one.
+    finishRasterization(synchronous || areImageSizesDirty());
+    if (m_rasterizing) {
+        // Still busy, the scheduled region is picked up once the current job is uploaded.
+        return;
+    }
+
     const QRegion scheduled = getScheduled();
     if (scheduled.isEmpty()) {
         return;
@@ -2602,6 +3139,8 @@ void SceneOpenGLDecorationRenderer::render()
     if (areImageSizesDirty()) {
         resizeTexture();
         resetImageSizesDirty();
+        // A new texture is empty, don't show it before it has got its contents.
+        synchronous = true;
     }
 
     if (!m_texture) {
@@ -2609,13 +3148,44 @@ void SceneOpenGLDecorationRenderer::render()
         return;
     }
 
+    QVector<DirtyPart> parts = recordDirtyParts(scheduled);
+    if (parts.isEmpty()) {
+        return;
+    }
+
+    if (synchronous) {
+        for (DirtyPart &part : parts) {
+            rasterizeDirtyPart(part);
+        }
+        uploadDirtyParts(parts);
+        return;
+    }
+
+    m_rasterizing = true;
+    m_rasterizedRect = scheduled.boundingRect();
+    m_rasterizationWatcher.setFuture(QtConcurrent::run([parts = std::move(parts)]() mutable {
+        for (DirtyPart &part : parts) {
+            rasterizeDirtyPart(part);
+        }
+        return parts;
+    }));
+}
+
+QVector<SceneOpenGLDecorationRenderer::DirtyPart> SceneOpenGLDecorationRenderer::recordDirtyParts(const QRegion &scheduled)
+{
     QRect left, top, right, bottom;
     client()->client()->layoutDecorationRects(left, top, right, bottom);
 
     // We pad each part in the decoration atlas in order to avoid texture bleeding.
     const int padding = 1;
+    const qreal devicePixelRatio = client()->client()->screenScale();
+
+    QVector<DirtyPart> parts;
+    parts.reserve(4);
 
-    auto renderPart = [=](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
+    // The decoration can only be painted on the main thread, record it into a picture
+    // which gets rasterized by a worker thread.
+    auto recordPart = [&](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
         if (!geo.isValid()) {
             return;
         }
@@ -2638,31 +3208,31 @@ void SceneOpenGLDecorationRenderer::render()
             rect.setBottom(rect.bottom() + padding);
         }
 
-        QRect viewport = geo.translated(-rect.x(), -rect.y());
-        const qreal devicePixelRatio = client()->client()->screenScale();
+        DirtyPart part;
+        part.geometry = geo;
+        part.rect = rect;
+        part.viewport = geo.translated(-rect.x(), -rect.y());
+        part.devicePixelRatio = devicePixelRatio;
+        part.rotated = rotated;
 
-        QImage image(rect.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
-        image.setDevicePixelRatio(devicePixelRatio);
-        image.fill(Qt::transparent);
-
-        QPainter painter(&image);
+        QPainter painter(&part.picture);
         painter.setRenderHint(QPainter::Antialiasing);
-        painter.setViewport(QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
-        painter.setWindow(QRect(geo.topLeft(), geo.size() * devicePixelRatio));
         painter.setClipRect(geo);
         renderToPainter(&painter, geo);
         painter.end();
 
-        clamp(image, QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
+        const QSize imageSize = rect.size() * devicePixelRatio;
+        part.image = acquireImage(m_imagePool, imageSize, devicePixelRatio);
 
+        QRect viewport = part.viewport;
         if (rotated) {
-            // TODO: get this done directly when rendering to the image
-            image = rotate(image, QRect(QPoint(), rect.size()));
+            part.rotatedImage = acquireImage(m_imagePool, imageSize.transposed(), devicePixelRatio);
             viewport = QRect(viewport.y(), viewport.x(), viewport.height(), viewport.width());
         }
 
         const QPoint dirtyOffset = geo.topLeft() - partRect.topLeft();
-        m_texture->update(image, (position + dirtyOffset - viewport.topLeft()) * image.devicePixelRatio());
+        part.uploadOffset = (position + dirtyOffset - viewport.topLeft()) * devicePixelRatio;
+        parts.append(part);
     };
 
     const QRect geometry = scheduled.boundingRect();
@@ -2672,10 +3242,39 @@ void SceneOpenGLDecorationRenderer::render()
     const QPoint leftPosition(padding, bottomPosition.y() + bottom.height() + 2 * padding);
     const QPoint rightPosition(padding, leftPosition.y() + left.width() + 2 * padding);
 
-    renderPart(left.intersected(geometry), left, leftPosition, true);
-    renderPart(top.intersected(geometry), top, topPosition);
-    renderPart(right.intersected(geometry), right, rightPosition, true);
-    renderPart(bottom.intersected(geometry), bottom, bottomPosition);
+    recordPart(left.intersected(geometry), left, leftPosition, true);
+    recordPart(top.intersected(geometry), top, topPosition);
+    recordPart(right.intersected(geometry), right, rightPosition, true);
+    recordPart(bottom.intersected(geometry), bottom, bottomPosition);
+
+    return parts;
+}
+
+void SceneOpenGLDecorationRenderer::uploadDirtyParts(QVector<DirtyPart> &parts)
+{
+    for (DirtyPart &part : parts) {
+        if (m_texture) {
+            m_texture->update(part.rotated ? part.rotatedImage : part.image, part.uploadOffset);
+        }
+        releaseImage(m_imagePool, part.image);
+        releaseImage(m_imagePool, part.rotatedImage);
+    }
+}
+
+void SceneOpenGLDecorationRenderer::finishRasterization(bool wait)
+{
+    if (!m_rasterizing) {
+        return;
+    }
+    if (wait) {
+        m_rasterizationWatcher.waitForFinished();
+    } else if (!m_rasterizationWatcher.isFinished()) {
+        return;
+    }
+    m_rasterizing = false;
+    QVector<DirtyPart> parts = m_rasterizationWatcher.result();
+    m_rasterizationWatcher.setFuture(QFuture<QVector<DirtyPart>>());
+    uploadDirtyParts(parts);
 }
 
 static int align(int value, int align)
@@ -2717,7 +3316,8 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
 
 void SceneOpenGLDecorationRenderer::reparent(Deleted *deleted)
 {
-    render();
+    // The decoration goes away with the client, everything has to be in the texture now.
+    render(true);
     Renderer::reparent(deleted);
 }
 
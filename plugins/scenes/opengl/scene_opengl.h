@@ -19,6 +19,10 @@
 #include "decorations/decorationrenderer.h"
 #include "platformsupport/scenes/opengl/backend.h"
 
+#include <QFutureWatcher>
+#include <QPicture>
+#include <QSet>
+
 namespace KWin
 {
 class LanczosFilter;
@@ -35,7 +39,7 @@ public:
     ~SceneOpenGL() override;
     bool initFailed() const override;
     bool hasPendingFlush() const override;
-    qint64 paint(const QRegion &damage, const QList<Toplevel *> &windows) override;
+    qint64 paint(int screenId, const QRegion &damage, const QList<Toplevel *> &windows) override;
     Scene::EffectFrame *createEffectFrame(EffectFrameImpl *frame) override;
     Shadow *createShadow(Toplevel *toplevel) override;
     void screenGeometryChanged(const QSize &size) override;
@@ -43,6 +47,7 @@ public:
     bool usesOverlayWindow() const override;
     bool blocksForRetrace() const override;
     bool syncsToVBlank() const override;
+    bool hasPerOutputRenderLoops() const override;
     bool makeOpenGLContextCurrent() override;
     void doneOpenGLContextCurrent() override;
     Decoration::Renderer *createDecorationRenderer(Decoration::DecoratedClientImpl *impl) override;
@@ -52,6 +57,14 @@ public:
 
     void insertWait();
 
+    /**
+     * Whether @p surface is shown on a hardware overlay plane of the screen that is being
+     * painted, in which case it must not be painted.
+     */
+    bool isOnOverlayPlane(KWaylandServer::SurfaceInterface *surface) const {
+        return m_overlaySurfaces.contains(surface);
+    }
+
     void idle() override;
 
     bool debug() const { return m_debug; }
@@ -90,12 +103,58 @@ protected:
     bool init_ok;
 private:
     bool viewportLimitsMatched(const QSize &size) const;
+    GLRenderTimeQuery *renderTimeQuery(int screenId);
+    KWaylandServer::SurfaceInterface *directScanoutCandidate(int screenId) const;
+    QVector<QPair<KWaylandServer::SurfaceInterface *, QRect>> overlayCandidates(int screenId) const;
+    QRegion assignOverlayPlanes(int screenId);
 
 private:
     bool m_debug;
     OpenGLBackend *m_backend;
     SyncManager *m_syncManager;
     SyncObject *m_currentFence;
+    QVector<GLRenderTimeQuery *> m_renderTimeQueries;
+    QSet<KWaylandServer::SurfaceInterface *> m_overlaySurfaces;
+    QVector<QRegion> m_overlayRegions;
+};
+
+/**
+ * The OpenGLDrawBatch class collects the draws of several windows.
+ *
+ * The vertices of all windows are uploaded at once when the batch gets flushed, and the
+ * shader, uniforms and textures are only changed where two consecutive draws differ.
+ * Consecutive draws sharing all state are merged into a single draw call.
+ */
+class OpenGLDrawBatch
+{
+public:
+    struct Draw
+    {
+        GLTexture *texture = nullptr;
+        ShaderTraits traits;
+        QMatrix4x4 mvpMatrix;
+        QVector4D modulation;
+        float saturation = 1.0;
+        GLenum filter = GL_LINEAR;
+        bool blend = false;
+        int firstVertex = 0;
+        int vertexCount = 0;
+    };
+
+    bool isEmpty() const {
+        return m_draws.isEmpty();
+    }
+
+    /**
+     * Adds @p draw with room for its vertices, the returned pointer is only valid until
+     * the next draw is added.
+     */
+    GLVertex2D *addDraw(const Draw &draw);
+    void flush();
+
+private:
+    QVector<GLVertex2D> m_vertices;
+    QVector<Draw> m_draws;
 };
 
 class SceneOpenGL2 : public SceneOpenGL
@@ -113,6 +172,14 @@ public:
     QMatrix4x4 projectionMatrix() const override { return m_projectionMatrix; }
     QMatrix4x4 screenProjectionMatrix() const override { return m_screenProjectionMatrix; }
 
+    /**
+     * Returns the batch untransformed windows should add their draws to, or @c null if
+     * windows have to be drawn immediately.
+     */
+    OpenGLDrawBatch *drawBatch() {
+        return m_batchWindows ? &m_drawBatch : nullptr;
+    }
+
 protected:
     void paintSimpleScreen(int mask, const QRegion &region) override;
     void paintGenericScreen(int mask, const ScreenPaintData &data) override;
@@ -132,6 +199,8 @@ private:
     QMatrix4x4 m_projectionMatrix;
     QMatrix4x4 m_screenProjectionMatrix;
     GLuint vao;
+    OpenGLDrawBatch m_drawBatch;
+    bool m_batchWindows = false;
 };
 
 class OpenGLWindowPixmap;
@@ -189,6 +258,8 @@ private:
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
     void initializeRenderContext(RenderContext &context, const WindowPaintData &data);
+    void addToDrawBatch(OpenGLDrawBatch *batch, RenderContext &context, ShaderTraits traits,
+                        const QMatrix4x4 &mvpMatrix, const WindowPaintData &data, GLenum filter);
     bool beginRenderWindow(int mask, const QRegion &region, WindowPaintData &data);
     void endRenderWindow();
     bool bindTexture();
@@ -286,6 +357,22 @@ public:
         Bottom,
         Count
     };
+    /**
+     * A dirty part of the decoration. The decoration is painted into a QPicture on the
+     * main thread, the picture is rasterized into the image on a worker thread.
+     */
+    struct DirtyPart {
+        QPicture picture;
+        QRect geometry;
+        QRect rect;
+        QRect viewport;
+        QPoint uploadOffset;
+        qreal devicePixelRatio = 1;
+        bool rotated = false;
+        QImage image;
+        QImage rotatedImage;
+    };
+
     explicit SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client);
     ~SceneOpenGLDecorationRenderer() override;
 
@@ -300,8 +387,17 @@ public:
     }
 
 private:
+    void render(bool synchronous);
     void resizeTexture();
+    QVector<DirtyPart> recordDirtyParts(const QRegion &scheduled);
+    void uploadDirtyParts(QVector<DirtyPart> &parts);
+    void finishRasterization(bool wait);
+
     QScopedPointer<GLTexture> m_texture;
+    QFutureWatcher<QVector<DirtyPart>> m_rasterizationWatcher;
+    QRect m_rasterizedRect;
+    bool m_rasterizing = false;
+    QVector<QImage> m_imagePool;
 };
 
 inline bool SceneOpenGL::hasPendingFlush() const
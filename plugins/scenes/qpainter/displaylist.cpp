@@ -0,0 +1,367 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "displaylist.h"
+
+#include <QPaintEngine>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPixmap>
+#include <QtConcurrentMap>
+
+namespace KWin
+{
+
+// Thinner bands aren't worth the overhead of replaying the whole frame for them.
+static const int s_minimumBandHeight = 64;
+
+class DisplayListPaintEngine : public QPaintEngine
+{
+public:
+    explicit DisplayListPaintEngine(QPainterDisplayList *list)
+        : QPaintEngine(AllFeatures)
+        , m_list(list)
+    {
+    }
+
+    bool begin(QPaintDevice *device) override;
+    bool end() override;
+    Type type() const override;
+    void updateState(const QPaintEngineState &state) override;
+
+    void drawRects(const QRectF *rects, int rectCount) override;
+    void drawLines(const QLineF *lines, int lineCount) override;
+    void drawEllipse(const QRectF &rect) override;
+    void drawPath(const QPainterPath &path) override;
+    void drawPoints(const QPointF *points, int pointCount) override;
+    void drawPolygon(const QPointF *points, int pointCount, PolygonDrawMode mode) override;
+    void drawPixmap(const QRectF &rect, const QPixmap &pixmap, const QRectF &sourceRect) override;
+    void drawTiledPixmap(const QRectF &rect, const QPixmap &pixmap, const QPointF &offset) override;
+    void drawTextItem(const QPointF &position, const QTextItem &textItem) override;
+    void drawImage(const QRectF &rect, const QImage &image, const QRectF &sourceRect,
+                   Qt::ImageConversionFlags flags) override;
+
+private:
+    QPainterDisplayList *m_list;
+};
+
+bool DisplayListPaintEngine::begin(QPaintDevice *device)
+{
+    Q_UNUSED(device)
+    // The painter starts out scaled by the device pixel ratio, the replaying painters paint
+    // on images with a ratio of one.
+    const qreal scale = m_list->m_devicePixelRatio;
+    m_list->record([scale](QPainter *painter, const QTransform &base) {
+        painter->setTransform(QTransform::fromScale(scale, scale) * base);
+    });
+    return true;
+}
+
+bool DisplayListPaintEngine::end()
+{
+    return true;
+}
+
+QPaintEngine::Type DisplayListPaintEngine::type() const
+{
+    return User;
+}
+
+void DisplayListPaintEngine::updateState(const QPaintEngineState &state)
+{
+    const DirtyFlags flags = state.state();
+
+    if (flags & DirtyPen) {
+        const QPen pen = state.pen();
+        m_list->record([pen](QPainter *painter, const QTransform &) {
+            painter->setPen(pen);
+        });
+    }
+    if (flags & DirtyBrush) {
+        const QBrush brush = state.brush();
+        m_list->record([brush](QPainter *painter, const QTransform &) {
+            painter->setBrush(brush);
+        });
+    }
+    if (flags & DirtyBrushOrigin) {
+        const QPointF origin = state.brushOrigin();
+        m_list->record([origin](QPainter *painter, const QTransform &) {
+            painter->setBrushOrigin(origin);
+        });
+    }
+    if (flags & DirtyFont) {
+        const QFont font = state.font();
+        m_list->record([font](QPainter *painter, const QTransform &) {
+            painter->setFont(font);
+        });
+    }
+    if (flags & DirtyBackground) {
+        const QBrush background = state.backgroundBrush();
+        m_list->record([background](QPainter *painter, const QTransform &) {
+            painter->setBackground(background);
+        });
+    }
+    if (flags & DirtyBackgroundMode) {
+        const Qt::BGMode mode = state.backgroundMode();
+        m_list->record([mode](QPainter *painter, const QTransform &) {
+            painter->setBackgroundMode(mode);
+        });
+    }
+    // A clip is given in the coordinates of the transform that is current when it is set.
+    if (flags & (DirtyTransform | DirtyClipRegion | DirtyClipPath)) {
+        const QTransform transform = state.transform();
+        m_list->record([transform](QPainter *painter, const QTransform &base) {
+            painter->setTransform(transform * base);
+        });
+    }
+    if (flags & DirtyClipEnabled) {
+        const bool enabled = state.isClipEnabled();
+        m_list->record([enabled](QPainter *painter, const QTransform &) {
+            painter->setClipping(enabled);
+        });
+    }
+    if (flags & DirtyClipRegion) {
+        const QRegion region = state.clipRegion();
+        const Qt::ClipOperation operation = state.clipOperation();
+        m_list->record([region, operation](QPainter *painter, const QTransform &) {
+            painter->setClipRegion(region, operation);
+        });
+    }
+    if (flags & DirtyClipPath) {
+        const QPainterPath path = state.clipPath();
+        const Qt::ClipOperation operation = state.clipOperation();
+        m_list->record([path, operation](QPainter *painter, const QTransform &) {
+            painter->setClipPath(path, operation);
+        });
+    }
+    if (flags & DirtyHints) {
+        const QPainter::RenderHints hints = state.renderHints();
+        m_list->record([hints](QPainter *painter, const QTransform &) {
+            painter->setRenderHints(~hints, false);
+            painter->setRenderHints(hints, true);
+        });
+    }
+    if (flags & DirtyCompositionMode) {
+        const QPainter::CompositionMode mode = state.compositionMode();
+        m_list->record([mode](QPainter *painter, const QTransform &) {
+            painter->setCompositionMode(mode);
+        });
+    }
+    if (flags & DirtyOpacity) {
+        const qreal opacity = state.opacity();
+        m_list->record([opacity](QPainter *painter, const QTransform &) {
+            painter->setOpacity(opacity);
+        });
+    }
+}
+
+void DisplayListPaintEngine::drawRects(const QRectF *rects, int rectCount)
+{
+    const QVector<QRectF> copy(rects, rects + rectCount);
+    m_list->record([copy](QPainter *painter, const QTransform &) {
+        painter->drawRects(copy.constData(), copy.count());
+    });
+}
+
+void DisplayListPaintEngine::drawLines(const QLineF *lines, int lineCount)
+{
+    const QVector<QLineF> copy(lines, lines + lineCount);
+    m_list->record([copy](QPainter *painter, const QTransform &) {
+        painter->drawLines(copy.constData(), copy.count());
+    });
+}
+
+void DisplayListPaintEngine::drawEllipse(const QRectF &rect)
+{
+    m_list->record([rect](QPainter *painter, const QTransform &) {
+        painter->drawEllipse(rect);
+    });
+}
+
+void DisplayListPaintEngine::drawPath(const QPainterPath &path)
+{
+    m_list->record([path](QPainter *painter, const QTransform &) {
+        painter->drawPath(path);
+    });
+}
+
+void DisplayListPaintEngine::drawPoints(const QPointF *points, int pointCount)
+{
+    const QVector<QPointF> copy(points, points + pointCount);
+    m_list->record([copy](QPainter *painter, const QTransform &) {
+        painter->drawPoints(copy.constData(), copy.count());
+    });
+}
+
+void DisplayListPaintEngine::drawPolygon(const QPointF *points, int pointCount, PolygonDrawMode mode)
+{
+    const QPolygonF polygon(QVector<QPointF>(points, points + pointCount));
+    m_list->record([polygon, mode](QPainter *painter, const QTransform &) {
+        switch (mode) {
+        case OddEvenMode:
+            painter->drawPolygon(polygon, Qt::OddEvenFill);
+            break;
+        case WindingMode:
+            painter->drawPolygon(polygon, Qt::WindingFill);
+            break;
+        case ConvexMode:
+            painter->drawConvexPolygon(polygon);
+            break;
+        case PolylineMode:
+            painter->drawPolyline(polygon);
+            break;
+        }
+    });
+}
+
+void DisplayListPaintEngine::drawPixmap(const QRectF &rect, const QPixmap &pixmap, const QRectF &sourceRect)
+{
+    // Pixmaps must not be used outside of the main thread.
+    const QImage image = pixmap.toImage();
+    m_list->record([rect, image, sourceRect](QPainter *painter, const QTransform &) {
+        painter->drawImage(rect, image, sourceRect);
+    });
+}
+
+void DisplayListPaintEngine::drawTiledPixmap(const QRectF &rect, const QPixmap &pixmap, const QPointF &offset)
+{
+    const QImage image = pixmap.toImage();
+    m_list->record([rect, image, offset](QPainter *painter, const QTransform &) {
+        painter->save();
+        painter->setBrushOrigin(rect.topLeft() - offset);
+        painter->fillRect(rect, QBrush(image));
+        painter->restore();
+    });
+}
+
+void DisplayListPaintEngine::drawTextItem(const QPointF &position, const QTextItem &textItem)
+{
+    // The glyphs of the text item only live as long as this call, the text is laid out
+    // again when it's replayed. Otherwise the text would be converted into paths, which
+    // doesn't look like text drawn by the raster engine.
+    const QString text = textItem.text();
+    const QFont font = textItem.font();
+    const Qt::LayoutDirection direction = textItem.renderFlags() & QTextItem::RightToLeft ? Qt::RightToLeft : Qt::LeftToRight;
+    m_list->record([position, text, font, direction](QPainter *painter, const QTransform &) {
+        painter->save();
+        painter->setFont(font);
+        painter->setLayoutDirection(direction);
+        painter->drawText(position, text);
+        painter->restore();
+    });
+}
+
+void DisplayListPaintEngine::drawImage(const QRectF &rect, const QImage &image, const QRectF &sourceRect,
+                                       Qt::ImageConversionFlags flags)
+{
+    m_list->record([rect, image, sourceRect, flags](QPainter *painter, const QTransform &) {
+        painter->drawImage(rect, image, sourceRect, flags);
+    });
+}
+
+QPainterDisplayList::QPainterDisplayList()
+    : m_engine(new DisplayListPaintEngine(this))
+{
+}
+
+QPainterDisplayList::~QPainterDisplayList() = default;
+
+void QPainterDisplayList::reset(const QSize &size, qreal devicePixelRatio)
+{
+    m_size = size;
+    m_devicePixelRatio = devicePixelRatio;
+    m_commands.clear();
+}
+
+void QPainterDisplayList::record(Command &&command)
+{
+    m_commands.append(std::move(command));
+}
+
+void QPainterDisplayList::replay(QPainter *painter, const QTransform &base) const
+{
+    for (const Command &command : m_commands) {
+        command(painter, base);
+    }
+}
+
+void QPainterDisplayList::rasterize(QImage *target, const QRect &area, int bandCount)
+{
+    const QRect bounds = area & target->rect();
+    if (bounds.isEmpty() || m_commands.isEmpty()) {
+        m_commands.clear();
+        return;
+    }
+
+    // Detach before the threads write into the image.
+    uchar *bits = target->bits();
+    const int bytesPerLine = target->bytesPerLine();
+    const int bytesPerPixel = target->depth() / 8;
+    const QImage::Format format = target->format();
+
+    const int bandHeight = qMax(s_minimumBandHeight, (bounds.height() + bandCount - 1) / qMax(1, bandCount));
+    QVector<QRect> bands;
+    for (int y = bounds.top(); y <= bounds.bottom(); y += bandHeight) {
+        bands.append(QRect(bounds.left(), y, bounds.width(), qMin(bandHeight, bounds.bottom() - y + 1)));
+    }
+
+    auto paintBand = [this, bits, bytesPerLine, bytesPerPixel, format](const QRect &band) {
+        // Several painters can't paint on the same QImage, so every band gets an image of
+        // its own that shares the memory of the target.
+        QImage image(bits + band.y() * bytesPerLine + band.x() * bytesPerPixel,
+                     band.width(), band.height(), bytesPerLine, format);
+        QPainter painter(&image);
+        replay(&painter, QTransform::fromTranslate(-band.x(), -band.y()));
+    };
+
+    if (bands.count() == 1) {
+        paintBand(bands.first());
+    } else {
+        QtConcurrent::blockingMap(bands, paintBand);
+    }
+
+    // The commands hold references to the window contents, which may go away after the frame.
+    m_commands.clear();
+}
+
+QPaintEngine *QPainterDisplayList::paintEngine() const
+{
+    return m_engine.data();
+}
+
+int QPainterDisplayList::metric(PaintDeviceMetric metric) const
+{
+    // Like a QImage with the default resolution.
+    switch (metric) {
+    case PdmWidth:
+        return m_size.width();
+    case PdmHeight:
+        return m_size.height();
+    case PdmWidthMM:
+        return qRound(m_size.width() * 25.4 / 96);
+    case PdmHeightMM:
+        return qRound(m_size.height() * 25.4 / 96);
+    case PdmNumColors:
+        return 0;
+    case PdmDepth:
+        return 32;
+    case PdmDpiX:
+    case PdmDpiY:
+    case PdmPhysicalDpiX:
+    case PdmPhysicalDpiY:
+        return 96;
+    case PdmDevicePixelRatio:
+        return int(m_devicePixelRatio);
+    case PdmDevicePixelRatioScaled:
+        return int(m_devicePixelRatio * devicePixelRatioFScale());
+    default:
+        return QPaintDevice::metric(metric);
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,73 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_QPAINTER_DISPLAYLIST_H
+#define KWIN_QPAINTER_DISPLAYLIST_H
+
+#include <QImage>
+#include <QPaintDevice>
+#include <QScopedPointer>
+#include <QTransform>
+#include <QVector>
+
+#include <functional>
+
+namespace KWin
+{
+
+class DisplayListPaintEngine;
+
+/**
+ * The QPainterDisplayList class records everything painted on it, so it can be rasterized
+ * into an image later on.
+ *
+ * The effects and the scene windows paint with a single QPainter on the main thread. With
+ * the display list in between, they only record the frame, and the rasterization is split
+ * into bands of the image that are painted in parallel, each by its own QPainter.
+ */
+class QPainterDisplayList : public QPaintDevice
+{
+public:
+    QPainterDisplayList();
+    ~QPainterDisplayList() override;
+
+    /**
+     * Forgets all recorded commands, the following painting is recorded for an image of
+     * the given @p size and @p devicePixelRatio.
+     */
+    void reset(const QSize &size, qreal devicePixelRatio);
+
+    /**
+     * Replays the recorded commands into the @p area of @p target, split into at most
+     * @p bandCount bands painted by the global thread pool. The recorded commands are
+     * dropped afterwards.
+     */
+    void rasterize(QImage *target, const QRect &area, int bandCount);
+
+    QPaintEngine *paintEngine() const override;
+
+protected:
+    int metric(PaintDeviceMetric metric) const override;
+
+private:
+    typedef std::function<void(QPainter *painter, const QTransform &base)> Command;
+
+    void record(Command &&command);
+    void replay(QPainter *painter, const QTransform &base) const;
+
+    QSize m_size;
+    qreal m_devicePixelRatio = 1.0;
+    QVector<Command> m_commands;
+    QScopedPointer<DisplayListPaintEngine> m_engine;
+
+    friend class DisplayListPaintEngine;
+};
+
+} // namespace KWin
+
+#endif
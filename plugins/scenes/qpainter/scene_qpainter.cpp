@@ -54,6 +54,7 @@ SceneQPainter::SceneQPainter(QPainterBackend *backend, QObject *parent)
     : Scene(parent)
     , m_backend(backend)
     , m_painter(new QPainter())
+    , m_rasterizationThreads(qEnvironmentVariableIntValue("KWIN_QPAINTER_THREADS"))
 {
 }
 
@@ -80,7 +81,7 @@ void SceneQPainter::paintGenericScreen(int mask, const ScreenPaintData &data)
     m_painter->restore();
 }
 
-qint64 SceneQPainter::paint(const QRegion &_damage, const QList<Toplevel *> &toplevels)
+qint64 SceneQPainter::paint(int screenId, const QRegion &_damage, const QList<Toplevel *> &toplevels)
 {
     QElapsedTimer renderTimer;
     renderTimer.start();
@@ -98,12 +99,15 @@ qint64 SceneQPainter::paint(const QRegion &_damage, const QList<Toplevel *> &top
         }
         QRegion overallUpdate;
         for (int i = 0; i < screens()->count(); ++i) {
+            if (screenId != -1 && i != screenId) {
+                continue;
+            }
             const QRect geometry = screens()->geometry(i);
             QImage *buffer = m_backend->bufferForScreen(i);
             if (!buffer || buffer->isNull()) {
                 continue;
             }
-            m_painter->begin(buffer);
+            beginPaint(buffer);
             m_painter->save();
             m_painter->setWindow(geometry);
 
@@ -112,13 +116,14 @@ qint64 SceneQPainter::paint(const QRegion &_damage, const QList<Toplevel *> &top
             overallUpdate = overallUpdate.united(updateRegion);
             paintCursor();
 
+            const QRect updateRect = m_painter->deviceTransform().mapRect(updateRegion.boundingRect());
             m_painter->restore();
-            m_painter->end();
+            endPaint(buffer, updateRect.adjusted(-1, -1, 1, 1));
         }
         m_backend->showOverlay();
         m_backend->present(mask, overallUpdate);
     } else {
-        m_painter->begin(m_backend->buffer());
+        beginPaint(m_backend->buffer());
         m_painter->setClipping(true);
         m_painter->setClipRegion(damage);
         if (m_backend->needsFullRepaint()) {
@@ -131,7 +136,7 @@ qint64 SceneQPainter::paint(const QRegion &_damage, const QList<Toplevel *> &top
         paintCursor();
         m_backend->showOverlay();
 
-        m_painter->end();
+        endPaint(m_backend->buffer(), updateRegion.boundingRect());
         m_backend->present(mask, updateRegion);
     }
 
@@ -141,6 +146,24 @@ qint64 SceneQPainter::paint(const QRegion &_damage, const QList<Toplevel *> &top
     return renderTimer.nsecsElapsed();
 }
 
+void SceneQPainter::beginPaint(QImage *buffer)
+{
+    if (m_rasterizationThreads > 1) {
+        m_displayList.reset(buffer->size(), buffer->devicePixelRatioF());
+        m_painter->begin(&m_displayList);
+    } else {
+        m_painter->begin(buffer);
+    }
+}
+
+void SceneQPainter::endPaint(QImage *buffer, const QRect &area)
+{
+    m_painter->end();
+    if (m_rasterizationThreads > 1) {
+        m_displayList.rasterize(buffer, area, m_rasterizationThreads);
+    }
+}
+
 void SceneQPainter::paintBackground(const QRegion &region)
 {
     m_painter->setBrush(Qt::black);
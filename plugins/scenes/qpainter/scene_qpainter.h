@@ -10,6 +10,7 @@
 #define KWIN_SCENE_QPAINTER_H
 
 #include "scene.h"
+#include "displaylist.h"
 #include <platformsupport/scenes/qpainter/backend.h>
 #include "shadow.h"
 
@@ -25,7 +26,7 @@ public:
     ~SceneQPainter() override;
     bool usesOverlayWindow() const override;
     OverlayWindow* overlayWindow() const override;
-    qint64 paint(const QRegion &damage, const QList<Toplevel *> &windows) override;
+    qint64 paint(int screenId, const QRegion &damage, const QList<Toplevel *> &windows) override;
     void paintGenericScreen(int mask, const ScreenPaintData &data) override;
     CompositingType compositingType() const override;
     bool initFailed() const override;
@@ -55,8 +56,16 @@ protected:
 
 private:
     explicit SceneQPainter(QPainterBackend *backend, QObject *parent = nullptr);
+    void beginPaint(QImage *buffer);
+    void endPaint(QImage *buffer, const QRect &area);
     QScopedPointer<QPainterBackend> m_backend;
     QScopedPointer<QPainter> m_painter;
+    /**
+     * With more than one thread, the frame is recorded into m_displayList and rasterized
+     * in bands by that many threads. Set with the KWIN_QPAINTER_THREADS environment variable.
+     */
+    QPainterDisplayList m_displayList;
+    int m_rasterizationThreads;
     class Window;
 };
 
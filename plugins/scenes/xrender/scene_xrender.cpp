@@ -238,8 +238,11 @@ bool SceneXrender::initFailed() const
 }
 
 // the entry point for painting
-qint64 SceneXrender::paint(const QRegion &damage, const QList<Toplevel *> &toplevels)
+qint64 SceneXrender::paint(int screenId, const QRegion &damage, const QList<Toplevel *> &toplevels)
 {
+    // The XRender scene always paints all screens at once.
+    Q_UNUSED(screenId)
+
     QElapsedTimer renderTimer;
     renderTimer.start();
 
@@ -211,7 +211,7 @@ public:
         if (s_counter == 0) {
             if (!s_scheduledPositions.isEmpty()) {
                 const auto pos = s_scheduledPositions.takeFirst();
-                m_pointer->processMotion(pos.pos, pos.delta, pos.deltaNonAccelerated, pos.time, pos.timeUsec, nullptr);
+                m_pointer->processMotion(pos.pos, pos.delta, pos.deltaNonAccelerated, pos.time, pos.timeUsec, nullptr, pos.samples);
             }
         }
     }
@@ -220,8 +220,9 @@ public:
         return s_counter > 0;
     }
 
-    static void schedulePosition(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec) {
-        s_scheduledPositions.append({pos, delta, deltaNonAccelerated, time, timeUsec});
+    static void schedulePosition(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec,
+                                 const QVector<PointerMotionSample> &samples) {
+        s_scheduledPositions.append({pos, delta, deltaNonAccelerated, time, timeUsec, samples});
     }
 
 private:
@@ -232,6 +233,7 @@ private:
         QSizeF deltaNonAccelerated;
         quint32 time;
         quint64 timeUsec;
+        QVector<PointerMotionSample> samples;
     };
     static QVector<ScheduledPosition> s_scheduledPositions;
 
@@ -241,13 +243,14 @@ private:
 int PositionUpdateBlocker::s_counter = 0;
 QVector<PositionUpdateBlocker::ScheduledPosition> PositionUpdateBlocker::s_scheduledPositions;
 
-void PointerInputRedirection::processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device)
+void PointerInputRedirection::processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec,
+                                            LibInput::Device *device, const QVector<PointerMotionSample> &samples)
 {
     if (!inited()) {
         return;
     }
     if (PositionUpdateBlocker::isPositionBlocked()) {
-        PositionUpdateBlocker::schedulePosition(pos, delta, deltaNonAccelerated, time, timeUsec);
+        PositionUpdateBlocker::schedulePosition(pos, delta, deltaNonAccelerated, time, timeUsec, samples);
         return;
     }
 
@@ -257,6 +260,7 @@ void PointerInputRedirection::processMotion(const QPointF &pos, const QSizeF &de
                      input()->keyboardModifiers(), time,
                      delta, deltaNonAccelerated, timeUsec, device);
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
+    event.setMotionSamples(samples);
 
     update();
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
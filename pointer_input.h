@@ -88,8 +88,12 @@ public:
     void processMotion(const QPointF &pos, uint32_t time, LibInput::Device *device = nullptr);
     /**
      * @internal
+     *
+     * @p samples are the individual relative motions if several motion events got merged
+     * into this one, they are forwarded to clients using relative pointer motion.
      */
-    void processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device);
+    void processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec,
+                       LibInput::Device *device, const QVector<PointerMotionSample> &samples = {});
     /**
      * @internal
      */
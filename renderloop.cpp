@@ -0,0 +1,169 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "renderloop.h"
+#include "abstract_output.h"
+#include "screens.h"
+
+#include <algorithm>
+
+#include <time.h>
+
+namespace KWin
+{
+
+RenderLoop::RenderLoop(AbstractOutput *output, QObject *parent)
+    : QObject(parent)
+    , m_output(output)
+{
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_frameTimer, &QTimer::timeout, this, [this]() {
+        emit frameRequested(this);
+    });
+}
+
+RenderLoop::~RenderLoop()
+{
+}
+
+AbstractOutput *RenderLoop::output() const
+{
+    return m_output;
+}
+
+QRect RenderLoop::geometry() const
+{
+    if (m_output) {
+        return m_output->geometry();
+    }
+    return screens()->geometry();
+}
+
+bool RenderLoop::addRepaint(const QRegion &region)
+{
+    // The render loop that drives all outputs at once doesn't clip the repaints, the
+    // scene takes care of restricting painting to the visible screen area.
+    const QRegion damage = m_output ? region.intersected(m_output->geometry()) : region;
+    if (damage.isEmpty()) {
+        return false;
+    }
+    m_repaints += damage;
+    return true;
+}
+
+QRegion RenderLoop::repaints() const
+{
+    return m_repaints;
+}
+
+void RenderLoop::resetRepaints()
+{
+    m_repaints = QRegion();
+}
+
+void RenderLoop::beginFrame()
+{
+    Q_ASSERT(!m_framePending);
+    m_framePending = true;
+    m_statistics.swapScheduled();
+}
+
+void RenderLoop::endFrame(qint64 presentationTimestamp)
+{
+    Q_ASSERT(m_framePending);
+    m_framePending = false;
+
+    // Don't trust timestamps from the future, e.g. if the driver uses a different clock.
+    const qint64 now = currentTime();
+    if (presentationTimestamp <= 0 || presentationTimestamp > now) {
+        presentationTimestamp = now;
+    }
+    m_lastPresentationTimestamp = presentationTimestamp;
+    m_statistics.framePresented(presentationTimestamp);
+
+    emit frameCompleted(this);
+}
+
+bool RenderLoop::isFramePending() const
+{
+    return m_framePending;
+}
+
+bool RenderLoop::composeAtSwapCompletion() const
+{
+    return m_composeAtSwapCompletion;
+}
+
+void RenderLoop::setComposeAtSwapCompletion(bool compose)
+{
+    m_composeAtSwapCompletion = compose;
+}
+
+qint64 RenderLoop::timeSinceLastVBlank() const
+{
+    return m_timeSinceLastVBlank;
+}
+
+void RenderLoop::setTimeSinceLastVBlank(qint64 time)
+{
+    m_timeSinceLastVBlank = time;
+}
+
+void RenderLoop::addRenderTime(qint64 renderTime)
+{
+    if (renderTime < 0) {
+        return;
+    }
+    m_renderTimes[m_renderTimeIndex] = renderTime;
+    m_renderTimeIndex = (m_renderTimeIndex + 1) % m_renderTimes.size();
+    m_renderTimeCount = qMin<int>(m_renderTimeCount + 1, m_renderTimes.size());
+}
+
+qint64 RenderLoop::predictedRenderTime() const
+{
+    if (!m_renderTimeCount) {
+        return -1;
+    }
+    return *std::max_element(m_renderTimes.begin(), m_renderTimes.begin() + m_renderTimeCount);
+}
+
+qint64 RenderLoop::lastPresentationTimestamp() const
+{
+    return m_lastPresentationTimestamp;
+}
+
+qint64 RenderLoop::currentTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void RenderLoop::scheduleFrame(int msec)
+{
+    m_frameTimer.start(msec);
+    m_statistics.setScheduledTime(currentTime() + qint64(msec) * 1000000);
+}
+
+bool RenderLoop::isFrameScheduled() const
+{
+    return m_frameTimer.isActive();
+}
+
+void RenderLoop::cancelFrame()
+{
+    m_frameTimer.stop();
+}
+
+FrameStatistics *RenderLoop::statistics()
+{
+    return &m_statistics;
+}
+
+} // namespace KWin
@@ -0,0 +1,164 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_RENDERLOOP_H
+#define KWIN_RENDERLOOP_H
+
+#include "framestatistics.h"
+
+#include <kwinglobals.h>
+
+#include <QObject>
+#include <QRegion>
+#include <QTimer>
+
+#include <array>
+
+namespace KWin
+{
+
+class AbstractOutput;
+
+/**
+ * The RenderLoop class keeps the frame scheduling state of a single output.
+ *
+ * Every output has its own render loop, which holds the region that needs to be repainted,
+ * the timer that triggers the next frame and whether a buffer swap (page flip) is still
+ * pending. This allows outputs with different refresh rates to be driven independently
+ * from each other.
+ *
+ * If the platform cannot present outputs individually, the Compositor drives all outputs
+ * with one RenderLoop that has no output.
+ */
+class KWIN_EXPORT RenderLoop : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenderLoop(AbstractOutput *output, QObject *parent = nullptr);
+    ~RenderLoop() override;
+
+    /**
+     * Returns the output driven by this render loop, or @c null if the render loop
+     * drives all outputs at once.
+     */
+    AbstractOutput *output() const;
+
+    /**
+     * Returns the geometry of the output driven by this render loop, in global
+     * compositor coordinates.
+     */
+    QRect geometry() const;
+
+    /**
+     * Adds the part of @p region that belongs to this render loop to the pending repaints.
+     * Returns @c true if the pending repaints changed.
+     */
+    bool addRepaint(const QRegion &region);
+    QRegion repaints() const;
+    void resetRepaints();
+
+    /**
+     * Notifies the render loop that a buffer swap (or page flip) has been scheduled.
+     * Rendering of the next frame will be deferred until endFrame() is called.
+     */
+    void beginFrame();
+    /**
+     * Notifies the render loop that the pending buffer swap has completed.
+     *
+     * @p presentationTimestamp is the time at which the frame has been shown on the screen,
+     * in nanoseconds on the CLOCK_MONOTONIC clock. If it's @c 0, the current time is used.
+     */
+    void endFrame(qint64 presentationTimestamp = 0);
+    /**
+     * Returns @c true if a buffer swap is still pending.
+     */
+    bool isFramePending() const;
+
+    /**
+     * Whether a new frame should be composited as soon as the pending buffer swap completes.
+     */
+    bool composeAtSwapCompletion() const;
+    void setComposeAtSwapCompletion(bool compose);
+
+    /**
+     * The time spent in the last frame since the last vblank, in nanoseconds.
+     */
+    qint64 timeSinceLastVBlank() const;
+    void setTimeSinceLastVBlank(qint64 time);
+
+    /**
+     * Records the time it took to render a frame, in nanoseconds.
+     */
+    void addRenderTime(qint64 renderTime);
+    /**
+     * Returns the expected time to render the next frame in nanoseconds, or @c -1 if no
+     * render times have been recorded yet.
+     *
+     * The prediction is the longest render time of the recent frames, so a single slow
+     * frame makes the compositor start earlier for a while rather than miss a vblank.
+     */
+    qint64 predictedRenderTime() const;
+
+    /**
+     * Returns the time at which the last frame has been presented, in nanoseconds on the
+     * CLOCK_MONOTONIC clock, or @c 0 if no frame has been presented yet.
+     */
+    qint64 lastPresentationTimestamp() const;
+
+    /**
+     * Returns the current time in nanoseconds on the CLOCK_MONOTONIC clock.
+     */
+    static qint64 currentTime();
+
+    /**
+     * Starts the frame timer, frameRequested() will be emitted in @p msec milliseconds.
+     */
+    void scheduleFrame(int msec);
+    /**
+     * Returns @c true if frameRequested() is about to be emitted.
+     */
+    bool isFrameScheduled() const;
+    /**
+     * Cancels a scheduled frame.
+     */
+    void cancelFrame();
+
+    /**
+     * Returns the timing statistics of the recent frames.
+     */
+    FrameStatistics *statistics();
+
+Q_SIGNALS:
+    /**
+     * This signal is emitted when the frame timer expires and the next frame
+     * should be composited.
+     */
+    void frameRequested(RenderLoop *renderLoop);
+    /**
+     * This signal is emitted when the pending buffer swap has completed.
+     */
+    void frameCompleted(RenderLoop *renderLoop);
+
+private:
+    AbstractOutput *m_output;
+    QTimer m_frameTimer;
+    QRegion m_repaints;
+    FrameStatistics m_statistics;
+    qint64 m_timeSinceLastVBlank = 0;
+    qint64 m_lastPresentationTimestamp = 0;
+    std::array<qint64, 16> m_renderTimes;
+    int m_renderTimeIndex = 0;
+    int m_renderTimeCount = 0;
+    bool m_framePending = false;
+    bool m_composeAtSwapCompletion = false;
+};
+
+} // namespace KWin
+
+#endif
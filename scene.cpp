@@ -64,6 +64,7 @@
 #include "deleted.h"
 #include "effects.h"
 #include "overlaywindow.h"
+#include "renderloop.h"
 #include "screens.h"
 #include "shadow.h"
 #include "subsurfacemonitor.h"
@@ -111,9 +112,15 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     pdata.mask = *mask;
     pdata.paint = region;
 
+    const qint64 prePaintStartTime = RenderLoop::currentTime();
+    if (!m_paintTimes.prePaintStartTime) {
+        m_paintTimes.prePaintStartTime = prePaintStartTime;
+    }
     effects->prePaintScreen(pdata, time_diff);
     *mask = pdata.mask;
     region = pdata.paint;
+    const qint64 paintStartTime = RenderLoop::currentTime();
+    m_paintTimes.prePaint += paintStartTime - prePaintStartTime;
 
     if (*mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
         // Region painting is not possible with transformations,
@@ -143,6 +150,8 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     }
 
     effects->postPaintScreen();
+    static_cast<EffectsHandlerImpl*>(effects)->finishPaint();
+    m_paintTimes.paint += RenderLoop::currentTime() - paintStartTime;
 
     // make sure not to go outside of the screen area
     *updateRegion = damaged_region;
@@ -173,6 +182,18 @@ void Scene::updateTimeDiff()
         time_diff = 1;
 }
 
+bool Scene::hasPerOutputRenderLoops() const
+{
+    return false;
+}
+
+Scene::PaintTimes Scene::takePaintTimes()
+{
+    const PaintTimes times = m_paintTimes;
+    m_paintTimes = PaintTimes();
+    return times;
+}
+
 // Painting pass is optimized away.
 void Scene::idle()
 {
@@ -269,24 +290,13 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         // the next frame within Effects::prePaintWindow.
         toplevel->resetRepaints();
 
-        // Clip out the decoration for opaque windows; the decoration is drawn in the second pass
         opaqueFullscreen = false; // TODO: do we care about unmanged windows here (maybe input windows?)
         if (window->isOpaque()) {
-            AbstractClient *client = dynamic_cast<AbstractClient *>(toplevel);
-            if (client) {
+            if (AbstractClient *client = dynamic_cast<AbstractClient *>(toplevel)) {
                 opaqueFullscreen = client->isFullScreen();
             }
-            if (!(client && client->decorationHasAlpha())) {
-                data.clip = window->decorationShape().translated(window->pos());
-            }
-            data.clip |= window->clientShape().translated(window->pos() + window->bufferOffset());
-        } else if (toplevel->hasAlpha() && toplevel->opacity() == 1.0) {
-            const QRegion clientShape = window->clientShape().translated(window->pos() + window->bufferOffset());
-            const QRegion opaqueShape = toplevel->opaqueRegion().translated(window->pos() + toplevel->clientPos());
-            data.clip = clientShape & opaqueShape;
-        } else {
-            data.clip = QRegion();
         }
+        data.clip = window->opaqueShape().translated(window->pos());
         data.quads = window->buildQuads();
         // preparation step
         effects->prePaintWindow(effectWindow(window), data, time_diff);
@@ -320,6 +330,10 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
     QRegion allclips, upperTranslucentDamage;
     upperTranslucentDamage = repaint_region;
 
+    // The occlusion mask is a subset of allclips. It answers whether a region is hidden
+    // completely without going through allclips, which gets expensive with every window.
+    m_occlusionMask.reset(displayRegion.boundingRect());
+
     // This is the occlusion culling pass
     for (int i = phase2data.count() - 1; i >= 0; --i) {
         Phase2Data *data = &phase2data[i];
@@ -332,13 +346,21 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
 
         // subtract the parts which will possibly been drawn as part of
         // a higher opaque window
-        data->region -= allclips;
+        if (m_occlusionMask.covers(data->region)) {
+            data->region = QRegion();
+        } else {
+            data->region -= allclips;
+        }
 
         // Here we rely on WindowPrePaintData::setTranslucent() to remove
         // the clip if needed.
         if (!data->clip.isEmpty() && !(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
-            // clip away the opaque regions for all windows below this one
-            allclips |= data->clip;
+            // clip away the opaque regions for all windows below this one,
+            // a clip inside of the mask is already a part of allclips
+            if (!m_occlusionMask.covers(data->clip)) {
+                allclips |= data->clip;
+                m_occlusionMask.add(data->clip);
+            }
             // extend the translucent damage for windows below this by remaining (translucent) regions
             if (!fullRepaint) {
                 upperTranslucentDamage |= data->region - data->clip;
@@ -401,21 +423,22 @@ void Scene::addToplevel(Toplevel *c)
         connect(monitor, &SubSurfaceMonitor::subSurfaceUnmapped, w, &Window::discardPixmap);
         connect(monitor, &SubSurfaceMonitor::subSurfaceBufferSizeChanged, w, &Window::discardPixmap);
 
-        connect(monitor, &SubSurfaceMonitor::subSurfaceAdded, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceRemoved, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceMoved, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceResized, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceMapped, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceUnmapped, w, &Window::discardQuads);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceSurfaceToBufferMatrixChanged, w, &Window::discardQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceAdded, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceRemoved, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceMoved, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceResized, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceMapped, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceUnmapped, w, &Window::discardContentsQuads);
+        connect(monitor, &SubSurfaceMonitor::subSurfaceSurfaceToBufferMatrixChanged, w, &Window::discardContentsQuads);
 
         connect(c->surface(), &KWaylandServer::SurfaceInterface::bufferSizeChanged, w, &Window::discardPixmap);
-        connect(c->surface(), &KWaylandServer::SurfaceInterface::surfaceToBufferMatrixChanged, w, &Window::discardQuads);
+        connect(c->surface(), &KWaylandServer::SurfaceInterface::surfaceToBufferMatrixChanged, w, &Window::discardContentsQuads);
     }
 
     connect(c, &Toplevel::screenScaleChanged, w, &Window::discardQuads);
-    connect(c, &Toplevel::shadowChanged, w, &Window::discardQuads);
-    connect(c, &Toplevel::geometryShapeChanged, w, &Window::discardShape);
+    // The shadow quads aren't retained, they are appended when the quad list is assembled.
+    connect(c, &Toplevel::shadowChanged, w, &Window::discardCachedQuads);
+    connect(c, &Toplevel::geometryShapeChanged, w, &Window::handleGeometryShapeChanged);
 
     c->effectWindow()->setSceneWindow(w);
     c->updateShadow();
@@ -694,6 +717,8 @@ Scene::Window::Window(Toplevel *client, QObject *parent)
     , m_referencePixmapCounter(0)
     , disable_painting(0)
     , cached_quad_list(nullptr)
+    , m_localBufferGeometry(client->bufferGeometry().translated(-client->pos()))
+    , m_localClientGeometry(client->clientPos(), client->clientSize())
 {
 }
 
@@ -749,9 +774,30 @@ void Scene::Window::discardShape()
     // it is created on-demand and cached, simply
     // reset the flag
     m_bufferShapeIsValid = false;
+    m_opaqueShapeState = -1;
     discardQuads();
 }
 
+void Scene::Window::handleGeometryShapeChanged(Toplevel *toplevel, const QRect &oldFrameGeometry)
+{
+    const QRect frameGeometry = toplevel->frameGeometry();
+    const QRect localBufferGeometry = toplevel->bufferGeometry().translated(-frameGeometry.topLeft());
+    const QRect localClientGeometry(toplevel->clientPos(), toplevel->clientSize());
+
+    // The shape and the quads are in window-local coordinates, they survive a move. A shape
+    // change without a geometry change is announced with the current frame geometry.
+    const bool moved = oldFrameGeometry != frameGeometry
+            && oldFrameGeometry.size() == frameGeometry.size()
+            && localBufferGeometry == m_localBufferGeometry
+            && localClientGeometry == m_localClientGeometry;
+
+    m_localBufferGeometry = localBufferGeometry;
+    m_localClientGeometry = localClientGeometry;
+    if (!moved) {
+        discardShape();
+    }
+}
+
 QRegion Scene::Window::bufferShape() const
 {
     if (m_bufferShapeIsValid) {
@@ -804,6 +850,45 @@ QRegion Scene::Window::decorationShape() const
     return QRegion(toplevel->rect()) - toplevel->transparentRect();
 }
 
+QRegion Scene::Window::opaqueShape() const
+{
+    // The opaque shape depends on a few properties that change without notifying the scene,
+    // e.g. the opaqueness of the decoration, so compare them against the cached state.
+    enum {
+        WindowOpaque = 1 << 0,
+        ClientOpaqueRegion = 1 << 1,
+        DecorationHasAlpha = 1 << 2,
+    };
+    const AbstractClient *client = dynamic_cast<AbstractClient *>(toplevel);
+    int state = 0;
+    if (isOpaque()) {
+        state |= WindowOpaque;
+    } else if (toplevel->hasAlpha() && toplevel->opacity() == 1.0) {
+        state |= ClientOpaqueRegion;
+    }
+    if (client && client->decorationHasAlpha()) {
+        state |= DecorationHasAlpha;
+    }
+    if (state == m_opaqueShapeState && m_opaqueShapeSource == toplevel->opaqueRegion()) {
+        return m_opaqueShape;
+    }
+
+    m_opaqueShape = QRegion();
+    if (state & WindowOpaque) {
+        // Clip out the decoration for opaque windows; the decoration is drawn in the second pass
+        if (!(state & DecorationHasAlpha)) {
+            m_opaqueShape = decorationShape();
+        }
+        m_opaqueShape |= clientShape().translated(bufferOffset());
+    } else if (state & ClientOpaqueRegion) {
+        m_opaqueShape = clientShape().translated(bufferOffset())
+                & toplevel->opaqueRegion().translated(toplevel->clientPos());
+    }
+    m_opaqueShapeSource = toplevel->opaqueRegion();
+    m_opaqueShapeState = state;
+    return m_opaqueShape;
+}
+
 QPoint Scene::Window::bufferOffset() const
 {
     const QRect bufferGeometry = toplevel->bufferGeometry();
@@ -880,35 +965,46 @@ WindowQuadList Scene::Window::buildQuads(bool force) const
     if (cached_quad_list != nullptr && !force)
         return *cached_quad_list;
 
-    WindowQuadList ret;
-
-    if (!isShaded()) {
-        ret += makeContentsQuads();
+    // The contents and the decoration quads are retained separately, so a change to the
+    // sub-surface tree doesn't rebuild the decoration quads and vice versa.
+    if (force) {
+        m_contentsQuads.reset();
+        m_decorationQuads.reset();
     }
+    if (m_contentsQuads.isNull()) {
+        m_contentsQuads.reset(new WindowQuadList());
+        if (!isShaded()) {
+            *m_contentsQuads = makeContentsQuads();
+        }
+    }
+    if (m_decorationQuads.isNull()) {
+        m_decorationQuads.reset(new WindowQuadList());
+        if (!toplevel->frameMargins().isNull()) {
+            AbstractClient *client = dynamic_cast<AbstractClient*>(toplevel);
+            QRegion center = toplevel->transparentRect();
+            const QRegion decoration = decorationShape();
+            qreal decorationScale = 1.0;
 
-    if (!toplevel->frameMargins().isNull()) {
-        AbstractClient *client = dynamic_cast<AbstractClient*>(toplevel);
-        QRegion center = toplevel->transparentRect();
-        const QRegion decoration = decorationShape();
-        qreal decorationScale = 1.0;
-
-        QRect rects[4];
-        bool isShadedClient = false;
+            QRect rects[4];
+            bool isShadedClient = false;
 
-        if (client) {
-            client->layoutDecorationRects(rects[0], rects[1], rects[2], rects[3]);
-            decorationScale = client->screenScale();
-            isShadedClient = client->isShade() || center.isEmpty();
-        }
+            if (client) {
+                client->layoutDecorationRects(rects[0], rects[1], rects[2], rects[3]);
+                decorationScale = client->screenScale();
+                isShadedClient = client->isShade() || center.isEmpty();
+            }
 
-        if (isShadedClient) {
-            const QRect bounding = rects[0] | rects[1] | rects[2] | rects[3];
-            ret += makeDecorationQuads(rects, bounding, decorationScale);
-        } else {
-            ret += makeDecorationQuads(rects, decoration, decorationScale);
+            if (isShadedClient) {
+                const QRect bounding = rects[0] | rects[1] | rects[2] | rects[3];
+                *m_decorationQuads = makeDecorationQuads(rects, bounding, decorationScale);
+            } else {
+                *m_decorationQuads = makeDecorationQuads(rects, decoration, decorationScale);
+            }
         }
-
     }
+
+    WindowQuadList ret = *m_contentsQuads;
+    ret += *m_decorationQuads;
     if (m_shadow && toplevel->wantsShadowToBeRendered()) {
         ret << m_shadow->shadowQuads();
     }
@@ -1048,6 +1144,19 @@ WindowQuadList Scene::Window::makeContentsQuads() const
 }
 
 void Scene::Window::discardQuads()
+{
+    cached_quad_list.reset();
+    m_contentsQuads.reset();
+    m_decorationQuads.reset();
+}
+
+void Scene::Window::discardContentsQuads()
+{
+    cached_quad_list.reset();
+    m_contentsQuads.reset();
+}
+
+void Scene::Window::discardCachedQuads()
 {
     cached_quad_list.reset();
 }
@@ -1115,7 +1224,7 @@ void WindowPixmap::create()
         update();
         if (isRoot() && isValid()) {
             m_window->unreferencePreviousPixmap();
-            m_window->discardQuads();
+            m_window->discardContentsQuads();
         }
         return;
     }
@@ -1146,7 +1255,7 @@ void WindowPixmap::create()
     m_pixmapSize = bufferGeometry.size();
     m_contentsRect = QRect(toplevel()->clientPos(), toplevel()->clientSize());
     m_window->unreferencePreviousPixmap();
-    m_window->discardQuads();
+    m_window->discardContentsQuads();
 }
 
 void WindowPixmap::update()
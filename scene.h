@@ -13,6 +13,7 @@
 #include "toplevel.h"
 #include "utils.h"
 #include "kwineffects.h"
+#include "occlusionmask.h"
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
@@ -62,9 +63,36 @@ public:
 
     // Repaints the given screen areas, windows provides the stacking order.
     // The entry point for the main part of the painting pass.
+    // If screenId is -1, all screens are painted, otherwise only the given one.
     // returns the time since the last vblank signal - if there's one
     // ie. "what of this frame is lost to painting"
-    virtual qint64 paint(const QRegion &damage, const QList<Toplevel *> &windows) = 0;
+    // Scenes that can measure the GPU time include it, the Compositor uses the
+    // value to predict when painting of the next frame has to start.
+    virtual qint64 paint(int screenId, const QRegion &damage, const QList<Toplevel *> &windows) = 0;
+
+    /**
+     * Whether the scene presents every output on its own, so each output can be driven
+     * by its own RenderLoop.
+     *
+     * Default implementation returns @c false.
+     */
+    virtual bool hasPerOutputRenderLoops() const;
+
+    /**
+     * The time spent in the pre-paint and paint passes of the last paint() call, and the
+     * GPU time of the previously painted frame if the scene can measure it. All values
+     * are in nanoseconds.
+     */
+    struct PaintTimes {
+        qint64 prePaintStartTime = 0;
+        qint64 prePaint = 0;
+        qint64 paint = 0;
+        qint64 previousGpu = -1;
+    };
+    /**
+     * Returns the paint times collected since the last call and resets them.
+     */
+    PaintTimes takePaintTimes();
 
     /**
      * Adds the Toplevel to the Scene.
@@ -253,12 +281,15 @@ protected:
     // time since last repaint
     int time_diff;
     QElapsedTimer last_time;
+    PaintTimes m_paintTimes;
 private:
     void paintWindowThumbnails(Scene::Window *w, const QRegion &region, qreal opacity, qreal brightness, qreal saturation);
     void paintDesktopThumbnails(Scene::Window *w);
     QHash< Toplevel*, Window* > m_windows;
     // windows in their stacking order
     QVector< Window* > stacking_order;
+    // the tiles known to be covered by opaque windows during the occlusion culling pass
+    OcclusionMask m_occlusionMask;
 };
 
 /**
@@ -331,8 +362,17 @@ public:
     QRegion bufferShape() const;
     QRegion clientShape() const;
     QRegion decorationShape() const;
+    /**
+     * Returns the part of the window that is known to be opaque, relative to pos(). Windows
+     * below the returned region need not be painted.
+     *
+     * The region is cached across frames and only recomputed when the window shape changes or
+     * the window becomes (semi-)transparent.
+     */
+    QRegion opaqueShape() const;
     QPoint bufferOffset() const;
     void discardShape();
+    void handleGeometryShapeChanged(Toplevel *toplevel, const QRect &oldFrameGeometry);
     void updateToplevel(Toplevel* c);
     // creates initial quad list for the window
     virtual WindowQuadList buildQuads(bool force = false) const;
@@ -342,6 +382,14 @@ public:
     void referencePreviousPixmap();
     void unreferencePreviousPixmap();
     void discardQuads();
+    /**
+     * Discards the cached quads of the window contents, the decoration quads are kept.
+     */
+    void discardContentsQuads();
+    /**
+     * Discards the final quad list, the contents and the decoration quads are kept.
+     */
+    void discardCachedQuads();
     void preprocess();
 
     virtual QSharedPointer<GLTexture> windowTexture() {
@@ -385,7 +433,14 @@ private:
     int disable_painting;
     mutable QRegion m_bufferShape;
     mutable bool m_bufferShapeIsValid = false;
+    mutable QRegion m_opaqueShape;
+    mutable QRegion m_opaqueShapeSource;
+    mutable int m_opaqueShapeState = -1;
     mutable QScopedPointer<WindowQuadList> cached_quad_list;
+    mutable QScopedPointer<WindowQuadList> m_contentsQuads;
+    mutable QScopedPointer<WindowQuadList> m_decorationQuads;
+    QRect m_localBufferGeometry;
+    QRect m_localClientGeometry;
     Q_DISABLE_COPY(Window)
 };
 
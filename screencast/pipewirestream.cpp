@@ -7,6 +7,7 @@
 */
 
 #include "pipewirestream.h"
+#include "composite.h"
 #include "cursor.h"
 #include "dmabuftexture.h"
 #include "kwingltexture.h"
@@ -15,6 +16,7 @@
 #include "main.h"
 #include "pipewirecore.h"
 #include "platform.h"
+#include "scene.h"
 #include "utils.h"
 
 #include <KLocalizedString>
@@ -63,10 +65,17 @@ void PipeWireStream::onStreamStateChanged(void *data, pw_stream_state old, pw_st
 #define CURSOR_META_SIZE(w,h)	(sizeof(struct spa_meta_cursor) + \
 				 sizeof(struct spa_meta_bitmap) + w * h * CURSOR_BPP)
 
+// The maximum number of damage rectangles that are sent along with a frame. If the damage
+// consists of more rectangles, only its bounding rectangle is sent.
+static const int videoDamageRegionCount = 16;
+// Frames whose pixels are still being read back, the oldest one is waited for beyond this.
+static const int s_maxPendingFrames = 2;
+
 void PipeWireStream::newStreamParams()
 {
     const int bpp = videoFormat.format == SPA_VIDEO_FORMAT_RGB || videoFormat.format == SPA_VIDEO_FORMAT_BGR ? 3 : 4;
     auto stride = SPA_ROUND_UP_N (m_resolution.width() * bpp, 4);
+    const int dataType = m_useDmaBuf ? (1 << SPA_DATA_DmaBuf) : (1 << SPA_DATA_MemFd);
 
     uint8_t paramsBuffer[1024];
     spa_pod_builder pod_builder = SPA_POD_BUILDER_INIT (paramsBuffer, sizeof (paramsBuffer));
@@ -81,13 +90,20 @@ void PipeWireStream::newStreamParams()
                                               SPA_PARAM_BUFFERS_blocks, SPA_POD_Int (1),
                                               SPA_PARAM_BUFFERS_stride, SPA_POD_Int(stride),
                                               SPA_PARAM_BUFFERS_size, SPA_POD_Int(stride * m_resolution.height()),
-                                              SPA_PARAM_BUFFERS_align, SPA_POD_Int(16)),
+                                              SPA_PARAM_BUFFERS_align, SPA_POD_Int(16),
+                                              SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(dataType)),
         (spa_pod*) spa_pod_builder_add_object (&pod_builder,
                                                SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
                                                SPA_PARAM_META_type, SPA_POD_Id (SPA_META_Cursor),
-                                               SPA_PARAM_META_size, SPA_POD_Int (CURSOR_META_SIZE (cursorSize, cursorSize)))
+                                               SPA_PARAM_META_size, SPA_POD_Int (CURSOR_META_SIZE (cursorSize, cursorSize))),
+        (spa_pod*) spa_pod_builder_add_object (&pod_builder,
+                                               SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+                                               SPA_PARAM_META_type, SPA_POD_Id (SPA_META_VideoDamage),
+                                               SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int(sizeof(spa_meta_region) * videoDamageRegionCount,
+                                                                                              sizeof(spa_meta_region) * 1,
+                                                                                              sizeof(spa_meta_region) * videoDamageRegionCount))
     };
-    pw_stream_update_params(pwStream, params, 2);
+    pw_stream_update_params(pwStream, params, 3);
 }
 
 void PipeWireStream::onStreamParamChanged(void *data, uint32_t id, const struct spa_pod *format)
@@ -98,7 +114,9 @@ void PipeWireStream::onStreamParamChanged(void *data, uint32_t id, const struct
 
     PipeWireStream *pw = static_cast<PipeWireStream *>(data);
     spa_format_video_raw_parse (format, &pw->videoFormat);
-    qCDebug(KWIN_SCREENCAST) << "Stream format changed" << pw << pw->videoFormat.format;
+    // Only the format that we offer for dma-bufs carries a modifier.
+    pw->m_useDmaBuf = spa_pod_find_prop(format, nullptr, SPA_FORMAT_VIDEO_modifier) != nullptr;
+    qCDebug(KWIN_SCREENCAST) << "Stream format changed" << pw << pw->videoFormat.format << "dmabuf:" << pw->m_useDmaBuf;
     pw->newStreamParams();
 }
 
@@ -110,7 +128,13 @@ void PipeWireStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
     spa_data->mapoffset = 0;
     spa_data->flags = SPA_DATA_FLAG_READWRITE;
 
-    QSharedPointer<DmaBufTexture> dmabuf(kwinApp()->platform()->createDmaBufTexture(stream->m_resolution));
+    // Nothing has been rendered into the buffer yet.
+    stream->m_bufferDamage.insert(buffer, QRect(QPoint(), stream->m_resolution));
+
+    QSharedPointer<DmaBufTexture> dmabuf;
+    if (stream->m_useDmaBuf) {
+        dmabuf.reset(kwinApp()->platform()->createDmaBufTexture(stream->m_resolution));
+    }
     if (dmabuf) {
       spa_data->type = SPA_DATA_DmaBuf;
       spa_data->fd = dmabuf->fd();
@@ -161,6 +185,8 @@ void PipeWireStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
 
+    stream->m_bufferDamage.remove(buffer);
+    stream->discardPendingFrames(buffer);
     if (spa_data->type == SPA_DATA_DmaBuf) {
         stream->m_dmabufDataForPwBuffer.remove(buffer);
     } else if (spa_data->type == SPA_DATA_MemFd) {
@@ -169,6 +195,14 @@ void PipeWireStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
     }
 }
 
+static bool makeOpenGLContextCurrent()
+{
+    // The readbacks belong to the compositor's context, which needn't be current outside
+    // of the frame rendering.
+    Scene *scene = Compositor::self() ? Compositor::self()->scene() : nullptr;
+    return scene && scene->makeOpenGLContextCurrent();
+}
+
 PipeWireStream::PipeWireStream(bool hasAlpha, const QSize &resolution, QObject *parent)
     : QObject(parent)
     , m_resolution(resolution)
@@ -179,11 +213,30 @@ PipeWireStream::PipeWireStream(bool hasAlpha, const QSize &resolution, QObject *
     pwStreamEvents.remove_buffer = &PipeWireStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &PipeWireStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &PipeWireStream::onStreamParamChanged;
+
+    // Pending readbacks are polled when the next frame gets recorded. If the screen doesn't
+    // change for a while, the timer picks them up instead.
+    m_readbackTimer.setSingleShot(true);
+    m_readbackTimer.setInterval(5);
+    connect(&m_readbackTimer, &QTimer::timeout, this, [this] {
+        if (!makeOpenGLContextCurrent()) {
+            return;
+        }
+        finishPendingFrames(false);
+        if (!m_pendingFrames.isEmpty()) {
+            m_readbackTimer.start();
+        }
+    });
 }
 
 PipeWireStream::~PipeWireStream()
 {
     m_stopped = true;
+    if (!m_pendingFrames.isEmpty() || !m_idleReadbacks.isEmpty()) {
+        makeOpenGLContextCurrent();
+    }
+    discardPendingFrames(nullptr);
+    qDeleteAll(m_idleReadbacks);
     if (pwStream) {
         pw_stream_destroy(pwStream);
     }
@@ -227,29 +280,30 @@ bool PipeWireStream::createStream()
     const QByteArray objname = "kwin-screencast-" + objectName().toUtf8();
     pwStream = pw_stream_new(pwCore->pwCore, objname, nullptr);
 
-    uint8_t buffer[1024];
-    spa_pod_builder podBuilder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
-    spa_fraction minFramerate = SPA_FRACTION(1, 1);
-    spa_fraction maxFramerate = SPA_FRACTION(25, 1);
-    spa_fraction defaultFramerate = SPA_FRACTION(0, 1);
-
-    spa_rectangle resolution = SPA_RECTANGLE(uint32_t(m_resolution.width()), uint32_t(m_resolution.height()));
+    // Check whether the platform can allocate dma-bufs and which modifier they use.
+    QScopedPointer<DmaBufTexture> dmabuf(kwinApp()->platform()->createDmaBufTexture(m_resolution));
+    if (dmabuf) {
+        m_hasDmaBuf = true;
+        m_dmabufModifier = dmabuf->modifier();
+    }
+    dmabuf.reset();
 
-    const auto format = m_hasAlpha ? SPA_VIDEO_FORMAT_BGRA : SPA_VIDEO_FORMAT_BGR;
+    uint8_t buffer[2048];
+    spa_pod_builder podBuilder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 
-    const spa_pod *param = (spa_pod*)spa_pod_builder_add_object(&podBuilder,
-                                        SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
-                                        SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video),
-                                        SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-                                        SPA_FORMAT_VIDEO_format, SPA_POD_Id(format),
-                                        SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle(&resolution),
-                                        SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&defaultFramerate),
-                                        SPA_FORMAT_VIDEO_maxFramerate, SPA_POD_CHOICE_RANGE_Fraction(&maxFramerate, &minFramerate, &maxFramerate));
+    // The dma-buf format is preferred, consumers that cannot import dma-bufs fall back to
+    // the format without a modifier, which is provided in shared memory.
+    const spa_pod *params[2];
+    int paramCount = 0;
+    if (m_hasDmaBuf) {
+        params[paramCount++] = buildFormat(&podBuilder, m_hasAlpha ? SPA_VIDEO_FORMAT_BGRA : SPA_VIDEO_FORMAT_BGRx, &m_dmabufModifier);
+    }
+    params[paramCount++] = buildFormat(&podBuilder, m_hasAlpha ? SPA_VIDEO_FORMAT_BGRA : SPA_VIDEO_FORMAT_BGR, nullptr);
 
     pw_stream_add_listener(pwStream, &streamListener, &pwStreamEvents, this);
     auto flags = pw_stream_flags(PW_STREAM_FLAG_DRIVER | PW_STREAM_FLAG_ALLOC_BUFFERS);
 
-    if (pw_stream_connect(pwStream, PW_DIRECTION_OUTPUT, SPA_ID_INVALID, flags, &param, 1) != 0) {
+    if (pw_stream_connect(pwStream, PW_DIRECTION_OUTPUT, SPA_ID_INVALID, flags, params, paramCount) != 0) {
         qCWarning(KWIN_SCREENCAST) << "Could not connect to stream";
         pw_stream_destroy(pwStream);
         return false;
@@ -267,6 +321,32 @@ bool PipeWireStream::createStream()
 
     return true;
 }
+
+spa_pod *PipeWireStream::buildFormat(spa_pod_builder *builder, spa_video_format format, const quint64 *modifier)
+{
+    spa_fraction minFramerate = SPA_FRACTION(1, 1);
+    spa_fraction maxFramerate = SPA_FRACTION(25, 1);
+    spa_fraction defaultFramerate = SPA_FRACTION(0, 1);
+
+    spa_rectangle resolution = SPA_RECTANGLE(uint32_t(m_resolution.width()), uint32_t(m_resolution.height()));
+
+    spa_pod_frame frame;
+    spa_pod_builder_push_object(builder, &frame, SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+    spa_pod_builder_add(builder,
+                        SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video),
+                        SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+                        SPA_FORMAT_VIDEO_format, SPA_POD_Id(format),
+                        SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle(&resolution),
+                        SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&defaultFramerate),
+                        SPA_FORMAT_VIDEO_maxFramerate, SPA_POD_CHOICE_RANGE_Fraction(&maxFramerate, &minFramerate, &maxFramerate),
+                        0);
+    if (modifier) {
+        spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_modifier, SPA_POD_PROP_FLAG_MANDATORY);
+        spa_pod_builder_long(builder, *modifier);
+    }
+    return static_cast<spa_pod *>(spa_pod_builder_pop(builder, &frame));
+}
+
 void PipeWireStream::coreFailed(const QString &errorMessage)
 {
     m_error = errorMessage;
@@ -279,18 +359,85 @@ void PipeWireStream::stop()
     delete this;
 }
 
-static GLTexture *copyTexture(GLTexture *texture)
+// Maps @p rect in frame coordinates to texel coordinates of @p texture.
+static QRect textureRect(GLTexture *texture, const QRect &rect)
 {
-    GLTexture *copy = new GLTexture(texture->internalFormat(), texture->size());
-    copy->setFilter(GL_LINEAR);
-    copy->setWrapMode(GL_CLAMP_TO_EDGE);
+    if (texture->isYInverted()) {
+        return QRect(rect.x(), texture->height() - rect.y() - rect.height(), rect.width(), rect.height());
+    }
+    return rect;
+}
 
-    const QRect r({}, texture->size());
+void PipeWireStream::addDamage(const QRegion &damagedRegion)
+{
+    for (auto it = m_bufferDamage.begin(); it != m_bufferDamage.end(); ++it) {
+        *it |= damagedRegion;
+    }
+    m_streamDamage |= damagedRegion;
+}
 
-    copy->bind();
-    glCopyTextureSubImage2D(copy->texture(), 0, 0, 0, 0, 0, r.width(), r.height());
-    copy->unbind();
-    return copy;
+void PipeWireStream::updateLastFrame(GLTexture *frameTexture, const QRegion &damagedRegion)
+{
+    const QRect frameRect(QPoint(), frameTexture->size());
+    QRegion region = damagedRegion & frameRect;
+    if (!m_cursor.lastFrameTexture || m_cursor.lastFrameTexture->size() != frameTexture->size()) {
+        m_cursor.lastFrameTexture.reset(new GLTexture(frameTexture->internalFormat(), frameTexture->size()));
+        m_cursor.lastFrameTexture->setFilter(GL_LINEAR);
+        m_cursor.lastFrameTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        region = frameRect;
+    }
+    m_cursor.lastFrameTexture->setYInverted(frameTexture->isYInverted());
+
+    GLTexture *lastFrameTexture = m_cursor.lastFrameTexture.data();
+    for (const QRect &rect : region) {
+        const QRect source = textureRect(frameTexture, rect);
+        glCopyImageSubData(frameTexture->texture(), frameTexture->target(), 0, source.x(), source.y(), 0,
+                           lastFrameTexture->texture(), lastFrameTexture->target(), 0, source.x(), source.y(), 0,
+                           source.width(), source.height(), 1);
+    }
+}
+
+void PipeWireStream::renderFrame(GLTexture *frameTexture, const QRegion &region, Cursor *cursor, bool embedCursor)
+{
+    frameTexture->bind();
+
+    const QRect r(QPoint(), frameTexture->size());
+    auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+
+    QMatrix4x4 mvp;
+    mvp.ortho(r);
+    shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+    // The rows of the frame end up top to bottom in the render target, so the damage
+    // can be used as scissor rectangles as is.
+    glEnable(GL_SCISSOR_TEST);
+    for (const QRect &rect : region) {
+        glScissor(rect.x(), rect.y(), rect.width(), rect.height());
+        frameTexture->render(r, r);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    frameTexture->unbind();
+
+    if (embedCursor) {
+        if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey()) {
+            m_cursor.texture.reset(new GLTexture(cursor->image()));
+            m_cursor.lastKey = cursor->image().cacheKey();
+        }
+
+        m_cursor.texture->setYInverted(false);
+        m_cursor.texture->bind();
+        const auto cursorRect = cursorGeometry(cursor);
+        mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height() * m_cursor.scale);
+        shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        m_cursor.texture->render(cursorRect, cursorRect);
+        glDisable(GL_BLEND);
+        m_cursor.texture->unbind();
+        m_cursor.lastRect = cursorRect;
+    }
+    ShaderManager::instance()->popShader();
 }
 
 void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damagedRegion)
@@ -304,6 +451,14 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
         return;
     }
 
+    // The damage has to be tracked even if the frame is dropped, the buffers that miss
+    // the frame must be brought up to date when they are filled next time.
+    addDamage(damagedRegion);
+    if (m_cursor.mode == KWaylandServer::ScreencastInterface::Embedded && !m_repainting) {
+        // Keep the last frame around to render the moved cursor on top of it.
+        updateLastFrame(frameTexture, damagedRegion);
+    }
+
     const char *error = "";
     auto state = pw_stream_get_state(pwStream, &error);
     if (state != PW_STREAM_STATE_STREAMING) {
@@ -330,6 +485,17 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
     }
 
     const auto size = frameTexture->size();
+    const QRect frameRect(QPoint(), size);
+
+    // Only the parts of the buffer that have changed since it was filled last time are copied.
+    QRegion &bufferDamage = m_bufferDamage[buffer];
+    const QRegion region = bufferDamage & frameRect;
+    bufferDamage = QRegion();
+
+    auto cursor = Cursors::self()->currentCursor();
+    const bool embedCursor = m_cursor.mode == KWaylandServer::ScreencastInterface::Embedded && m_cursor.viewport.contains(cursor->pos());
+    GLPixelReadback *readback = nullptr;
+
     spa_data->chunk->offset = 0;
     if (data) {
         const int bpp = data && !m_hasAlpha ? 3 : 4;
@@ -338,6 +504,7 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
 
         if (bufferSize > spa_data->maxsize) {
             qCDebug(KWIN_SCREENCAST) << "Failed to record frame: frame is too big";
+            bufferDamage = frameRect;
             pw_stream_queue_buffer(pwStream, buffer);
             return;
         }
@@ -345,78 +512,184 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
         spa_data->chunk->size = bufferSize;
         spa_data->chunk->stride = stride;
 
-        frameTexture->bind();
-        glGetTextureImage(frameTexture->texture(), 0, m_hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, bufferSize, data);
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastInterface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QImage dest(data, size.width(), size.height(), QImage::Format_RGBA8888_Premultiplied);
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+        // The cursor is blended on top of the frame on the GPU, like for dmabuf buffers, so
+        // the pixels that are read back are already in the format of the buffer.
+        GLTexture *sourceTexture = frameTexture;
+        QRegion sourceRegion = region;
+        if (embedCursor) {
+            if (!m_cursor.composedTexture || m_cursor.composedTexture->size() != size) {
+                m_cursor.composedTarget.reset();
+                m_cursor.composedTexture.reset(new GLTexture(GL_RGBA8, size));
+                m_cursor.composedTexture->setYInverted(false);
+                m_cursor.composedTarget.reset(new GLRenderTarget(*m_cursor.composedTexture));
+                // The contents of the new texture are undefined.
+                sourceRegion = frameRect;
+            }
+            sourceRegion = (sourceRegion | cursorGeometry(cursor)) & frameRect;
+            sourceTexture = m_cursor.composedTexture.data();
+
+            GLRenderTarget::pushRenderTarget(m_cursor.composedTarget.data());
+            renderFrame(frameTexture, sourceRegion, cursor, embedCursor);
+            GLRenderTarget::popRenderTarget();
+        }
+
+        QRegion textureRegion;
+        for (const QRect &rect : sourceRegion) {
+            textureRegion += textureRect(sourceTexture, rect);
+        }
+
+        // If possible, the pixels are read into a pixel buffer object, so the compositor
+        // doesn't have to wait until the GPU has finished rendering the frame.
+        if (GLPixelReadback::supported()) {
+            readback = m_idleReadbacks.isEmpty() ? new GLPixelReadback : m_idleReadbacks.takeLast();
+            readback->begin(bufferSize);
+        }
+
+        // Rows are padded to a multiple of 4 bytes, which matches the default pack alignment.
+        glPixelStorei(GL_PACK_ROW_LENGTH, size.width());
+        for (const QRect &rect : textureRegion) {
+            const uint offset = rect.y() * stride + rect.x() * bpp;
+            void *pixels = readback ? reinterpret_cast<void *>(quintptr(offset)) : data + offset;
+            glGetTextureSubImage(sourceTexture->texture(), 0, rect.x(), rect.y(), 0, rect.width(), rect.height(), 1,
+                                 m_hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, bufferSize - offset, pixels);
+        }
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+        if (readback) {
+            readback->end();
+
+            PendingFrame frame;
+            frame.buffer = buffer;
+            frame.readback = readback;
+            frame.region = textureRegion;
+            frame.stride = stride;
+            frame.bpp = bpp;
+            m_pendingFrames.append(frame);
         }
     } else {
-        using namespace KWin;
         auto &buf = m_dmabufDataForPwBuffer[buffer];
 
         spa_data->chunk->stride = buf->stride();
         spa_data->chunk->size = spa_data->maxsize;
 
         GLRenderTarget::pushRenderTarget(buf->framebuffer());
-        frameTexture->bind();
+        renderFrame(frameTexture, region, cursor, embedCursor);
+        GLRenderTarget::popRenderTarget();
+    }
 
-        QRect r(QPoint(), size);
-        auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+    if (embedCursor) {
+        // Every buffer has to restore the frame contents below the cursor when it's filled next time.
+        addDamage(m_cursor.lastRect);
+    }
 
-        QMatrix4x4 mvp;
-        mvp.ortho(r);
-        shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    const QRegion streamDamage = m_streamDamage & frameRect;
+    m_streamDamage = QRegion();
 
-        QRegion dr = damagedRegion;
-        if (m_cursor.texture) {
-            dr |= m_cursor.lastRect;
+    if (readback) {
+        // The buffer is handed over to the stream once the pixels have arrived.
+        m_pendingFrames.last().damage = streamDamage;
+        finishPendingFrames(true);
+        if (!m_pendingFrames.isEmpty() && !m_readbackTimer.isActive()) {
+            m_readbackTimer.start();
         }
+        return;
+    }
 
-        frameTexture->render(damagedRegion, r, true);
+    queueBuffer(buffer, streamDamage);
+}
 
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastInterface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            if (!m_repainting) //We need to copy the last version of the stream to render the moved cursor on top
-                m_cursor.lastFrameTexture.reset(copyTexture(frameTexture));
+void PipeWireStream::queueBuffer(struct pw_buffer *buffer, const QRegion &damagedRegion)
+{
+    if (m_cursor.mode == KWaylandServer::ScreencastInterface::Metadata) {
+        sendCursorData(Cursors::self()->currentCursor(),
+                        (spa_meta_cursor *) spa_buffer_find_meta_data (buffer->buffer, SPA_META_Cursor, sizeof (spa_meta_cursor)));
+    }
+    sendDamageData(buffer->buffer, damagedRegion);
 
-            if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey())
-                m_cursor.texture.reset(new GLTexture(cursor->image()));
+    pw_stream_queue_buffer(pwStream, buffer);
+}
 
-            m_cursor.texture->setYInverted(false);
-            m_cursor.texture->bind();
-            const auto cursorRect = cursorGeometry(cursor);
-            mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height() * m_cursor.scale);
-            shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+void PipeWireStream::finishPendingFrames(bool wait)
+{
+    while (!m_pendingFrames.isEmpty()) {
+        const PendingFrame &frame = m_pendingFrames.constFirst();
+        if (!frame.readback->isComplete(wait && m_pendingFrames.count() >= s_maxPendingFrames)) {
+            break;
+        }
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            m_cursor.texture->render(cursorRect, cursorRect, true);
-            glDisable(GL_BLEND);
-            m_cursor.texture->unbind();
-            m_cursor.lastRect = cursorRect;
+        uint8_t *data = static_cast<uint8_t *>(frame.buffer->buffer->datas->data);
+        if (const uchar *pixels = frame.readback->map()) {
+            for (const QRect &rect : frame.region) {
+                for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                    const uint offset = y * frame.stride + rect.x() * frame.bpp;
+                    memcpy(data + offset, pixels + offset, rect.width() * frame.bpp);
+                }
+            }
+            frame.readback->unmap();
+        } else {
+            qCWarning(KWIN_SCREENCAST) << "Failed to map the pixel buffer";
+            m_bufferDamage[frame.buffer] = QRect(QPoint(), m_resolution);
         }
-        ShaderManager::instance()->popShader();
 
-        GLRenderTarget::popRenderTarget();
+        m_idleReadbacks.append(frame.readback);
+        queueBuffer(frame.buffer, frame.damage);
+        m_pendingFrames.removeFirst();
     }
-    frameTexture->unbind();
 
-    if (m_cursor.mode == KWaylandServer::ScreencastInterface::Metadata) {
-        sendCursorData(Cursors::self()->currentCursor(),
-                        (spa_meta_cursor *) spa_buffer_find_meta_data (spa_buffer, SPA_META_Cursor, sizeof (spa_meta_cursor)));
+    if (m_pendingFrames.isEmpty()) {
+        m_readbackTimer.stop();
     }
+}
 
-    pw_stream_queue_buffer(pwStream, buffer);
+void PipeWireStream::discardPendingFrames(struct pw_buffer *buffer)
+{
+    if (buffer && !m_pendingFrames.isEmpty()) {
+        makeOpenGLContextCurrent();
+    }
+    for (auto it = m_pendingFrames.begin(); it != m_pendingFrames.end();) {
+        if (!buffer || it->buffer == buffer) {
+            delete it->readback;
+            it = m_pendingFrames.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_pendingFrames.isEmpty()) {
+        m_readbackTimer.stop();
+    }
 }
 
 QRect PipeWireStream::cursorGeometry(Cursor *cursor) const
 {
     const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-    return QRect{position, m_cursor.texture->size()};
+    return QRect{position, cursor->image().size()};
+}
+
+void PipeWireStream::sendDamageData(spa_buffer *spaBuffer, const QRegion &damagedRegion)
+{
+    spa_meta *meta = spa_buffer_find_meta(spaBuffer, SPA_META_VideoDamage);
+    if (!meta) {
+        return;
+    }
+    const int maxRegionCount = meta->size / sizeof(spa_meta_region);
+    if (maxRegionCount == 0) {
+        return;
+    }
+
+    spa_meta_region *regions = static_cast<spa_meta_region *>(meta->data);
+    int count = 0;
+    if (damagedRegion.rectCount() > maxRegionCount) {
+        const QRect rect = damagedRegion.boundingRect();
+        regions[count++].region = SPA_REGION(rect.x(), rect.y(), uint32_t(rect.width()), uint32_t(rect.height()));
+    } else {
+        for (const QRect &rect : damagedRegion) {
+            regions[count++].region = SPA_REGION(rect.x(), rect.y(), uint32_t(rect.width()), uint32_t(rect.height()));
+        }
+    }
+    // An empty region terminates the list.
+    if (count < maxRegionCount) {
+        regions[count].region = SPA_REGION(0, 0, 0, 0);
+    }
 }
 
 void PipeWireStream::sendCursorData(Cursor *cursor, spa_meta_cursor *spa_meta_cursor)
@@ -15,8 +15,10 @@
 
 #include <QHash>
 #include <QObject>
+#include <QRegion>
 #include <QSharedPointer>
 #include <QSize>
+#include <QTimer>
 
 #include <pipewire/pipewire.h>
 #include <spa/param/format-utils.h>
@@ -28,6 +30,8 @@ namespace KWin
 
 class Cursor;
 class DmaBufTexture;
+class GLPixelReadback;
+class GLRenderTarget;
 class GLTexture;
 class PipeWireCore;
 
@@ -67,7 +71,15 @@ private:
     void updateParams();
     void coreFailed(const QString &errorMessage);
     void sendCursorData(Cursor *cursor, spa_meta_cursor *spa_cursor);
+    void sendDamageData(spa_buffer *spaBuffer, const QRegion &damagedRegion);
     void newStreamParams();
+    spa_pod *buildFormat(spa_pod_builder *builder, spa_video_format format, const quint64 *modifier);
+    void addDamage(const QRegion &damagedRegion);
+    void updateLastFrame(GLTexture *frameTexture, const QRegion &damagedRegion);
+    void renderFrame(GLTexture *frameTexture, const QRegion &region, Cursor *cursor, bool embedCursor);
+    void queueBuffer(struct pw_buffer *buffer, const QRegion &damagedRegion);
+    void finishPendingFrames(bool wait);
+    void discardPendingFrames(struct pw_buffer *buffer);
 
     QSharedPointer<PipeWireCore> pwCore;
     struct pw_stream *pwStream = nullptr;
@@ -82,6 +94,9 @@ private:
     spa_video_info_raw videoFormat;
     QString m_error;
     const bool m_hasAlpha;
+    bool m_hasDmaBuf = false;
+    bool m_useDmaBuf = false;
+    quint64 m_dmabufModifier = 0;
 
     struct {
         KWaylandServer::ScreencastInterface::CursorMode mode = KWaylandServer::ScreencastInterface::Hidden;
@@ -91,11 +106,39 @@ private:
         QRect lastRect;
         QScopedPointer<GLTexture> texture;
         QScopedPointer<GLTexture> lastFrameTexture;
+        // Shared memory frames are composed with the cursor here before they are read back.
+        QScopedPointer<GLTexture> composedTexture;
+        QScopedPointer<GLRenderTarget> composedTarget;
     } m_cursor;
     bool m_repainting = false;
     QRect cursorGeometry(Cursor *cursor) const;
 
     QHash<struct pw_buffer *, QSharedPointer<DmaBufTexture>> m_dmabufDataForPwBuffer;
+    /**
+     * The parts of each buffer that are out of date, i.e. that have changed since the
+     * buffer has been filled last time.
+     */
+    QHash<struct pw_buffer *, QRegion> m_bufferDamage;
+    /**
+     * The damage since the last frame that has been queued to the stream.
+     */
+    QRegion m_streamDamage;
+
+    /**
+     * A frame whose pixels are being read back asynchronously into a shared memory buffer.
+     * The buffer is queued to the stream once the readback has finished.
+     */
+    struct PendingFrame {
+        struct pw_buffer *buffer = nullptr;
+        GLPixelReadback *readback = nullptr;
+        QRegion region;
+        QRegion damage;
+        uint stride = 0;
+        int bpp = 0;
+    };
+    QVector<PendingFrame> m_pendingFrames;
+    QVector<GLPixelReadback *> m_idleReadbacks;
+    QTimer m_readbackTimer;
 };
 
 } // namespace KWin
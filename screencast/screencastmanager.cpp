@@ -103,7 +103,9 @@ private:
         const bool wasYInverted = frameTexture->isYInverted();
         frameTexture->setYInverted(false);
 
-        recordFrame(frameTexture.data(), m_damagedRegion);
+        // The window texture is created anew for every frame and its layout doesn't
+        // necessarily match the window damage, so always copy it as a whole.
+        recordFrame(frameTexture.data(), QRect(QPoint(), frameTexture->size()));
         frameTexture->setYInverted(wasYInverted);
         m_damagedRegion = {};
         bool b = fence.clientWaitSync();
@@ -159,7 +161,16 @@ void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamInterface *
         auto texture = scene->textureForOutput(streamOutput);
 
         const QRect frame({}, streamOutput->modeSize());
-        const QRegion region = damagedRegion.isEmpty() || streamOutput->pixelSize() != streamOutput->modeSize() ? frame : damagedRegion.translated(-streamOutput->geometry().topLeft()).intersected(frame);
+        QRegion region = frame;
+        if (!damagedRegion.isEmpty() && streamOutput->pixelSize() == streamOutput->modeSize()) {
+            // The damage is in the logical coordinates, the frame in device pixels.
+            const qreal scale = streamOutput->scale();
+            region = QRegion();
+            for (const QRect &rect : damagedRegion.translated(-streamOutput->geometry().topLeft())) {
+                region += QRectF(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale).toAlignedRect();
+            }
+            region &= frame;
+        }
         stream->recordFrame(texture.data(), region);
     };
     connect(stream, &PipeWireStream::startStreaming, waylandStream, [streamOutput, stream, bufferToStream] {
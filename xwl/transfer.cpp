@@ -29,6 +29,8 @@
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -40,6 +42,8 @@ namespace Xwl
 
 // in Bytes: equals 64KB
 static const uint32_t s_incrChunkSize = 63 * 1024;
+// at most this many chunks are read ahead of the X client, the source is paused meanwhile
+static const int s_maxQueuedChunks = 4;
 
 Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, QObject *parent)
     : QObject(parent)
@@ -47,6 +51,10 @@ Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, Q
     , m_fd(fd)
     , m_timestamp(timestamp)
 {
+    // a slow Wayland client must not block the compositor
+    if (m_fd >= 0) {
+        fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    }
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -113,21 +121,35 @@ int TransferWltoX::flushSourceData()
 {
     xcb_connection_t *xcbConn = kwinApp()->x11Connection();
 
+    auto chunk = m_chunks.takeFirst();
     xcb_change_property(xcbConn,
                         XCB_PROP_MODE_REPLACE,
                         m_request->requestor,
                         m_request->property,
                         m_request->target,
                         8,
-                        m_chunks.first().first.size(),
-                        m_chunks.first().first.data());
+                        chunk.second,
+                        chunk.first.constData());
     xcb_flush(xcbConn);
 
     m_propertyIsSet = true;
     resetTimeout();
 
-    const auto rm = m_chunks.takeFirst();
-    return rm.first.size();
+    // the data has been sent, the buffer can take the next chunk
+    m_freeChunks.append(chunk.first);
+    if (socketNotifier() && !socketNotifier()->isEnabled()) {
+        socketNotifier()->setEnabled(true);
+    }
+    return chunk.second;
+}
+
+bool TransferWltoX::hasCompleteChunk() const
+{
+    if (m_chunks.isEmpty()) {
+        return false;
+    }
+    // the last chunk is complete as well once the source has been read entirely
+    return m_chunks.first().second == int(s_incrChunkSize) || !socketNotifier();
 }
 
 void TransferWltoX::startIncr()
@@ -163,9 +185,13 @@ void TransferWltoX::readWlSource()
 {
     if (m_chunks.size() == 0 ||
             m_chunks.last().second == s_incrChunkSize) {
-        // append new chunk
+        // append new chunk, reusing the buffer of an already sent one
         auto next = QPair<QByteArray, int>();
-        next.first.resize(s_incrChunkSize);
+        if (m_freeChunks.isEmpty()) {
+            next.first.resize(s_incrChunkSize);
+        } else {
+            next.first = m_freeChunks.takeLast();
+        }
         next.second = 0;
         m_chunks.append(next);
     }
@@ -176,6 +202,9 @@ void TransferWltoX::readWlSource()
 
     ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
     if (readLen == -1) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return;
+        }
         qCWarning(KWIN_XWL) << "Error reading in Wl data.";
 
         // TODO: cleanup X side?
@@ -186,23 +215,34 @@ void TransferWltoX::readWlSource()
 
     if (readLen == 0) {
         // at the fd end - complete transfer now
-        m_chunks.last().first.resize(m_chunks.last().second);
+        clearSocketNotifier();
+        if (m_chunks.last().second == 0) {
+            m_chunks.removeLast();
+        }
 
         if (incr()) {
             // incremental transfer is to be completed now
             m_flushPropertyOnDelete = true;
             if (!m_propertyIsSet) {
-                // flush if target's property is not set at the moment
-                flushSourceData();
+                if (hasCompleteChunk()) {
+                    // flush if target's property is not set at the moment
+                    flushSourceData();
+                } else {
+                    // everything has been sent already
+                    handlePropertyDelete();
+                }
             }
-            clearSocketNotifier();
         } else {
             // non incremental transfer is to be completed now,
             // data can be transferred to X client via a single property set
+            if (m_chunks.isEmpty()) {
+                m_chunks.append(qMakePair(QByteArray(), 0));
+            }
             flushSourceData();
             Q_EMIT selectionNotify(m_request, true);
             endTransfer();
         }
+        return;
     } else if (m_chunks.last().second == s_incrChunkSize) {
         // first chunk full, but not yet at fd end -> go incremental
         if (incr()) {
@@ -215,6 +255,10 @@ void TransferWltoX::readWlSource()
             // starting incremental transfer
             startIncr();
         }
+        // don't read ahead more than a few chunks, the X client has to catch up first
+        if (m_chunks.size() >= s_maxQueuedChunks) {
+            socketNotifier()->setEnabled(false);
+        }
     }
     resetTimeout();
 }
@@ -258,9 +302,10 @@ void TransferWltoX::handlePropertyDelete()
             xcb_flush(xcbConn);
             m_flushPropertyOnDelete = false;
             endTransfer();
-        } else {
+        } else if (hasCompleteChunk()) {
             flushSourceData();
         }
+        // otherwise the next chunk is flushed as soon as it has been read
     }
 }
 
@@ -546,9 +591,13 @@ void TransferXtoWl::dataSourceWrite()
 
     ssize_t len = write(fd(), property.constData(), property.size());
     if (len == -1) {
-        qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
-        endTransfer();
-        return;
+        if (errno != EAGAIN && errno != EINTR) {
+            qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
+            endTransfer();
+            return;
+        }
+        // the Wayland client hasn't read the previous data yet
+        len = 0;
     }
 
     m_receiver->partRead(len);
@@ -122,14 +122,17 @@ private:
     void startIncr();
     void readWlSource();
     int flushSourceData();
+    bool hasCompleteChunk() const;
     void handlePropertyDelete();
 
     xcb_selection_request_event_t *m_request = nullptr;
 
-    /* contains all received data portioned in chunks
-     * TODO: explain second QPair component
+    /* contains the received data not yet sent to the X client portioned in
+     * chunks, the second QPair component is the number of bytes read into it
      */
     QVector<QPair<QByteArray, int> > m_chunks;
+    // buffers of sent chunks, reused for the following ones
+    QVector<QByteArray> m_freeChunks;
 
     bool m_propertyIsSet = false;
     bool m_flushPropertyOnDelete = false;
@@ -10,6 +10,7 @@
 */
 #include "xwayland.h"
 #include "databridge.h"
+#include "xwaylandsocket.h"
 
 #include "main_wayland.h"
 #include "utils.h"
@@ -77,6 +78,7 @@ Xwayland::Xwayland(ApplicationWaylandAbstract *app, QObject *parent)
 Xwayland::~Xwayland()
 {
     stop();
+    uninstallListenNotifiers();
     s_self = nullptr;
 }
 
@@ -85,7 +87,54 @@ QProcess *Xwayland::process() const
     return m_xwaylandProcess;
 }
 
-void Xwayland::start()
+void Xwayland::start(StartMode mode)
+{
+    m_startMode = mode;
+    if (mode == StartMode::Immediately) {
+        launchXwayland();
+        return;
+    }
+
+    m_listenSocket.reset(new XwaylandSocket);
+    if (!m_listenSocket->isValid()) {
+        std::cerr << "FATAL ERROR: failed to create the X11 display sockets" << std::endl;
+        Q_EMIT criticalError(1);
+        return;
+    }
+
+    // The X11 clients can be started right away, they wait in the listen queue until the
+    // Xwayland server accepts them.
+    const QString displayName = m_listenSocket->name();
+    setenv("DISPLAY", qPrintable(displayName), true);
+    auto env = m_app->processStartupEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), displayName);
+    m_app->setProcessStartupEnvironment(env);
+
+    installListenNotifiers();
+    emit started();
+}
+
+void Xwayland::installListenNotifiers()
+{
+    const QVector<int> fileDescriptors = m_listenSocket->fileDescriptors();
+    for (int fileDescriptor : fileDescriptors) {
+        QSocketNotifier *notifier = new QSocketNotifier(fileDescriptor, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() {
+            qCDebug(KWIN_XWL) << "An X11 client is connecting, starting Xwayland";
+            uninstallListenNotifiers();
+            launchXwayland();
+        });
+        m_listenNotifiers << notifier;
+    }
+}
+
+void Xwayland::uninstallListenNotifiers()
+{
+    qDeleteAll(m_listenNotifiers);
+    m_listenNotifiers.clear();
+}
+
+void Xwayland::launchXwayland()
 {
     int pipeFds[2];
     if (pipe(pipeFds) != 0) {
@@ -129,17 +178,35 @@ void Xwayland::start()
     env.insert("WAYLAND_SOCKET", QByteArray::number(wlfd));
     env.insert("EGL_PLATFORM", QByteArrayLiteral("DRM"));
     m_xwaylandProcess->setProcessEnvironment(env);
-    m_xwaylandProcess->setArguments({QStringLiteral("-displayfd"),
-                           QString::number(pipeFds[1]),
-                           QStringLiteral("-rootless"),
-                           QStringLiteral("-wm"),
-                           QString::number(fd)});
+    QStringList arguments{QStringLiteral("-displayfd"),
+                          QString::number(pipeFds[1]),
+                          QStringLiteral("-rootless"),
+                          QStringLiteral("-wm"),
+                          QString::number(fd)};
+    QVector<int> listenFds;
+    if (m_listenSocket) {
+        // Xwayland takes over the sockets, including the clients waiting to be accepted.
+        arguments.prepend(m_listenSocket->name());
+        const QVector<int> fileDescriptors = m_listenSocket->fileDescriptors();
+        for (int fileDescriptor : fileDescriptors) {
+            const int listenFd = dup(fileDescriptor);
+            if (listenFd < 0) {
+                continue;
+            }
+            listenFds << listenFd;
+            arguments << QStringLiteral("-listen") << QString::number(listenFd);
+        }
+    }
+    m_xwaylandProcess->setArguments(arguments);
     connect(m_xwaylandProcess, &QProcess::errorOccurred, this, &Xwayland::handleXwaylandError);
     connect(m_xwaylandProcess, &QProcess::started, this, &Xwayland::handleXwaylandStarted);
     connect(m_xwaylandProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &Xwayland::handleXwaylandFinished);
     m_xwaylandProcess->start();
     close(pipeFds[1]);
+    for (int listenFd : qAsConst(listenFds)) {
+        close(listenFd);
+    }
 }
 
 void Xwayland::stop()
@@ -183,6 +250,10 @@ void Xwayland::dispatchEvents()
     if (connectionError) {
         qCWarning(KWIN_XWL, "The X11 connection broke (error %d)", connectionError);
         stop();
+        // stop() disconnects from the process, so handleXwaylandFinished() won't re-arm this.
+        if (m_startMode == StartMode::OnDemand) {
+            installListenNotifiers();
+        }
         return;
     }
 
@@ -238,6 +309,11 @@ void Xwayland::handleXwaylandFinished(int exitCode)
     // Xwayland or shut down all X11 related components. For now, we do the latter, we simply
     // tear down everything that has any connection to X11.
     stop();
+
+    // Xwayland is spawned again once another X11 client connects.
+    if (m_startMode == StartMode::OnDemand) {
+        installListenNotifiers();
+    }
 }
 
 void Xwayland::handleXwaylandError(QProcess::ProcessError error)
@@ -331,7 +407,10 @@ void Xwayland::continueStartupWithX()
     env.insert(QStringLiteral("DISPLAY"), QString::fromUtf8(qgetenv("DISPLAY")));
     m_app->setProcessStartupEnvironment(env);
 
-    emit started();
+    // With on-demand startup, the display has been announced when the sockets were created.
+    if (m_startMode == StartMode::Immediately) {
+        emit started();
+    }
 
     Xcb::sync(); // Trigger possible errors, there's still a chance to abort
 }
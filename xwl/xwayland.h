@@ -13,7 +13,9 @@
 #include "xwayland_interface.h"
 
 #include <QProcess>
+#include <QScopedPointer>
 #include <QSocketNotifier>
+#include <QVector>
 
 namespace KWin
 {
@@ -22,6 +24,7 @@ class ApplicationWaylandAbstract;
 namespace Xwl
 {
 class DataBridge;
+class XwaylandSocket;
 
 class Xwayland : public XwaylandInterface
 {
@@ -30,6 +33,18 @@ class Xwayland : public XwaylandInterface
 public:
     static Xwayland *self();
 
+    enum class StartMode {
+        /**
+         * The Xwayland process is spawned right away.
+         */
+        Immediately,
+        /**
+         * The X11 display sockets are created by KWin, the Xwayland process is spawned when
+         * the first X11 client connects to them.
+         */
+        OnDemand,
+    };
+
     Xwayland(ApplicationWaylandAbstract *app, QObject *parent = nullptr);
     ~Xwayland() override;
 
@@ -47,9 +62,14 @@ public Q_SLOTS:
      * be emitted. If the Xwayland server has started successfully, the started() signal will be
      * emitted.
      *
+     * With StartMode::OnDemand, only the X11 display sockets are created and the started()
+     * signal is emitted as soon as they accept connections. The Xwayland process and the
+     * XCB connection follow when the first X11 client connects, and again after Xwayland
+     * has quit.
+     *
      * @see started(), stop()
      */
-    void start();
+    void start(StartMode mode = StartMode::Immediately);
     /**
      * Stops the Xwayland server.
      *
@@ -83,6 +103,10 @@ private Q_SLOTS:
 private:
     void installSocketNotifier();
     void uninstallSocketNotifier();
+    void installListenNotifiers();
+    void uninstallListenNotifiers();
+
+    void launchXwayland();
 
     void createX11Connection();
     void destroyX11Connection();
@@ -95,6 +119,9 @@ private:
     QProcess *m_xwaylandProcess = nullptr;
     DataBridge *m_dataBridge = nullptr;
     QSocketNotifier *m_socketNotifier = nullptr;
+    QScopedPointer<XwaylandSocket> m_listenSocket;
+    QVector<QSocketNotifier *> m_listenNotifiers;
+    StartMode m_startMode = StartMode::Immediately;
     ApplicationWaylandAbstract *m_app;
 
     Q_DISABLE_COPY(Xwayland)
@@ -0,0 +1,188 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "xwaylandsocket.h"
+#include "xwayland_logging.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace KWin
+{
+namespace Xwl
+{
+
+// The X server doesn't look beyond this display number either.
+static const int s_maxDisplayNumber = 32;
+
+static bool removeStaleLockFile(const QString &lockFilePath)
+{
+    QFile lockFile(lockFilePath);
+    if (!lockFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    bool ok = false;
+    const pid_t pid = lockFile.readLine().trimmed().toInt(&ok);
+    if (!ok || pid <= 0) {
+        return false;
+    }
+    // The lock belongs to a server that is still running.
+    if (kill(pid, 0) == 0 || errno != ESRCH) {
+        return false;
+    }
+    return lockFile.remove();
+}
+
+static bool createLockFile(const QString &lockFilePath)
+{
+    QFile lockFile(lockFilePath);
+    if (!lockFile.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+        if (!removeStaleLockFile(lockFilePath) || !lockFile.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+            return false;
+        }
+    }
+    // The same format as the one of the X server, the pid right aligned in ten characters.
+    const QByteArray pid = QByteArray::number(getpid()).rightJustified(10, ' ') + '\n';
+    if (lockFile.write(pid) != pid.size()) {
+        lockFile.remove();
+        return false;
+    }
+    lockFile.setPermissions(QFile::ReadOwner | QFile::ReadGroup | QFile::ReadOther);
+    return true;
+}
+
+static int listenToSocket(const sockaddr_un &address, socklen_t addressLength)
+{
+    const int fileDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fileDescriptor == -1) {
+        return -1;
+    }
+    if (bind(fileDescriptor, reinterpret_cast<const sockaddr *>(&address), addressLength) == -1
+            || listen(fileDescriptor, SOMAXCONN) == -1) {
+        close(fileDescriptor);
+        return -1;
+    }
+    return fileDescriptor;
+}
+
+static int listenToUnixSocket(const QString &socketFilePath)
+{
+    const QByteArray encodedPath = QFile::encodeName(socketFilePath);
+    sockaddr_un address = {};
+    if (size_t(encodedPath.size()) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    qstrcpy(address.sun_path, encodedPath.constData());
+
+    // A socket left behind by a crashed server, the lock file is ours.
+    unlink(address.sun_path);
+
+    return listenToSocket(address, offsetof(sockaddr_un, sun_path) + encodedPath.size() + 1);
+}
+
+#if defined(Q_OS_LINUX)
+static int listenToAbstractSocket(const QString &socketFilePath)
+{
+    const QByteArray encodedPath = QFile::encodeName(socketFilePath);
+    sockaddr_un address = {};
+    if (size_t(encodedPath.size()) + 1 > sizeof(address.sun_path)) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    // The name of an abstract socket starts with a null byte.
+    memcpy(address.sun_path + 1, encodedPath.constData(), encodedPath.size());
+
+    return listenToSocket(address, offsetof(sockaddr_un, sun_path) + encodedPath.size() + 1);
+}
+#endif
+
+XwaylandSocket::XwaylandSocket()
+{
+    QDir().mkpath(QStringLiteral("/tmp/.X11-unix"));
+
+    for (int display = 0; display < s_maxDisplayNumber; ++display) {
+        const QString lockFilePath = QStringLiteral("/tmp/.X%1-lock").arg(display);
+        if (!createLockFile(lockFilePath)) {
+            continue;
+        }
+
+        const QString socketFilePath = QStringLiteral("/tmp/.X11-unix/X%1").arg(display);
+        QVector<int> fileDescriptors;
+
+        const int unixFileDescriptor = listenToUnixSocket(socketFilePath);
+        if (unixFileDescriptor == -1) {
+            QFile::remove(lockFilePath);
+            continue;
+        }
+        fileDescriptors << unixFileDescriptor;
+
+#if defined(Q_OS_LINUX)
+        const int abstractFileDescriptor = listenToAbstractSocket(socketFilePath);
+        if (abstractFileDescriptor == -1) {
+            close(unixFileDescriptor);
+            QFile::remove(socketFilePath);
+            QFile::remove(lockFilePath);
+            continue;
+        }
+        fileDescriptors << abstractFileDescriptor;
+#endif
+
+        m_lockFilePath = lockFilePath;
+        m_socketFilePath = socketFilePath;
+        m_fileDescriptors = fileDescriptors;
+        m_display = display;
+        return;
+    }
+
+    qCWarning(KWIN_XWL) << "Failed to find a free X11 display";
+}
+
+XwaylandSocket::~XwaylandSocket()
+{
+    for (int fileDescriptor : qAsConst(m_fileDescriptors)) {
+        close(fileDescriptor);
+    }
+    if (!m_socketFilePath.isEmpty()) {
+        QFile::remove(m_socketFilePath);
+    }
+    if (!m_lockFilePath.isEmpty()) {
+        QFile::remove(m_lockFilePath);
+    }
+}
+
+bool XwaylandSocket::isValid() const
+{
+    return m_display != -1;
+}
+
+int XwaylandSocket::display() const
+{
+    return m_display;
+}
+
+QString XwaylandSocket::name() const
+{
+    return QLatin1Char(':') + QString::number(m_display);
+}
+
+QVector<int> XwaylandSocket::fileDescriptors() const
+{
+    return m_fileDescriptors;
+}
+
+} // namespace Xwl
+} // namespace KWin
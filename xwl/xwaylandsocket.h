@@ -0,0 +1,58 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_XWL_XWAYLANDSOCKET
+#define KWIN_XWL_XWAYLANDSOCKET
+
+#include <QString>
+#include <QVector>
+
+namespace KWin
+{
+namespace Xwl
+{
+
+/**
+ * The XwaylandSocket class claims a free X11 display and listens on its connection sockets.
+ *
+ * The display is locked with a /tmp/.X<n>-lock file like the X server itself does it. The
+ * listening sockets are handed over to the Xwayland process, which accepts the X11 clients.
+ */
+class XwaylandSocket
+{
+public:
+    XwaylandSocket();
+    ~XwaylandSocket();
+
+    /**
+     * Returns @c true if a display has been claimed and its sockets are listening.
+     */
+    bool isValid() const;
+    /**
+     * Returns the display number, e.g. 1 for ":1".
+     */
+    int display() const;
+    /**
+     * Returns the name of the display, e.g. ":1".
+     */
+    QString name() const;
+    QVector<int> fileDescriptors() const;
+
+private:
+    QString m_lockFilePath;
+    QString m_socketFilePath;
+    QVector<int> m_fileDescriptors;
+    int m_display = -1;
+
+    Q_DISABLE_COPY(XwaylandSocket)
+};
+
+} // namespace Xwl
+} // namespace KWin
+
+#endif